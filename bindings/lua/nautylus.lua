@@ -8,6 +8,21 @@ typedef unsigned long long ng_node_id;
 typedef unsigned long long ng_relationship_id;
 typedef unsigned long long ng_symbol_id;
 typedef struct ng_graph ng_graph;
+typedef struct {
+    int type;
+    size_t length;
+    union {
+        int boolean;
+        long long integer;
+        double real;
+        const char* string;
+        const void* pointer;
+    } as;
+} ng_value;
+typedef struct {
+    const char* name;
+    ng_value value;
+} ng_parameter;
 int ng_create(ng_graph** out, const char* path);
 int ng_open(ng_graph** out, const char* path);
 void ng_close(ng_graph* g);
@@ -48,6 +63,14 @@ size_t ng_node_count(const ng_graph* g);
 size_t ng_relationship_count(const ng_graph* g);
 int ng_query_print_file(const ng_graph* g, const char* query, const char* output_path);
 int ng_query_execute_file(ng_graph* g, const char* query, const char* output_path, int* mutated);
+int ng_query_execute_batch_params_file(
+    ng_graph* g,
+    const char* query,
+    const ng_parameter* parameter_rows,
+    size_t parameter_count,
+    size_t row_count,
+    const char* output_path,
+    int* mutated);
 const char* ng_status_name(int s);
 ]]
 
@@ -240,5 +263,68 @@ function Graph:query(query, mutate)
     return err
 end
 
+local function set_value(out, value, anchors)
+    local kind = type(value)
+    if kind == "boolean" then
+        out.type = 1
+        out.as.boolean = value and 1 or 0
+    elseif kind == "number" then
+        if value == math.floor(value) and value >= -2 ^ 53 and value <= 2 ^ 53 then
+            out.type = 2
+            out.as.integer = value
+        else
+            out.type = 3
+            out.as.real = value
+        end
+    else
+        local text = tostring(value)
+        anchors[#anchors + 1] = text
+        out.type = 4
+        out.length = #text
+        out.as.string = text
+    end
+end
+
+function Graph:query_batch(query, rows)
+    local names = {}
+    if rows[1] then
+        for name in pairs(rows[1]) do
+            names[#names + 1] = name
+        end
+        table.sort(names)
+    end
+    local params = ffi.new("ng_parameter[?]", math.max(1, #names * #rows))
+    local anchors = {}
+    for r, row in ipairs(rows) do
+        local count = 0
+        for _ in pairs(row) do
+            count = count + 1
+        end
+        if count ~= #names then
+            error("all parameter rows must use the same names")
+        end
+        for i, name in ipairs(names) do
+            local param = params[(r - 1) * #names + (i - 1)]
+            if row[name] == nil then
+                error("all parameter rows must use the same names")
+            end
+            param.name = name
+            set_value(param.value, row[name], anchors)
+        end
+    end
+    local path = temp_path()
+    local ok_query, err = pcall(function()
+        local changed = ffi.new("int[1]")
+        check(C.ng_query_execute_batch_params_file(
+            self:require_handle(), query, params, #names, #rows, path, changed))
+        return read_file(path)
+    end)
+    os.remove(path)
+    if not ok_query then
+        error(err)
+    end
+    return err
+end
+
 M.Graph = Graph
 return M
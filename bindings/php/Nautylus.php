@@ -8,6 +8,21 @@ typedef unsigned long long ng_node_id;
 typedef unsigned long long ng_relationship_id;
 typedef unsigned long long ng_symbol_id;
 typedef struct ng_graph ng_graph;
+typedef struct {
+    int type;
+    size_t length;
+    union {
+        int boolean;
+        long long integer;
+        double real;
+        const char* string;
+        const void* pointer;
+    } as;
+} ng_value;
+typedef struct {
+    const char* name;
+    ng_value value;
+} ng_parameter;
 int ng_create(ng_graph** out, const char* path);
 int ng_open(ng_graph** out, const char* path);
 void ng_close(ng_graph* g);
@@ -48,6 +63,14 @@ size_t ng_node_count(const ng_graph* g);
 size_t ng_relationship_count(const ng_graph* g);
 int ng_query_print_file(const ng_graph* g, const char* query, const char* output_path);
 int ng_query_execute_file(ng_graph* g, const char* query, const char* output_path, int* mutated);
+int ng_query_execute_batch_params_file(
+    ng_graph* g,
+    const char* query,
+    const ng_parameter* parameter_rows,
+    size_t parameter_count,
+    size_t row_count,
+    const char* output_path,
+    int* mutated);
 const char* ng_status_name(int s);
 CDEF;
 
@@ -230,6 +253,84 @@ final class NautylusGraph
         }
     }
 
+    /**
+     * Run one write-capable query once per parameter row inside a single transaction.
+     *
+     * @param array<int, array<string, null|bool|int|float|string>> $rows
+     */
+    public function queryBatch(string $query, array $rows): string
+    {
+        $rows = array_values($rows);
+        $names = $rows ? array_keys($rows[0]) : [];
+        $count = count($names);
+        $params = $this->ffi->new('ng_parameter[' . max(1, $count * count($rows)) . ']');
+        $anchors = [];
+        foreach ($rows as $r => $row) {
+            if (count($row) !== $count) {
+                throw new InvalidArgumentException('all parameter rows must use the same names');
+            }
+            foreach ($names as $i => $name) {
+                if (!array_key_exists($name, $row)) {
+                    throw new InvalidArgumentException('all parameter rows must use the same names');
+                }
+                $param = $params[$r * $count + $i];
+                $param->name = $this->cString((string)$name, $anchors);
+                $this->setValue($param->value, $row[$name], $anchors);
+            }
+        }
+        $path = tempnam(sys_get_temp_dir(), 'nautylus-query-');
+        if ($path === false) {
+            throw new RuntimeException('could not create temporary query output file');
+        }
+        try {
+            $changed = $this->ffi->new('int[1]');
+            self::check($this->ffi, $this->ffi->ng_query_execute_batch_params_file(
+                $this->handle(),
+                $query,
+                $params,
+                $count,
+                count($rows),
+                $path,
+                $changed
+            ));
+            $result = file_get_contents($path);
+            return $result === false ? '' : $result;
+        } finally {
+            @unlink($path);
+        }
+    }
+
+    /** @param array<int, FFI\CData> $anchors */
+    private function cString(string $text, array &$anchors): FFI\CData
+    {
+        $buffer = $this->ffi->new('char[' . (strlen($text) + 1) . ']');
+        FFI::memcpy($buffer, $text, strlen($text));
+        $anchors[] = $buffer;
+        return $this->ffi->cast('const char*', FFI::addr($buffer));
+    }
+
+    /** @param array<int, FFI\CData> $anchors */
+    private function setValue(FFI\CData $out, $value, array &$anchors): void
+    {
+        if ($value === null) {
+            $out->type = 0;
+        } elseif (is_bool($value)) {
+            $out->type = 1;
+            $out->as->boolean = $value ? 1 : 0;
+        } elseif (is_int($value)) {
+            $out->type = 2;
+            $out->as->integer = $value;
+        } elseif (is_float($value)) {
+            $out->type = 3;
+            $out->as->real = $value;
+        } else {
+            $text = (string)$value;
+            $out->type = 4;
+            $out->length = strlen($text);
+            $out->as->string = $this->cString($text, $anchors);
+        }
+    }
+
     private function handle(): FFI\CData
     {
         if ($this->graph === null) {
@@ -14,10 +14,15 @@ import ctypes
 import os
 import tempfile
 from pathlib import Path
-from typing import Iterable, Optional
+from typing import Iterable, Mapping, Optional, Sequence
 
 
 NG_OK = 0
+NG_VALUE_NULL = 0
+NG_VALUE_BOOL = 1
+NG_VALUE_INT64 = 2
+NG_VALUE_DOUBLE = 3
+NG_VALUE_STRING = 4
 
 
 def _default_library_path() -> str:
@@ -49,6 +54,24 @@ NodeId = ctypes.c_uint64
 RelationshipId = ctypes.c_uint64
 Status = ctypes.c_int
 
+
+class _ValueData(ctypes.Union):
+    _fields_ = [
+        ("boolean", ctypes.c_int),
+        ("integer", ctypes.c_int64),
+        ("real", ctypes.c_double),
+        ("string", ctypes.c_char_p),
+        ("pointer", ctypes.c_void_p),
+    ]
+
+
+class _Value(ctypes.Structure):
+    _fields_ = [("type", ctypes.c_int), ("length", ctypes.c_size_t), ("as_", _ValueData)]
+
+
+class _Parameter(ctypes.Structure):
+    _fields_ = [("name", ctypes.c_char_p), ("value", _Value)]
+
 _lib.ng_create.argtypes = [ctypes.POINTER(GraphPtr), ctypes.c_char_p]
 _lib.ng_create.restype = Status
 _lib.ng_open.argtypes = [ctypes.POINTER(GraphPtr), ctypes.c_char_p]
@@ -118,6 +141,16 @@ _lib.ng_query_execute_file.argtypes = [
     ctypes.POINTER(ctypes.c_int),
 ]
 _lib.ng_query_execute_file.restype = Status
+_lib.ng_query_execute_batch_params_file.argtypes = [
+    GraphPtr,
+    ctypes.c_char_p,
+    ctypes.POINTER(_Parameter),
+    ctypes.c_size_t,
+    ctypes.c_size_t,
+    ctypes.c_char_p,
+    ctypes.POINTER(ctypes.c_int),
+]
+_lib.ng_query_execute_batch_params_file.restype = Status
 _lib.ng_status_name.argtypes = [Status]
 _lib.ng_status_name.restype = ctypes.c_char_p
 
@@ -132,6 +165,25 @@ def _check(status: int) -> None:
         raise RuntimeError(name.decode("utf-8") if name else f"ng_status({status})")
 
 
+def _set_value(out: _Value, value: object) -> None:
+    if value is None:
+        out.type = NG_VALUE_NULL
+    elif isinstance(value, bool):
+        out.type = NG_VALUE_BOOL
+        out.as_.boolean = int(value)
+    elif isinstance(value, int):
+        out.type = NG_VALUE_INT64
+        out.as_.integer = value
+    elif isinstance(value, float):
+        out.type = NG_VALUE_DOUBLE
+        out.as_.real = value
+    else:
+        data = str(value).encode("utf-8")
+        out.type = NG_VALUE_STRING
+        out.length = len(data)
+        out.as_.string = data
+
+
 class Graph:
     def __init__(self, handle: GraphPtr):
         self._handle: Optional[GraphPtr] = handle
@@ -254,5 +306,39 @@ class Graph:
             except FileNotFoundError:
                 pass
 
+    def query_batch(self, query: str, rows: Sequence[Mapping[str, object]]) -> str:
+        """Run one write-capable query once per parameter row in a single transaction."""
+        names = list(rows[0].keys()) if rows else []
+        params = (_Parameter * max(1, len(names) * len(rows)))()
+        encoded = [name.encode("utf-8") for name in names]
+        for r, row in enumerate(rows):
+            if set(row.keys()) != set(names):
+                raise ValueError("all parameter rows must use the same names")
+            for i, name in enumerate(names):
+                param = params[r * len(names) + i]
+                param.name = encoded[i]
+                _set_value(param.value, row[name])
+        with tempfile.NamedTemporaryFile(delete=False) as tmp:
+            path = tmp.name
+        try:
+            changed = ctypes.c_int(0)
+            _check(
+                _lib.ng_query_execute_batch_params_file(
+                    self._require(),
+                    query.encode("utf-8"),
+                    params,
+                    len(names),
+                    len(rows),
+                    _bytes(path),
+                    ctypes.byref(changed),
+                )
+            )
+            return Path(path).read_text(encoding="utf-8")
+        finally:
+            try:
+                os.unlink(path)
+            except FileNotFoundError:
+                pass
+
 
 __all__ = ["Graph", "NG_OK"]
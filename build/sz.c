@@ -0,0 +1,2 @@
+#include "../src/nautylus.c"
+int main(void){printf("query %zu match %zu node %zu rel %zu scalar %zu term %zu proj %zu row %zu\n",sizeof(ng_cy_query),sizeof(ng_cy_match),sizeof(ng_cy_node_pat),sizeof(ng_cy_rel_pat),sizeof(ng_cy_scalar),sizeof(ng_cy_term),sizeof(ng_cy_projection),sizeof(ng_cy_row));return 0;}
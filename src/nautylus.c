@@ -1,3 +1,6 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include "nautylus.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,6 +9,7 @@
 #include <limits.h>
 #include <ctype.h>
 #include <math.h>
+#include <time.h>
 #ifndef _WIN32
 #include <sys/stat.h>
 #endif
@@ -63,6 +67,7 @@ uint64_t ng_test_import_stage_mask(void) {
 static const ng_parameter* ng_query_parameters;
 static size_t ng_query_parameter_count;
 static int ng_query_parameter_error;
+static ng_status ng_cy_pattern_status;
 
 typedef struct {
     ng_symbol_id id;
@@ -96,6 +101,44 @@ typedef struct {
     ng_procedure_handler handler;
     void* context;
 } procedure_i;
+typedef struct {
+    uint32_t hash;
+    char* query;
+    ng_parameter* parameters;
+    size_t parameter_count;
+    char* output;
+    size_t length, bytes;
+    uint64_t used;
+} query_cache_entry_i;
+typedef struct {
+    query_cache_entry_i* entries;
+    size_t count, capacity, max_entries, max_bytes, bytes;
+    uint64_t version, tick, hits, misses;
+} query_cache_i;
+typedef struct {
+    uint32_t hash;
+    size_t count;
+    ng_value value;
+} posting_i;
+typedef struct {
+    ng_symbol_id label, key;
+    int valid;
+    posting_i* slots;
+    size_t capacity, used;
+} posting_table_i;
+typedef struct {
+    uint64_t version;
+    size_t *labels, *types;
+    size_t symbols;
+    posting_table_i* postings;
+    size_t posting_count, posting_capacity;
+} count_stats_i;
+/* Per-position outgoing/incoming relationship lists used by MATCH expansion; cached on the graph
+ * and rebuilt once the graph version moves past `version`. */
+typedef struct {
+    uint64_t version;
+    size_t *out_offsets, *out_rels, *in_offsets, *in_rels, *src_pos, *dst_pos;
+} ng_cy_adjacency;
 struct ng_graph {
     char* path;
     uint64_t next_node, next_rel, next_sym;
@@ -114,6 +157,10 @@ struct ng_graph {
     size_t an;
     procedure_i* procedures;
     size_t procedure_count, procedure_capacity;
+    uint64_t version;
+    query_cache_i* query_cache;
+    count_stats_i* counts;
+    ng_cy_adjacency* adjacency;
 };
 struct ng_transaction {
     ng_graph* target;
@@ -146,6 +193,13 @@ struct ng_vector_index {
     size_t* hnsw_counts;
     size_t* hnsw_neighbors;
 };
+struct ng_analytics_view {
+    ng_direction direction;
+    size_t node_count, relationship_count;
+    ng_node_id* nodes;
+    size_t *out_offsets, *out_nodes, *in_offsets, *in_nodes;
+    double *out_weights, *in_weights;
+};
 typedef struct {
     size_t dimensions;
     double* aggregate;
@@ -350,6 +404,9 @@ struct ng_node_index {
 static ng_status ng_validate_constraints_all(const ng_graph* g);
 static int ng_value_equal(const ng_value* a, const ng_value* b);
 static void valfree(ng_value* v);
+static void ng_query_cache_free(query_cache_i* c);
+static void ng_count_stats_free(count_stats_i* c);
+static void ng_count_postings_note(ng_graph* g, const node_i* n, ng_symbol_id key, int delta);
 static int ng_ident_char(int c);
 static int ng_node_matches_label(const node_i* n, ng_symbol_id label);
 static size_t ng_node_position(const ng_graph* g, ng_node_id id);
@@ -423,10 +480,11 @@ static uint64_t get64(const unsigned char* p) {
         v |= ((uint64_t)p[i]) << (8 * i);
     return v;
 }
-static uint32_t hash32(const unsigned char* p, size_t n) {
-    uint32_t h = 2166136261u;
+/* FNV-1a continued from h; start from 2166136261u. */
+static uint32_t hash32(uint32_t h, const void* p, size_t n) {
+    const unsigned char* b = (const unsigned char*)p;
     while (n--)
-        h = (h ^ *p++) * 16777619u;
+        h = (h ^ *b++) * 16777619u;
     return h;
 }
 typedef struct {
@@ -555,7 +613,7 @@ ng_status ng_save(ng_graph* g) {
     h[5] = 3;
     put64(h + 8, (uint64_t)b.n);
     put64(h + 16, g->next_node ^ g->next_rel ^ g->next_sym);
-    put64(h + 24, hash32(b.p, b.n));
+    put64(h + 24, hash32(2166136261u, b.p, b.n));
     (void)snprintf(tmp, sizeof(tmp), "%s.tmp", g->path);
     f = fopen(tmp, "wb");
     if (f && ng_secure_file(tmp) != NG_OK) {
@@ -747,7 +805,7 @@ ng_status ng_open(ng_graph** o, const char* p) {
         return NG_CORRUPT;
     }
     fclose(f);
-    if (hash32(d, (size_t)z) != (uint32_t)get64(h + 24)) {
+    if (hash32(2166136261u, d, (size_t)z) != (uint32_t)get64(h + 24)) {
         free(d);
         ng_close(*o);
         return NG_CORRUPT;
@@ -1020,6 +1078,17 @@ static int ng_valid_value(const ng_value* v) {
     }
     return 1;
 }
+static void ng_cy_adjacency_free(ng_cy_adjacency* a) {
+    if (!a)
+        return;
+    free(a->out_offsets);
+    free(a->out_rels);
+    free(a->in_offsets);
+    free(a->in_rels);
+    free(a->src_pos);
+    free(a->dst_pos);
+    free(a);
+}
 void ng_close(ng_graph* g) {
     size_t i, j;
     if (!g)
@@ -1048,9 +1117,63 @@ void ng_close(ng_graph* g) {
     for (i = 0; i < g->procedure_count; i++)
         free(g->procedures[i].name);
     free(g->procedures);
+    ng_query_cache_free(g->query_cache);
+    ng_count_stats_free(g->counts);
+    ng_cy_adjacency_free(g->adjacency);
     free(g->path);
     free(g);
 }
+static void ng_count_stats_free(count_stats_i* c) {
+    size_t i, j;
+    if (!c)
+        return;
+    for (i = 0; i < c->posting_count; i++) {
+        for (j = 0; j < c->postings[i].capacity; j++)
+            if (c->postings[i].slots[j].count)
+                valfree(&c->postings[i].slots[j].value);
+        free(c->postings[i].slots);
+    }
+    free(c->postings);
+    free(c->labels);
+    free(c->types);
+    free(c);
+}
+static void ng_graph_bump(ng_graph* g) {
+    if (g->counts && g->counts->version == g->version)
+        g->counts->version = g->version + 1;
+    g->version++;
+}
+static void ng_count_stats_note(
+    ng_graph* g, const ng_symbol_id* labels, size_t n, ng_symbol_id type, int delta) {
+    count_stats_i* c = g->counts;
+    size_t i, j, symbols = (size_t)g->next_sym;
+    if (!c || c->version != g->version)
+        return;
+    if (symbols > c->symbols) {
+        size_t* grown_labels = (size_t*)realloc(c->labels, symbols * sizeof(size_t));
+        size_t* grown_types = grown_labels ? (size_t*)realloc(c->types, symbols * sizeof(size_t))
+                                           : NULL;
+        if (grown_labels)
+            c->labels = grown_labels;
+        if (!grown_types) {
+            ng_count_stats_free(c);
+            g->counts = NULL;
+            return;
+        }
+        c->types = grown_types;
+        memset(c->labels + c->symbols, 0, (symbols - c->symbols) * sizeof(size_t));
+        memset(c->types + c->symbols, 0, (symbols - c->symbols) * sizeof(size_t));
+        c->symbols = symbols;
+    }
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < i && labels[j] != labels[i]; j++)
+            ;
+        if (j == i && labels[i] < c->symbols)
+            c->labels[labels[i]] += (size_t)delta;
+    }
+    if (type && type < c->symbols)
+        c->types[type] += (size_t)delta;
+}
 ng_status ng_symbol(ng_graph* g, const char* s, ng_symbol_id* o) {
     size_t i;
     char* copy;
@@ -1071,14 +1194,36 @@ ng_status ng_symbol(ng_graph* g, const char* s, ng_symbol_id* o) {
     g->sy[g->ns].id = g->next_sym++;
     g->sy[g->ns].s = copy;
     *o = g->sy[g->ns++].id;
+    ng_graph_bump(g);
     return NG_OK;
 }
+/* Node and relationship arrays are in strictly increasing id order; ng_validate() rejects any
+ * graph that is not. */
+static size_t ng_node_position(const ng_graph* g, ng_node_id id) {
+    size_t lo = 0, hi = g->nn;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (g->no[mid].id < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < g->nn && g->no[lo].id == id ? lo : SIZE_MAX;
+}
+static size_t ng_relationship_position(const ng_graph* g, ng_relationship_id id) {
+    size_t lo = 0, hi = g->nr;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (g->re[mid].id < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < g->nr && g->re[lo].id == id ? lo : SIZE_MAX;
+}
 static node_i* node(ng_graph* g, ng_id id) {
-    size_t i;
-    for (i = 0; i < g->nn; i++)
-        if (g->no[i].id == id)
-            return &g->no[i];
-    return NULL;
+    size_t i = ng_node_position(g, id);
+    return i == SIZE_MAX ? NULL : &g->no[i];
 }
 static const prop* findprop(const prop* p, size_t n, ng_symbol_id k) {
     size_t i;
@@ -1112,6 +1257,8 @@ ng_status ng_node_create(ng_graph* g, const ng_symbol_id* l, size_t n, ng_id* o)
     x->labels = labels;
     x->nl = n;
     *o = x->id;
+    ng_count_stats_note(g, labels, n, 0, 1);
+    ng_graph_bump(g);
     return NG_OK;
 }
 ng_status ng_relationship_create(ng_graph* g, ng_id a, ng_symbol_id t, ng_id b, ng_id* o) {
@@ -1129,6 +1276,8 @@ ng_status ng_relationship_create(ng_graph* g, ng_id a, ng_symbol_id t, ng_id b,
     r->dst = b;
     r->type = t;
     *o = r->id;
+    ng_count_stats_note(g, NULL, 0, t, 1);
+    ng_graph_bump(g);
     return NG_OK;
 }
 ng_status ng_relationship_delete(ng_graph* g, ng_relationship_id id) {
@@ -1137,12 +1286,14 @@ ng_status ng_relationship_delete(ng_graph* g, ng_relationship_id id) {
         return NG_INVALID_ARGUMENT;
     for (i = 0; i < g->nr; i++)
         if (g->re[i].id == id) {
+            ng_count_stats_note(g, NULL, 0, g->re[i].type, -1);
             for (j = 0; j < g->re[i].np; j++)
                 valfree(&g->re[i].p[j].v);
             free(g->re[i].p);
             if (i + 1 < g->nr)
                 memmove(&g->re[i], &g->re[i + 1], (g->nr - i - 1) * sizeof(*g->re));
             g->nr--;
+            ng_graph_bump(g);
             return NG_OK;
         }
     return NG_NOT_FOUND;
@@ -1156,6 +1307,8 @@ ng_status ng_node_delete(ng_graph* g, ng_node_id id) {
             for (j = g->nr; j > 0; j--)
                 if (g->re[j - 1].src == id || g->re[j - 1].dst == id)
                     ng_relationship_delete(g, g->re[j - 1].id);
+            ng_count_stats_note(g, g->no[i].labels, g->no[i].nl, 0, -1);
+            ng_count_postings_note(g, &g->no[i], 0, -1);
             free(g->no[i].labels);
             for (j = 0; j < g->no[i].np; j++)
                 valfree(&g->no[i].p[j].v);
@@ -1163,6 +1316,7 @@ ng_status ng_node_delete(ng_graph* g, ng_node_id id) {
             if (i + 1 < g->nn)
                 memmove(&g->no[i], &g->no[i + 1], (g->nn - i - 1) * sizeof(*g->no));
             g->nn--;
+            ng_graph_bump(g);
             return NG_OK;
         }
     return NG_NOT_FOUND;
@@ -1233,9 +1387,14 @@ ng_status ng_node_set(ng_graph* g, ng_id id, ng_symbol_id k, const ng_value* v)
     if (!ng_symbol_name(g, k))
         return NG_NOT_FOUND;
     s = ng_node_set_constraint_check(g, n, k, v);
-    if (s != NG_OK)
-        return s;
-    return setprop(&n->p, &n->np, &n->cap, k, v);
+    if (s == NG_OK) {
+        ng_count_postings_note(g, n, k, -1);
+        s = setprop(&n->p, &n->np, &n->cap, k, v);
+        ng_count_postings_note(g, n, k, 1);
+    }
+    if (s == NG_OK)
+        ng_graph_bump(g);
+    return s;
 }
 ng_status ng_node_set_string(ng_graph* g, ng_node_id node_id, ng_symbol_id key, const char* value) {
     ng_value v;
@@ -1284,8 +1443,12 @@ static const ng_value* ng_property_list_find(const ng_property* p, size_t n, ng_
             return &p[i].value;
     return NULL;
 }
-static ng_status ng_node_create_properties_check(
-    const ng_graph* g, const ng_symbol_id* l, size_t nl, const ng_property* p, size_t np) {
+static ng_status ng_node_create_properties_check(const ng_graph* g,
+                                                 const ng_symbol_id* l,
+                                                 size_t nl,
+                                                 const ng_property* p,
+                                                 size_t np,
+                                                 int check_unique) {
     size_t i, j;
     if (!g || (nl && !l) || (np && !p))
         return NG_INVALID_ARGUMENT;
@@ -1315,7 +1478,7 @@ static ng_status ng_node_create_properties_check(
             if (g->co[i].kind == NG_NODE_CONSTRAINT_REQUIRED_PROPERTY &&
                 (!v || v->type == NG_VALUE_NULL))
                 return NG_NOT_FOUND;
-            if (g->co[i].kind == NG_NODE_CONSTRAINT_UNIQUE_PROPERTY && v &&
+            if (check_unique && g->co[i].kind == NG_NODE_CONSTRAINT_UNIQUE_PROPERTY && v &&
                 v->type != NG_VALUE_NULL)
                 for (j = 0; j < g->nn; j++) {
                     const prop* x;
@@ -1339,7 +1502,7 @@ ng_status ng_node_create_with_properties(ng_graph* g,
     ng_status s;
     if (!out)
         return NG_INVALID_ARGUMENT;
-    s = ng_node_create_properties_check(g, l, nl, p, np);
+    s = ng_node_create_properties_check(g, l, nl, p, np, 1);
     if (s != NG_OK)
         return s;
     s = ng_node_create(g, l, nl, &id);
@@ -1357,13 +1520,18 @@ ng_status ng_node_create_with_properties(ng_graph* g,
 }
 ng_status ng_relationship_set(ng_graph* g, ng_id id, ng_symbol_id k, const ng_value* v) {
     size_t i;
+    ng_status s;
     if (!g || !v)
         return NG_INVALID_ARGUMENT;
     if (!ng_valid_value(v))
         return NG_INVALID_ARGUMENT;
     for (i = 0; i < g->nr; i++)
-        if (g->re[i].id == id)
-            return setprop(&g->re[i].p, &g->re[i].np, &g->re[i].cap, k, v);
+        if (g->re[i].id == id) {
+            s = setprop(&g->re[i].p, &g->re[i].np, &g->re[i].cap, k, v);
+            if (s == NG_OK)
+                ng_graph_bump(g);
+            return s;
+        }
     return NG_NOT_FOUND;
 }
 ng_status ng_relationship_set_string(ng_graph* g,
@@ -1419,6 +1587,7 @@ static ng_status unsetprop(prop* p, size_t* n, ng_symbol_id k) {
 }
 ng_status ng_node_unset(ng_graph* g, ng_node_id id, ng_symbol_id k) {
     node_i* n;
+    ng_status s;
     if (!g || !k)
         return NG_INVALID_ARGUMENT;
     n = node(g, id);
@@ -1428,15 +1597,25 @@ ng_status ng_node_unset(ng_graph* g, ng_node_id id, ng_symbol_id k) {
         return NG_NOT_FOUND;
     if (!ng_node_unset_allowed(g, n, k))
         return NG_NOT_FOUND;
-    return unsetprop(n->p, &n->np, k);
+    ng_count_postings_note(g, n, k, -1);
+    s = unsetprop(n->p, &n->np, k);
+    ng_count_postings_note(g, n, k, 1);
+    if (s == NG_OK)
+        ng_graph_bump(g);
+    return s;
 }
 ng_status ng_relationship_unset(ng_graph* g, ng_relationship_id id, ng_symbol_id k) {
     size_t i;
+    ng_status s;
     if (!g)
         return NG_INVALID_ARGUMENT;
     for (i = 0; i < g->nr; i++)
-        if (g->re[i].id == id)
-            return unsetprop(g->re[i].p, &g->re[i].np, k);
+        if (g->re[i].id == id) {
+            s = unsetprop(g->re[i].p, &g->re[i].np, k);
+            if (s == NG_OK)
+                ng_graph_bump(g);
+            return s;
+        }
     return NG_NOT_FOUND;
 }
 size_t ng_node_count(const ng_graph* g) {
@@ -1759,97 +1938,296 @@ static ng_status ng_analytics_check_output(
         return NG_INVALID_ARGUMENT;
     return NG_OK;
 }
-ng_status ng_label_propagation(const ng_graph* g,
-                               ng_direction direction,
-                               ng_symbol_id type,
-                               uint32_t iterations,
-                               ng_node_component* out,
-                               size_t capacity,
-                               size_t* out_count) {
-    uint64_t* labels;
-    uint64_t* next;
-    size_t i, j;
+void ng_analytics_view_free(ng_analytics_view* view) {
+    if (!view)
+        return;
+    if (view->in_offsets != view->out_offsets) {
+        free(view->in_offsets);
+        free(view->in_nodes);
+        free(view->in_weights);
+    }
+    free(view->out_offsets);
+    free(view->out_nodes);
+    free(view->out_weights);
+    free(view->nodes);
+    free(view);
+}
+static double ng_analytics_weight(const rel_i* r, ng_symbol_id key) {
+    const prop* p;
+    if (!key || !(p = findprop(r->p, r->np, key)))
+        return 1.0;
+    if (p->v.type == NG_VALUE_INT64)
+        return (double)p->v.as.integer;
+    if (p->v.type == NG_VALUE_DOUBLE)
+        return p->v.as.real;
+    return NAN;
+}
+/* Counting-sort pass: offsets hold per-node counts in [1..n] and become row starts. */
+static ng_status ng_analytics_csr(size_t n,
+                                  size_t count,
+                                  const size_t* from,
+                                  const size_t* to,
+                                  const double* weights,
+                                  int undirected,
+                                  size_t* offsets,
+                                  size_t** out_nodes,
+                                  double** out_weights) {
+    size_t i, *fill, edges;
+    for (i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+    edges = offsets[n];
+    fill = (size_t*)malloc((n ? n : 1) * sizeof(*fill));
+    *out_nodes = (size_t*)malloc((edges ? edges : 1) * sizeof(**out_nodes));
+    *out_weights = weights ? (double*)malloc((edges ? edges : 1) * sizeof(**out_weights)) : NULL;
+    if (!fill || !*out_nodes || (weights && !*out_weights)) {
+        free(fill);
+        return NG_OOM;
+    }
+    memcpy(fill, offsets, n * sizeof(*fill));
+    for (i = 0; i < count; i++) {
+        size_t e;
+        if (from[i] == SIZE_MAX)
+            continue;
+        e = fill[from[i]]++;
+        (*out_nodes)[e] = to[i];
+        if (weights)
+            (*out_weights)[e] = weights[i];
+        if (undirected && from[i] != to[i]) {
+            e = fill[to[i]]++;
+            (*out_nodes)[e] = from[i];
+            if (weights)
+                (*out_weights)[e] = weights[i];
+        }
+    }
+    free(fill);
+    return NG_OK;
+}
+ng_status ng_analytics_view_build(const ng_graph* g,
+                                  ng_direction direction,
+                                  ng_symbol_id type,
+                                  ng_symbol_id weight_key,
+                                  ng_analytics_view** out) {
+    ng_analytics_view* v;
+    size_t *from = NULL, *to = NULL, i, n, m;
+    double* weights = NULL;
+    ng_status s = NG_OOM;
+    if (!g || !out || direction > NG_DIRECTION_EITHER)
+        return NG_INVALID_ARGUMENT;
+    *out = NULL;
+    if (!ng_analytics_symbol_ok(g, type) ||
+        (weight_key && !ng_analytics_symbol_ok(g, weight_key)))
+        return NG_NOT_FOUND;
+    n = g->nn;
+    m = g->nr;
+    v = (ng_analytics_view*)calloc(1, sizeof(*v));
+    if (!v)
+        return NG_OOM;
+    v->direction = direction;
+    v->node_count = n;
+    v->nodes = (ng_node_id*)malloc((n ? n : 1) * sizeof(*v->nodes));
+    v->out_offsets = (size_t*)calloc(n + 1, sizeof(*v->out_offsets));
+    from = (size_t*)malloc((m ? m : 1) * sizeof(*from));
+    to = (size_t*)malloc((m ? m : 1) * sizeof(*to));
+    if (weight_key)
+        weights = (double*)malloc((m ? m : 1) * sizeof(*weights));
+    if (!v->nodes || !v->out_offsets || !from || !to || (weight_key && !weights))
+        goto done;
+    for (i = 0; i < n; i++)
+        v->nodes[i] = g->no[i].id;
+    for (i = 0; i < m; i++) {
+        const rel_i* r = &g->re[i];
+        size_t a, b;
+        from[i] = to[i] = SIZE_MAX;
+        if (!ng_analytics_rel_ok(r, type))
+            continue;
+        a = ng_node_position(g, r->src);
+        b = ng_node_position(g, r->dst);
+        if (a == SIZE_MAX || b == SIZE_MAX)
+            continue;
+        from[i] = direction == NG_DIRECTION_INCOMING ? b : a;
+        to[i] = direction == NG_DIRECTION_INCOMING ? a : b;
+        if (weights)
+            weights[i] = ng_analytics_weight(r, weight_key);
+        v->relationship_count++;
+        v->out_offsets[from[i] + 1]++;
+        if (direction == NG_DIRECTION_EITHER && a != b)
+            v->out_offsets[to[i] + 1]++;
+    }
+    s = ng_analytics_csr(n,
+                         m,
+                         from,
+                         to,
+                         weights,
+                         direction == NG_DIRECTION_EITHER,
+                         v->out_offsets,
+                         &v->out_nodes,
+                         &v->out_weights);
+    if (s != NG_OK)
+        goto done;
+    if (direction == NG_DIRECTION_EITHER) {
+        v->in_offsets = v->out_offsets;
+        v->in_nodes = v->out_nodes;
+        v->in_weights = v->out_weights;
+        goto done;
+    }
+    s = NG_OOM;
+    v->in_offsets = (size_t*)calloc(n + 1, sizeof(*v->in_offsets));
+    if (!v->in_offsets)
+        goto done;
+    for (i = 0; i < m; i++)
+        if (to[i] != SIZE_MAX)
+            v->in_offsets[to[i] + 1]++;
+    s = ng_analytics_csr(n, m, to, from, weights, 0, v->in_offsets, &v->in_nodes, &v->in_weights);
+done:
+    free(from);
+    free(to);
+    free(weights);
+    if (s != NG_OK) {
+        ng_analytics_view_free(v);
+        return s;
+    }
+    *out = v;
+    return NG_OK;
+}
+size_t ng_analytics_view_node_count(const ng_analytics_view* view) {
+    return view ? view->node_count : 0;
+}
+size_t ng_analytics_view_relationship_count(const ng_analytics_view* view) {
+    return view ? view->relationship_count : 0;
+}
+static ng_status ng_analytics_view_check(const ng_analytics_view* view,
+                                         const void* out,
+                                         size_t capacity,
+                                         size_t* out_count) {
+    if (!view)
+        return NG_INVALID_ARGUMENT;
+    if (out_count)
+        *out_count = view->node_count;
+    if (capacity < view->node_count)
+        return NG_LIMIT;
+    if (view->node_count && !out)
+        return NG_INVALID_ARGUMENT;
+    return NG_OK;
+}
+/* Position of `id` in the view's sorted node array, or SIZE_MAX. */
+static size_t ng_analytics_view_position(const ng_analytics_view* v, ng_node_id id) {
+    size_t lo = 0, hi = v->node_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (v->nodes[mid] < id)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < v->node_count && v->nodes[lo] == id ? lo : SIZE_MAX;
+}
+/* Undirected neighbourhood of a view: a directed view contributes its out and in rows, skipping the
+ * second copy of self-loops, so every relationship appears once per endpoint. */
+static size_t ng_analytics_view_sides(const ng_analytics_view* v) {
+    return v->direction == NG_DIRECTION_EITHER ? 1 : 2;
+}
+static const size_t*
+ng_analytics_view_row(const ng_analytics_view* v, size_t side, size_t node, size_t* count) {
+    const size_t* offsets = side ? v->in_offsets : v->out_offsets;
+    *count = offsets[node + 1] - offsets[node];
+    return (side ? v->in_nodes : v->out_nodes) + offsets[node];
+}
+ng_status ng_label_propagation_view(const ng_analytics_view* view,
+                                    uint32_t iterations,
+                                    ng_node_component* out,
+                                    size_t capacity,
+                                    size_t* out_count) {
+    uint64_t *labels, *next;
+    size_t *mark, *frequency, *touched, i, j, n;
     ng_status s;
-    if (direction > NG_DIRECTION_EITHER || !iterations)
+    if (!iterations)
         return NG_INVALID_ARGUMENT;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    s = ng_analytics_view_check(view, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    labels = (uint64_t*)malloc(g->nn * sizeof(*labels));
-    next = (uint64_t*)malloc(g->nn * sizeof(*next));
-    if ((g->nn && !labels) || (g->nn && !next)) {
+    n = view->node_count;
+    labels = (uint64_t*)malloc((n ? n : 1) * sizeof(*labels));
+    next = (uint64_t*)malloc((n ? n : 1) * sizeof(*next));
+    mark = (size_t*)malloc((n ? n : 1) * sizeof(*mark));
+    frequency = (size_t*)calloc(n ? n : 1, sizeof(*frequency));
+    touched = (size_t*)malloc((n ? n : 1) * sizeof(*touched));
+    if (!labels || !next || !mark || !frequency || !touched) {
         free(labels);
         free(next);
+        free(mark);
+        free(frequency);
+        free(touched);
         return NG_OOM;
     }
-    for (i = 0; i < g->nn; i++)
+    for (i = 0; i < n; i++) {
         labels[i] = (uint64_t)i;
+        mark[i] = SIZE_MAX;
+    }
     for (j = 0; j < iterations; j++) {
         int changed = 0;
-        for (i = 0; i < g->nn; i++) {
+        for (i = 0; i < n; i++) {
             uint64_t best = labels[i];
-            size_t best_frequency = 0, candidate;
-            for (candidate = 0; candidate < g->nn; candidate++) {
-                size_t frequency = 0, node_index, edge;
-                int candidate_adjacent = 0;
-                for (edge = 0; edge < g->nr; edge++) {
-                    const rel_i* rel = &g->re[edge];
-                    if (!ng_analytics_rel_ok(rel, type))
-                        continue;
-                    if ((direction == NG_DIRECTION_OUTGOING &&
-                         rel->src == g->no[i].id && rel->dst == g->no[candidate].id) ||
-                        (direction == NG_DIRECTION_INCOMING &&
-                         rel->dst == g->no[i].id && rel->src == g->no[candidate].id) ||
-                        (direction == NG_DIRECTION_EITHER &&
-                         ((rel->src == g->no[i].id && rel->dst == g->no[candidate].id) ||
-                          (rel->dst == g->no[i].id && rel->src == g->no[candidate].id)))) {
-                        candidate_adjacent = 1;
-                        break;
-                    }
-                }
-                if (!candidate_adjacent)
+            size_t best_frequency = 0, row_count, touched_count = 0, k;
+            const size_t* row = ng_analytics_view_row(view, 0, i, &row_count);
+            for (k = 0; k < row_count; k++) {
+                size_t other = row[k];
+                if (mark[other] == i)
                     continue;
-                for (node_index = 0; node_index < g->nn; node_index++) {
-                    for (edge = 0; edge < g->nr; edge++) {
-                        const rel_i* rel = &g->re[edge];
-                        if (!ng_analytics_rel_ok(rel, type))
-                            continue;
-                        if (labels[node_index] != labels[candidate])
-                            break;
-                        if ((direction == NG_DIRECTION_OUTGOING &&
-                             rel->src == g->no[i].id && rel->dst == g->no[node_index].id) ||
-                            (direction == NG_DIRECTION_INCOMING &&
-                             rel->dst == g->no[i].id && rel->src == g->no[node_index].id) ||
-                            (direction == NG_DIRECTION_EITHER &&
-                             ((rel->src == g->no[i].id && rel->dst == g->no[node_index].id) ||
-                              (rel->dst == g->no[i].id && rel->src == g->no[node_index].id)))) {
-                            frequency++;
-                            break;
-                        }
-                    }
-                }
-                if (frequency > best_frequency ||
-                    (frequency == best_frequency && labels[candidate] < best)) {
-                    best = labels[candidate];
-                    best_frequency = frequency;
+                mark[other] = i;
+                if (!frequency[labels[other]]++)
+                    touched[touched_count++] = (size_t)labels[other];
+            }
+            for (k = 0; k < touched_count; k++) {
+                size_t label = touched[k];
+                if (frequency[label] > best_frequency ||
+                    (frequency[label] == best_frequency && (uint64_t)label < best)) {
+                    best = (uint64_t)label;
+                    best_frequency = frequency[label];
                 }
+                frequency[label] = 0;
             }
+            for (k = 0; k < row_count; k++)
+                mark[row[k]] = SIZE_MAX;
             next[i] = best;
             if (next[i] != labels[i])
                 changed = 1;
         }
-        memcpy(labels, next, g->nn * sizeof(*labels));
+        memcpy(labels, next, n * sizeof(*labels));
         if (!changed)
             break;
     }
-    for (i = 0; i < g->nn; i++) {
-        out[i].node = g->no[i].id;
+    for (i = 0; i < n; i++) {
+        out[i].node = view->nodes[i];
         out[i].component = labels[i];
     }
     free(labels);
     free(next);
+    free(mark);
+    free(frequency);
+    free(touched);
     return NG_OK;
 }
+ng_status ng_label_propagation(const ng_graph* g,
+                               ng_direction direction,
+                               ng_symbol_id type,
+                               uint32_t iterations,
+                               ng_node_component* out,
+                               size_t capacity,
+                               size_t* out_count) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (direction > NG_DIRECTION_EITHER || !iterations)
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, direction, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_label_propagation_view(view, iterations, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
 ng_status ng_knn(const ng_graph* g,
                  ng_node_id source,
                  ng_direction direction,
@@ -1995,76 +2373,93 @@ ng_status ng_knn_filtered(const ng_graph* g,
     free(ranked);
     return NG_OK;
 }
-ng_status ng_louvain(const ng_graph* g,
-                     ng_symbol_id type,
-                     uint32_t iterations,
-                     ng_node_component* out,
-                     size_t capacity,
-                     size_t* out_count) {
+/* Local-move pass with the historical tie rules: the best positive gain wins, otherwise the lowest
+ * community with zero gain (empty communities included) if it is below the current one. */
+ng_status ng_louvain_view(const ng_analytics_view* view,
+                          uint32_t iterations,
+                          ng_node_component* out,
+                          size_t capacity,
+                          size_t* out_count) {
     uint64_t* community;
-    double* degree;
-    double* total;
-    size_t i, j;
+    double *degree, *total, *links;
+    size_t *touched, *mark, i, j, n, side, k, row_count;
     ng_status s;
-    if (!g || !iterations || !ng_analytics_symbol_ok(g, type))
+    if (!iterations)
         return NG_INVALID_ARGUMENT;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    s = ng_analytics_view_check(view, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    community = (uint64_t*)malloc(g->nn * sizeof(*community));
-    degree = (double*)calloc(g->nn, sizeof(*degree));
-    total = (double*)calloc(g->nn, sizeof(*total));
-    if ((g->nn && !community) || (g->nn && (!degree || !total))) {
+    n = view->node_count;
+    community = (uint64_t*)malloc((n ? n : 1) * sizeof(*community));
+    degree = (double*)calloc(n ? n : 1, sizeof(*degree));
+    total = (double*)calloc(n ? n : 1, sizeof(*total));
+    links = (double*)calloc(n ? n : 1, sizeof(*links));
+    touched = (size_t*)malloc((n ? n : 1) * sizeof(*touched));
+    mark = (size_t*)malloc((n ? n : 1) * sizeof(*mark));
+    if (!community || !degree || !total || !links || !touched || !mark) {
         free(community);
         free(degree);
         free(total);
+        free(links);
+        free(touched);
+        free(mark);
         return NG_OOM;
     }
-    for (i = 0; i < g->nn; i++)
+    for (i = 0; i < n; i++) {
         community[i] = (uint64_t)i;
-    for (i = 0; i < g->nr; i++) {
-        const rel_i* rel = &g->re[i];
-        size_t a, b;
-        if (!ng_analytics_rel_ok(rel, type))
-            continue;
-        a = ng_node_position(g, rel->src);
-        b = ng_node_position(g, rel->dst);
-        if (a != SIZE_MAX && b != SIZE_MAX) {
-            degree[a] += 1.0;
-            degree[b] += 1.0;
+        mark[i] = SIZE_MAX;
+        for (side = 0; side < ng_analytics_view_sides(view); side++) {
+            const size_t* row = ng_analytics_view_row(view, side, i, &row_count);
+            for (k = 0; k < row_count; k++)
+                if (row[k] != i)
+                    degree[i] += 1.0;
+                else if (!side)
+                    degree[i] += 2.0;
         }
-    }
-    for (i = 0; i < g->nn; i++)
         total[i] = degree[i];
+    }
     for (j = 0; j < iterations; j++) {
         int changed = 0;
-        for (i = 0; i < g->nn; i++) {
-            uint64_t old = community[i], best = community[i];
+        for (i = 0; i < n; i++) {
+            uint64_t old = community[i], best = community[i], zero = community[i];
             double best_gain = 0.0;
-            size_t candidate;
+            size_t touched_count = 0, c;
             total[old] -= degree[i];
-            for (candidate = 0; candidate < g->nn; candidate++) {
-                double links = 0.0, gain;
-                size_t edge;
-                for (edge = 0; edge < g->nr; edge++) {
-                    const rel_i* rel = &g->re[edge];
-                    size_t other = SIZE_MAX;
-                    if (!ng_analytics_rel_ok(rel, type))
+            for (side = 0; side < ng_analytics_view_sides(view); side++) {
+                const size_t* row = ng_analytics_view_row(view, side, i, &row_count);
+                for (k = 0; k < row_count; k++) {
+                    if (side && row[k] == i)
                         continue;
-                    if (rel->src == g->no[i].id)
-                        other = ng_node_position(g, rel->dst);
-                    else if (rel->dst == g->no[i].id)
-                        other = ng_node_position(g, rel->src);
-                    if (other != SIZE_MAX && community[other] == (uint64_t)candidate)
-                        links += 1.0;
+                    c = (size_t)community[row[k]];
+                    if (mark[c] != i) {
+                        mark[c] = i;
+                        links[c] = 0.0;
+                        touched[touched_count++] = c;
+                    }
+                    links[c] += 1.0;
                 }
-                gain = links - degree[i] * total[candidate] / 2.0;
-                if (gain > best_gain ||
-                    (gain == best_gain && (uint64_t)candidate < best)) {
-                    best = (uint64_t)candidate;
+            }
+            for (k = 0; k < touched_count; k++) {
+                double gain;
+                c = touched[k];
+                gain = links[c] - degree[i] * total[c] / 2.0;
+                if (gain > best_gain || (gain == best_gain && (uint64_t)c < best)) {
+                    best = (uint64_t)c;
                     best_gain = gain;
                 }
+                if (gain == 0.0 && (uint64_t)c < zero)
+                    zero = (uint64_t)c;
+            }
+            if (best_gain <= 0.0) {
+                for (c = 0; (uint64_t)c < zero; c++)
+                    if (mark[c] != i && degree[i] * total[c] == 0.0) {
+                        zero = (uint64_t)c;
+                        break;
+                    }
+                best = zero;
             }
+            for (k = 0; k < touched_count; k++)
+                mark[touched[k]] = SIZE_MAX;
             community[i] = best;
             total[best] += degree[i];
             if (best != old)
@@ -2073,128 +2468,786 @@ ng_status ng_louvain(const ng_graph* g,
         if (!changed)
             break;
     }
-    for (i = 0; i < g->nn; i++) {
-        out[i].node = g->no[i].id;
+    for (i = 0; i < n; i++) {
+        out[i].node = view->nodes[i];
         out[i].component = community[i];
     }
     free(community);
     free(degree);
     free(total);
+    free(links);
+    free(touched);
+    free(mark);
     return NG_OK;
 }
-ng_status ng_dijkstra(const ng_graph* g,
-                      ng_node_id start,
-                      ng_node_id target,
-                      ng_direction direction,
-                      ng_symbol_id type,
-                      ng_symbol_id weight_key,
-                      ng_node_id* out_path,
-                      size_t capacity,
-                      size_t* out_count,
-                      double* out_distance) {
-    size_t source, destination, i, path_count = 0, path_length;
-    double* distance;
-    size_t* previous;
-    unsigned char* used;
-    if (!g || direction > NG_DIRECTION_EITHER || !ng_analytics_symbol_ok(g, type) ||
-        (weight_key && !ng_analytics_symbol_ok(g, weight_key)))
+ng_status ng_louvain(const ng_graph* g,
+                     ng_symbol_id type,
+                     uint32_t iterations,
+                     ng_node_component* out,
+                     size_t capacity,
+                     size_t* out_count) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (!g || !iterations || !ng_analytics_symbol_ok(g, type))
         return NG_INVALID_ARGUMENT;
-    source = ng_node_position(g, start);
-    destination = ng_node_position(g, target);
-    if (source == SIZE_MAX || destination == SIZE_MAX)
-        return NG_NOT_FOUND;
-    distance = (double*)malloc(g->nn * sizeof(*distance));
-    previous = (size_t*)malloc(g->nn * sizeof(*previous));
-    used = (unsigned char*)calloc(g->nn, 1);
-    if ((g->nn && !distance) || (g->nn && (!previous || !used))) {
-        free(distance);
-        free(previous);
-        free(used);
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, NG_DIRECTION_EITHER, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_louvain_view(view, iterations, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+/* Weighted undirected adjacency for one multilevel Louvain level; a self-loop entry holds twice
+ * its weight, so degree sums to total (2m) and aggregation keeps internal weight as self-loops. */
+typedef struct {
+    size_t node_count;
+    size_t *offsets, *targets;
+    double *weights, *degree, total;
+} ng_community_level;
+typedef struct {
+    size_t *community, *refined, *node_of, *mark, *touched, *position, *start, *members;
+    double *tot, *links, *refined_tot, *external;
+    unsigned char* singleton;
+} ng_community_work;
+static void ng_community_level_free(ng_community_level* l) {
+    free(l->offsets);
+    free(l->targets);
+    free(l->weights);
+    free(l->degree);
+    memset(l, 0, sizeof(*l));
+}
+static ng_status ng_community_level_from_view(const ng_analytics_view* v, ng_community_level* l) {
+    size_t n = v->node_count, i, k, side, count, e = 0;
+    memset(l, 0, sizeof(*l));
+    l->node_count = n;
+    l->offsets = (size_t*)malloc((n + 1) * sizeof(*l->offsets));
+    l->degree = (double*)calloc(n ? n : 1, sizeof(*l->degree));
+    if (!l->offsets || !l->degree) {
+        ng_community_level_free(l);
         return NG_OOM;
     }
-    for (i = 0; i < g->nn; i++) {
-        distance[i] = 1e300;
-        previous[i] = SIZE_MAX;
+    l->offsets[0] = 0;
+    for (i = 0; i < n; i++) {
+        size_t entries = 0;
+        for (side = 0; side < ng_analytics_view_sides(v); side++) {
+            const size_t* row = ng_analytics_view_row(v, side, i, &count);
+            for (k = 0; k < count; k++)
+                if (!side || row[k] != i)
+                    entries++;
+        }
+        l->offsets[i + 1] = l->offsets[i] + entries;
+    }
+    l->targets = (size_t*)malloc((l->offsets[n] ? l->offsets[n] : 1) * sizeof(*l->targets));
+    l->weights = (double*)malloc((l->offsets[n] ? l->offsets[n] : 1) * sizeof(*l->weights));
+    if (!l->targets || !l->weights) {
+        ng_community_level_free(l);
+        return NG_OOM;
     }
-    distance[source] = 0;
-    for (;;) {
-        size_t current = SIZE_MAX;
-        for (i = 0; i < g->nn; i++)
-            if (!used[i] && (current == SIZE_MAX || distance[i] < distance[current]))
-                current = i;
-        if (current == SIZE_MAX || distance[current] >= 1e299)
-            break;
-        used[current] = 1;
-        if (current == destination)
-            break;
-        for (i = 0; i < g->nr; i++) {
-            const rel_i* r = &g->re[i];
-            size_t next = SIZE_MAX;
-            double weight = 1.0;
-            const prop* property;
-            if (!ng_analytics_rel_ok(r, type))
-                continue;
-            if (direction == NG_DIRECTION_OUTGOING && r->src == g->no[current].id)
-                next = ng_node_position(g, r->dst);
-            else if (direction == NG_DIRECTION_INCOMING && r->dst == g->no[current].id)
-                next = ng_node_position(g, r->src);
-            else if (direction == NG_DIRECTION_EITHER) {
-                if (r->src == g->no[current].id)
-                    next = ng_node_position(g, r->dst);
-                else if (r->dst == g->no[current].id)
-                    next = ng_node_position(g, r->src);
-            }
-            if (next == SIZE_MAX || used[next])
-                continue;
-            if (weight_key) {
-                property = findprop(r->p, r->np, weight_key);
-                if (property) {
-                    if (property->v.type == NG_VALUE_INT64)
-                        weight = (double)property->v.as.integer;
-                    else if (property->v.type == NG_VALUE_DOUBLE)
-                        weight = property->v.as.real;
-                    else
-                        return (free(distance), free(previous), free(used), NG_PARSE_ERROR);
-                    if (weight < 0)
-                        return (free(distance), free(previous), free(used), NG_PARSE_ERROR);
+    for (i = 0; i < n; i++)
+        for (side = 0; side < ng_analytics_view_sides(v); side++) {
+            const size_t* row = ng_analytics_view_row(v, side, i, &count);
+            const double* weights = side ? v->in_weights : v->out_weights;
+            size_t base = side ? v->in_offsets[i] : v->out_offsets[i];
+            for (k = 0; k < count; k++) {
+                double weight = weights ? weights[base + k] : 1.0;
+                if (side && row[k] == i)
+                    continue;
+                if (isnan(weight) || weight < 0) {
+                    ng_community_level_free(l);
+                    return NG_PARSE_ERROR;
                 }
-            }
-            if (distance[current] + weight < distance[next]) {
-                distance[next] = distance[current] + weight;
-                previous[next] = current;
+                if (row[k] == i)
+                    weight *= 2.0;
+                l->targets[e] = row[k];
+                l->weights[e++] = weight;
+                l->degree[i] += weight;
+                l->total += weight;
             }
         }
+    return NG_OK;
+}
+/* Sums the weight from node to each label of its neighbors (restricted to the node's community
+ * when `within`), leaving the labels in touched and the sums in links. */
+static size_t ng_community_gather(const ng_community_level* l,
+                                  ng_community_work* w,
+                                  const size_t* label,
+                                  size_t node,
+                                  int within) {
+    size_t e, count = 0;
+    for (e = l->offsets[node]; e < l->offsets[node + 1]; e++) {
+        size_t j = l->targets[e], c;
+        if (j == node || (within && w->community[j] != w->community[node]))
+            continue;
+        c = label[j];
+        if (w->mark[c] != node) {
+            w->mark[c] = node;
+            w->links[c] = 0.0;
+            w->touched[count++] = c;
+        }
+        w->links[c] += l->weights[e];
     }
-    if (distance[destination] >= 1e299) {
-        free(distance);
-        free(previous);
-        free(used);
-        if (out_count)
-            *out_count = 0;
-        return NG_NOT_FOUND;
+    return count;
+}
+static void ng_community_release(ng_community_work* w, size_t count) {
+    size_t k;
+    for (k = 0; k < count; k++)
+        w->mark[w->touched[k]] = SIZE_MAX;
+}
+/* Sweeps nodes in order, moving each to the neighboring community with the best modularity gain;
+ * ties keep the current community, then prefer the lower id. Returns whether any node moved. */
+static int ng_community_move(const ng_community_level* l,
+                             ng_community_work* w,
+                             uint32_t iterations,
+                             double tolerance) {
+    size_t i, k, count;
+    uint32_t j;
+    int moved = 0;
+    for (j = 0; j < iterations; j++) {
+        double improvement = 0.0;
+        int changed = 0;
+        for (i = 0; i < l->node_count; i++) {
+            size_t old = w->community[i], best = old;
+            double degree = l->degree[i], stay, best_gain;
+            count = ng_community_gather(l, w, w->community, i, 0);
+            w->tot[old] -= degree;
+            stay = (w->mark[old] == i ? w->links[old] : 0.0) - degree * w->tot[old] / l->total;
+            best_gain = stay;
+            for (k = 0; k < count; k++) {
+                size_t c = w->touched[k];
+                double gain = w->links[c] - degree * w->tot[c] / l->total;
+                if (gain > best_gain || (gain == best_gain && best != old && c < best)) {
+                    best = c;
+                    best_gain = gain;
+                }
+            }
+            ng_community_release(w, count);
+            w->community[i] = best;
+            w->tot[best] += degree;
+            if (best != old) {
+                changed = moved = 1;
+                improvement += best_gain - stay;
+            }
+        }
+        if (!changed || 2.0 * improvement / l->total <= tolerance)
+            break;
     }
-    for (i = destination;; i = previous[i]) {
-        path_count++;
-        if (i == source)
+    return moved;
+}
+/* Leiden refinement: inside each community, singleton nodes that are well connected to it merge
+ * greedily into well-connected subcommunities, so aggregated nodes are never disconnected. */
+static void ng_community_refine(const ng_community_level* l, ng_community_work* w) {
+    size_t n = l->node_count, i, k, e, count;
+    for (i = 0; i < n; i++) {
+        w->refined[i] = i;
+        w->refined_tot[i] = l->degree[i];
+        w->singleton[i] = 1;
+        w->external[i] = 0.0;
+        for (e = l->offsets[i]; e < l->offsets[i + 1]; e++)
+            if (l->targets[e] != i && w->community[l->targets[e]] == w->community[i])
+                w->external[i] += l->weights[e];
+    }
+    for (i = 0; i < n; i++) {
+        size_t community = w->community[i], best = i;
+        double degree = l->degree[i], best_gain = 0.0;
+        if (!w->singleton[i] ||
+            w->external[i] < degree * (w->tot[community] - degree) / l->total)
+            continue;
+        count = ng_community_gather(l, w, w->refined, i, 1);
+        for (k = 0; k < count; k++) {
+            size_t c = w->touched[k];
+            double size = w->refined_tot[c], gain;
+            if (w->external[c] < size * (w->tot[community] - size) / l->total)
+                continue;
+            gain = w->links[c] - degree * size / l->total;
+            if (gain > best_gain || (gain == best_gain && best != i && c < best)) {
+                best = c;
+                best_gain = gain;
+            }
+        }
+        if (best != i) {
+            w->external[best] += w->external[i] - 2.0 * w->links[best];
+            w->refined_tot[best] += degree;
+            w->refined_tot[i] = 0.0;
+            w->refined[i] = best;
+            w->singleton[i] = w->singleton[best] = 0;
+        }
+        ng_community_release(w, count);
+    }
+}
+/* Collapses each refined label into one node of `next` and carries the community assignment and
+ * the original-node mapping over to the new node ids. */
+static ng_status ng_community_aggregate(const ng_community_level* l,
+                                        ng_community_work* w,
+                                        ng_community_level* next) {
+    size_t n = l->node_count, count = 0, i, d, k, e, entries = 0;
+    for (i = 0; i < n; i++)
+        w->position[i] = SIZE_MAX;
+    for (i = 0; i < n; i++)
+        if (w->position[w->refined[i]] == SIZE_MAX)
+            w->position[w->refined[i]] = count++;
+    memset(next, 0, sizeof(*next));
+    next->node_count = count;
+    next->total = l->total;
+    next->offsets = (size_t*)malloc((count + 1) * sizeof(*next->offsets));
+    next->degree = (double*)calloc(count ? count : 1, sizeof(*next->degree));
+    next->targets = (size_t*)malloc((l->offsets[n] ? l->offsets[n] : 1) * sizeof(*next->targets));
+    next->weights = (double*)malloc((l->offsets[n] ? l->offsets[n] : 1) * sizeof(*next->weights));
+    if (!next->offsets || !next->degree || !next->targets || !next->weights) {
+        ng_community_level_free(next);
+        return NG_OOM;
+    }
+    for (d = 0; d <= count; d++)
+        w->start[d] = 0;
+    for (i = 0; i < n; i++)
+        w->start[w->position[w->refined[i]] + 1]++;
+    for (d = 0; d < count; d++)
+        w->start[d + 1] += w->start[d];
+    for (i = 0; i < n; i++)
+        w->members[w->start[w->position[w->refined[i]]]++] = i;
+    for (d = count; d > 0; d--)
+        w->start[d] = w->start[d - 1];
+    w->start[0] = 0;
+    next->offsets[0] = 0;
+    for (d = 0; d < count; d++) {
+        size_t touched = 0;
+        for (k = w->start[d]; k < w->start[d + 1]; k++) {
+            i = w->members[k];
+            next->degree[d] += l->degree[i];
+            for (e = l->offsets[i]; e < l->offsets[i + 1]; e++) {
+                size_t c = w->position[w->refined[l->targets[e]]];
+                if (w->mark[c] != d) {
+                    w->mark[c] = d;
+                    w->links[c] = 0.0;
+                    w->touched[touched++] = c;
+                }
+                w->links[c] += l->weights[e];
+            }
+        }
+        for (k = 0; k < touched; k++) {
+            next->targets[entries] = w->touched[k];
+            next->weights[entries++] = w->links[w->touched[k]];
+        }
+        ng_community_release(w, touched);
+        next->offsets[d + 1] = entries;
+    }
+    for (d = 0; d < count; d++) {
+        size_t community = w->community[w->members[w->start[d]]];
+        if (w->mark[community] == SIZE_MAX)
+            w->mark[community] = d;
+        w->touched[d] = w->mark[community];
+    }
+    for (d = 0; d < count; d++)
+        w->mark[w->community[w->members[w->start[d]]]] = SIZE_MAX;
+    for (d = 0; d < count; d++) {
+        w->community[d] = w->touched[d];
+        w->tot[d] = 0.0;
+    }
+    for (d = 0; d < count; d++)
+        w->tot[w->community[d]] += next->degree[d];
+    return NG_OK;
+}
+static double ng_community_modularity(const ng_community_level* l, const ng_community_work* w) {
+    double inside = 0.0, q;
+    size_t i, e;
+    for (i = 0; i < l->node_count; i++)
+        for (e = l->offsets[i]; e < l->offsets[i + 1]; e++)
+            if (w->community[l->targets[e]] == w->community[i])
+                inside += l->weights[e];
+    q = inside / l->total;
+    for (i = 0; i < l->node_count; i++)
+        q -= (w->tot[i] / l->total) * (w->tot[i] / l->total);
+    return q;
+}
+ng_status ng_louvain_multilevel_view(const ng_analytics_view* view,
+                                     const ng_louvain_options* options,
+                                     ng_node_component* out,
+                                     size_t capacity,
+                                     size_t* out_count,
+                                     ng_louvain_report* report) {
+    ng_community_level level, next;
+    ng_community_work w;
+    uint32_t max_levels = 10, iterations = 20, levels = 0;
+    double tolerance = 0.0, modularity = 0.0;
+    int leiden = 0;
+    size_t n, i, communities = 0;
+    ng_status s;
+    if (options) {
+        if (options->max_levels)
+            max_levels = options->max_levels;
+        if (options->max_iterations)
+            iterations = options->max_iterations;
+        tolerance = options->tolerance;
+        leiden = options->leiden;
+    }
+    if (!(tolerance >= 0.0))
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_view_check(view, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_community_level_from_view(view, &level);
+    if (s != NG_OK)
+        return s;
+    n = view->node_count ? view->node_count : 1;
+    memset(&w, 0, sizeof(w));
+    w.community = (size_t*)malloc(n * sizeof(*w.community));
+    w.refined = (size_t*)malloc(n * sizeof(*w.refined));
+    w.node_of = (size_t*)malloc(n * sizeof(*w.node_of));
+    w.mark = (size_t*)malloc(n * sizeof(*w.mark));
+    w.touched = (size_t*)malloc(n * sizeof(*w.touched));
+    w.position = (size_t*)malloc(n * sizeof(*w.position));
+    w.start = (size_t*)malloc((n + 1) * sizeof(*w.start));
+    w.members = (size_t*)malloc(n * sizeof(*w.members));
+    w.tot = (double*)malloc(n * sizeof(*w.tot));
+    w.links = (double*)malloc(n * sizeof(*w.links));
+    w.refined_tot = (double*)malloc(n * sizeof(*w.refined_tot));
+    w.external = (double*)malloc(n * sizeof(*w.external));
+    w.singleton = (unsigned char*)malloc(n);
+    if (!w.community || !w.refined || !w.node_of || !w.mark || !w.touched || !w.position ||
+        !w.start || !w.members || !w.tot || !w.links || !w.refined_tot || !w.external ||
+        !w.singleton) {
+        s = NG_OOM;
+        goto done;
+    }
+    for (i = 0; i < view->node_count; i++) {
+        w.community[i] = w.node_of[i] = i;
+        w.mark[i] = SIZE_MAX;
+        w.tot[i] = level.degree[i];
+    }
+    while (level.total > 0.0) {
+        if (ng_community_move(&level, &w, iterations, tolerance) || !levels) {
+            double q = ng_community_modularity(&level, &w);
+            int last = levels + 1 == max_levels || (levels && q - modularity <= tolerance);
+            if (report && report->level_modularity && levels < report->level_capacity)
+                report->level_modularity[levels] = q;
+            levels++;
+            modularity = q;
+            if (last)
+                break;
+        } else if (!leiden) {
+            break;
+        }
+        if (leiden)
+            ng_community_refine(&level, &w);
+        else
+            memcpy(w.refined, w.community, level.node_count * sizeof(*w.refined));
+        for (i = 0; i < view->node_count; i++)
+            w.node_of[i] = w.refined[w.node_of[i]];
+        s = ng_community_aggregate(&level, &w, &next);
+        if (s != NG_OK)
+            goto done;
+        for (i = 0; i < view->node_count; i++)
+            w.node_of[i] = w.position[w.node_of[i]];
+        i = next.node_count;
+        ng_community_level_free(&level);
+        level = next;
+        if (i == n)
             break;
+        n = i;
     }
-    path_length = path_count;
-    if (!out_count || capacity < path_length || !out_path) {
-        free(distance);
-        free(previous);
-        free(used);
-        return NG_LIMIT;
+    for (i = 0; i < view->node_count; i++)
+        w.mark[i] = SIZE_MAX;
+    for (i = 0; i < view->node_count; i++) {
+        size_t c = w.community[w.node_of[i]];
+        if (w.mark[c] == SIZE_MAX)
+            w.mark[c] = communities++;
+        out[i].node = view->nodes[i];
+        out[i].component = (uint64_t)w.mark[c];
     }
-    for (i = destination; i != SIZE_MAX; i = previous[i])
-        out_path[--path_count] = g->no[i].id;
-    *out_count = path_length;
-    if (out_distance)
-        *out_distance = distance[destination];
-    free(distance);
-    free(previous);
-    free(used);
+    if (report) {
+        report->levels = levels;
+        report->communities = (uint64_t)communities;
+        report->modularity = modularity;
+    }
+done:
+    ng_community_level_free(&level);
+    free(w.community);
+    free(w.refined);
+    free(w.node_of);
+    free(w.mark);
+    free(w.touched);
+    free(w.position);
+    free(w.start);
+    free(w.members);
+    free(w.tot);
+    free(w.links);
+    free(w.refined_tot);
+    free(w.external);
+    free(w.singleton);
+    return s;
+}
+ng_status ng_louvain_multilevel(const ng_graph* g,
+                                ng_symbol_id type,
+                                ng_symbol_id weight_key,
+                                const ng_louvain_options* options,
+                                ng_node_component* out,
+                                size_t capacity,
+                                size_t* out_count,
+                                ng_louvain_report* report) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (!g)
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, NG_DIRECTION_EITHER, type, weight_key, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_louvain_multilevel_view(view, options, out, capacity, out_count, report);
+    ng_analytics_view_free(view);
+    return s;
+}
+typedef struct {
+    size_t *items, *slot, count;
+    const double* key;
+} ng_path_heap;
+static int ng_path_heap_less(const ng_path_heap* h, size_t a, size_t b) {
+    return h->key[a] < h->key[b] || (h->key[a] == h->key[b] && a < b);
+}
+static void ng_path_heap_swap(ng_path_heap* h, size_t i, size_t j) {
+    size_t t = h->items[i];
+    h->items[i] = h->items[j];
+    h->items[j] = t;
+    h->slot[h->items[i]] = i;
+    h->slot[h->items[j]] = j;
+}
+/* Inserts node, or restores heap order after its key decreased. */
+static void ng_path_heap_update(ng_path_heap* h, size_t node) {
+    size_t i = h->slot[node];
+    if (i == SIZE_MAX) {
+        i = h->count++;
+        h->items[i] = node;
+        h->slot[node] = i;
+    }
+    while (i && ng_path_heap_less(h, h->items[i], h->items[(i - 1) / 2])) {
+        ng_path_heap_swap(h, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+static size_t ng_path_heap_pop(ng_path_heap* h) {
+    size_t top = h->items[0], i = 0;
+    ng_path_heap_swap(h, 0, --h->count);
+    h->slot[top] = SIZE_MAX;
+    for (;;) {
+        size_t left = 2 * i + 1, right = left + 1, m = i;
+        if (left < h->count && ng_path_heap_less(h, h->items[left], h->items[m]))
+            m = left;
+        if (right < h->count && ng_path_heap_less(h, h->items[right], h->items[m]))
+            m = right;
+        if (m == i)
+            break;
+        ng_path_heap_swap(h, i, m);
+        i = m;
+    }
+    return top;
+}
+/* One search frontier; score aliases distance unless a heuristic adds estimates. */
+typedef struct {
+    double *distance, *score;
+    size_t* previous;
+    unsigned char* used;
+    ng_path_heap heap;
+} ng_path_side;
+static void ng_path_side_free(ng_path_side* p) {
+    if (p->score != p->distance)
+        free(p->score);
+    free(p->distance);
+    free(p->previous);
+    free(p->used);
+    free(p->heap.items);
+    free(p->heap.slot);
+}
+static ng_status ng_path_side_init(ng_path_side* p, size_t n, int scored) {
+    size_t i, z = n ? n : 1;
+    p->distance = (double*)malloc(z * sizeof(*p->distance));
+    p->score = scored ? (double*)malloc(z * sizeof(*p->score)) : p->distance;
+    p->previous = (size_t*)malloc(z * sizeof(*p->previous));
+    p->used = (unsigned char*)calloc(z, 1);
+    p->heap.items = (size_t*)malloc(z * sizeof(*p->heap.items));
+    p->heap.slot = (size_t*)malloc(z * sizeof(*p->heap.slot));
+    p->heap.count = 0;
+    p->heap.key = p->score;
+    if (!p->distance || !p->score || !p->previous || !p->used || !p->heap.items ||
+        !p->heap.slot)
+        return NG_OOM;
+    for (i = 0; i < n; i++) {
+        p->distance[i] = p->score[i] = 1e300;
+        p->previous[i] = p->heap.slot[i] = SIZE_MAX;
+    }
+    return NG_OK;
+}
+static ng_status ng_path_search(const ng_analytics_view* v,
+                                size_t source,
+                                size_t destination,
+                                ng_path_heuristic heuristic,
+                                void* context,
+                                ng_path_side* p) {
+    ng_node_id target = v->nodes[destination];
+    p->distance[source] = 0;
+    p->score[source] = heuristic ? heuristic(v->nodes[source], target, context) : 0.0;
+    if (p->score[source] < 0)
+        return NG_INVALID_ARGUMENT;
+    ng_path_heap_update(&p->heap, source);
+    while (p->heap.count) {
+        size_t current = ng_path_heap_pop(&p->heap), e;
+        if (p->score[current] >= 1e299)
+            break;
+        p->used[current] = 1;
+        if (current == destination)
+            break;
+        for (e = v->out_offsets[current]; e < v->out_offsets[current + 1]; e++) {
+            size_t next = v->out_nodes[e];
+            double weight = v->out_weights ? v->out_weights[e] : 1.0, estimate = 0.0, candidate;
+            if (p->used[next])
+                continue;
+            if (isnan(weight) || weight < 0)
+                return NG_PARSE_ERROR;
+            candidate = p->distance[current] + weight;
+            if (candidate >= p->distance[next])
+                continue;
+            if (heuristic && (estimate = heuristic(v->nodes[next], target, context)) < 0)
+                return NG_INVALID_ARGUMENT;
+            p->distance[next] = candidate;
+            if (p->score != p->distance)
+                p->score[next] = candidate + estimate;
+            p->previous[next] = current;
+            ng_path_heap_update(&p->heap, next);
+        }
+    }
+    return NG_OK;
+}
+/* Forward search over out rows and backward search over in rows, always expanding the frontier
+ * with the smaller key; stops once the two minimum keys cannot improve the best meeting point. */
+static ng_status ng_path_bidirectional(const ng_analytics_view* v,
+                                       size_t source,
+                                       size_t destination,
+                                       ng_path_side* sides,
+                                       size_t* meet) {
+    double best = 1e300;
+    *meet = SIZE_MAX;
+    sides[0].distance[source] = 0;
+    sides[1].distance[destination] = 0;
+    ng_path_heap_update(&sides[0].heap, source);
+    ng_path_heap_update(&sides[1].heap, destination);
+    if (source == destination) {
+        best = 0;
+        *meet = source;
+    }
+    while (sides[0].heap.count && sides[1].heap.count) {
+        double front = sides[0].distance[sides[0].heap.items[0]];
+        double back = sides[1].distance[sides[1].heap.items[0]];
+        size_t d = front <= back ? 0 : 1, current, e, count, base;
+        ng_path_side* p = &sides[d];
+        const ng_path_side* other = &sides[!d];
+        const double* weights = d ? v->in_weights : v->out_weights;
+        const size_t* row;
+        if (front + back >= best)
+            break;
+        current = ng_path_heap_pop(&p->heap);
+        p->used[current] = 1;
+        row = ng_analytics_view_row(v, d, current, &count);
+        base = (d ? v->in_offsets : v->out_offsets)[current];
+        for (e = 0; e < count; e++) {
+            size_t next = row[e];
+            double weight = weights ? weights[base + e] : 1.0;
+            if (p->used[next])
+                continue;
+            if (isnan(weight) || weight < 0)
+                return NG_PARSE_ERROR;
+            if (p->distance[current] + weight >= p->distance[next])
+                continue;
+            p->distance[next] = p->distance[current] + weight;
+            p->previous[next] = current;
+            ng_path_heap_update(&p->heap, next);
+            if (other->distance[next] < 1e299 && p->distance[next] + other->distance[next] < best) {
+                best = p->distance[next] + other->distance[next];
+                *meet = next;
+            }
+        }
+    }
+    return NG_OK;
+}
+/* Writes source..meet from previous links, then meet..target from next links when present. */
+static ng_status ng_path_emit(const ng_analytics_view* v,
+                              const size_t* previous,
+                              const size_t* next,
+                              size_t meet,
+                              ng_node_id* out_path,
+                              size_t capacity,
+                              size_t* out_count) {
+    size_t i, before = 0, after = 0, k;
+    for (i = meet; i != SIZE_MAX; i = previous[i])
+        before++;
+    for (i = next ? next[meet] : SIZE_MAX; i != SIZE_MAX; i = next[i])
+        after++;
+    if (!out_count || capacity < before + after || !out_path)
+        return NG_LIMIT;
+    k = before;
+    for (i = meet; i != SIZE_MAX; i = previous[i])
+        out_path[--k] = v->nodes[i];
+    k = before;
+    for (i = next ? next[meet] : SIZE_MAX; i != SIZE_MAX; i = next[i])
+        out_path[k++] = v->nodes[i];
+    *out_count = before + after;
     return NG_OK;
 }
+static ng_status ng_path_view(const ng_analytics_view* view,
+                              ng_node_id start,
+                              ng_node_id target,
+                              int bidirectional,
+                              ng_path_heuristic heuristic,
+                              void* heuristic_context,
+                              ng_node_id* out_path,
+                              size_t capacity,
+                              size_t* out_count,
+                              double* out_distance) {
+    ng_path_side sides[2];
+    size_t source, destination, meet = SIZE_MAX;
+    ng_status s;
+    if (!view)
+        return NG_INVALID_ARGUMENT;
+    source = ng_analytics_view_position(view, start);
+    destination = ng_analytics_view_position(view, target);
+    if (source == SIZE_MAX || destination == SIZE_MAX)
+        return NG_NOT_FOUND;
+    memset(sides, 0, sizeof(sides));
+    s = ng_path_side_init(&sides[0], view->node_count, heuristic != NULL);
+    if (s == NG_OK && bidirectional)
+        s = ng_path_side_init(&sides[1], view->node_count, 0);
+    if (s == NG_OK && bidirectional)
+        s = ng_path_bidirectional(view, source, destination, sides, &meet);
+    else if (s == NG_OK) {
+        s = ng_path_search(view, source, destination, heuristic, heuristic_context, &sides[0]);
+        if (sides[0].distance[destination] < 1e299)
+            meet = destination;
+    }
+    if (s == NG_OK && meet == SIZE_MAX) {
+        if (out_count)
+            *out_count = 0;
+        s = NG_NOT_FOUND;
+    }
+    if (s == NG_OK)
+        s = ng_path_emit(view,
+                         sides[0].previous,
+                         bidirectional ? sides[1].previous : NULL,
+                         meet,
+                         out_path,
+                         capacity,
+                         out_count);
+    if (s == NG_OK && out_distance)
+        *out_distance =
+            sides[0].distance[meet] + (bidirectional ? sides[1].distance[meet] : 0.0);
+    ng_path_side_free(&sides[0]);
+    ng_path_side_free(&sides[1]);
+    return s;
+}
+static ng_status ng_path_graph(const ng_graph* g,
+                               ng_node_id start,
+                               ng_node_id target,
+                               ng_direction direction,
+                               ng_symbol_id type,
+                               ng_symbol_id weight_key,
+                               int bidirectional,
+                               ng_path_heuristic heuristic,
+                               void* heuristic_context,
+                               ng_node_id* out_path,
+                               size_t capacity,
+                               size_t* out_count,
+                               double* out_distance) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (!g || direction > NG_DIRECTION_EITHER || !ng_analytics_symbol_ok(g, type) ||
+        (weight_key && !ng_analytics_symbol_ok(g, weight_key)))
+        return NG_INVALID_ARGUMENT;
+    if (ng_node_position(g, start) == SIZE_MAX || ng_node_position(g, target) == SIZE_MAX)
+        return NG_NOT_FOUND;
+    s = ng_analytics_view_build(g, direction, type, weight_key, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_path_view(view,
+                     start,
+                     target,
+                     bidirectional,
+                     heuristic,
+                     heuristic_context,
+                     out_path,
+                     capacity,
+                     out_count,
+                     out_distance);
+    ng_analytics_view_free(view);
+    return s;
+}
+ng_status ng_dijkstra_view(const ng_analytics_view* view,
+                           ng_node_id start,
+                           ng_node_id target,
+                           ng_node_id* out_path,
+                           size_t capacity,
+                           size_t* out_count,
+                           double* out_distance) {
+    return ng_path_view(
+        view, start, target, 0, NULL, NULL, out_path, capacity, out_count, out_distance);
+}
+ng_status ng_dijkstra(const ng_graph* g,
+                      ng_node_id start,
+                      ng_node_id target,
+                      ng_direction direction,
+                      ng_symbol_id type,
+                      ng_symbol_id weight_key,
+                      ng_node_id* out_path,
+                      size_t capacity,
+                      size_t* out_count,
+                      double* out_distance) {
+    return ng_path_graph(g,
+                         start,
+                         target,
+                         direction,
+                         type,
+                         weight_key,
+                         0,
+                         NULL,
+                         NULL,
+                         out_path,
+                         capacity,
+                         out_count,
+                         out_distance);
+}
+ng_status ng_bidirectional_dijkstra_view(const ng_analytics_view* view,
+                                         ng_node_id start,
+                                         ng_node_id target,
+                                         ng_node_id* out_path,
+                                         size_t capacity,
+                                         size_t* out_count,
+                                         double* out_distance) {
+    return ng_path_view(
+        view, start, target, 1, NULL, NULL, out_path, capacity, out_count, out_distance);
+}
+ng_status ng_bidirectional_dijkstra(const ng_graph* g,
+                                    ng_node_id start,
+                                    ng_node_id target,
+                                    ng_direction direction,
+                                    ng_symbol_id type,
+                                    ng_symbol_id weight_key,
+                                    ng_node_id* out_path,
+                                    size_t capacity,
+                                    size_t* out_count,
+                                    double* out_distance) {
+    return ng_path_graph(g,
+                         start,
+                         target,
+                         direction,
+                         type,
+                         weight_key,
+                         1,
+                         NULL,
+                         NULL,
+                         out_path,
+                         capacity,
+                         out_count,
+                         out_distance);
+}
 ng_status ng_bfs_path(const ng_graph* g,
                       ng_node_id start,
                       ng_node_id target,
@@ -2392,6 +3445,28 @@ ng_status ng_enumerate_paths(const ng_graph* g,
         *out_count = found;
     return s;
 }
+ng_status ng_a_star_view(const ng_analytics_view* view,
+                         ng_node_id start,
+                         ng_node_id target,
+                         ng_path_heuristic heuristic,
+                         void* heuristic_context,
+                         ng_node_id* out_path,
+                         size_t capacity,
+                         size_t* out_count,
+                         double* out_distance) {
+    if (!heuristic)
+        return NG_INVALID_ARGUMENT;
+    return ng_path_view(view,
+                        start,
+                        target,
+                        0,
+                        heuristic,
+                        heuristic_context,
+                        out_path,
+                        capacity,
+                        out_count,
+                        out_distance);
+}
 ng_status ng_a_star(const ng_graph* g,
                     ng_node_id start,
                     ng_node_id target,
@@ -2404,126 +3479,34 @@ ng_status ng_a_star(const ng_graph* g,
                     size_t capacity,
                     size_t* out_count,
                     double* out_distance) {
-    size_t source, destination, i, path_count = 0, path_length;
-    double* distance;
-    double* score;
-    size_t* previous;
-    unsigned char* used;
-    if (!g || direction > NG_DIRECTION_EITHER || !heuristic ||
-        !ng_analytics_symbol_ok(g, type) ||
-        (weight_key && !ng_analytics_symbol_ok(g, weight_key)))
+    if (!heuristic)
         return NG_INVALID_ARGUMENT;
-    source = ng_node_position(g, start);
-    destination = ng_node_position(g, target);
-    if (source == SIZE_MAX || destination == SIZE_MAX)
-        return NG_NOT_FOUND;
-    distance = (double*)malloc(g->nn * sizeof(*distance));
-    score = (double*)malloc(g->nn * sizeof(*score));
-    previous = (size_t*)malloc(g->nn * sizeof(*previous));
-    used = (unsigned char*)calloc(g->nn, 1);
-    if ((g->nn && (!distance || !score || !previous || !used))) {
-        free(distance);
-        free(score);
-        free(previous);
-        free(used);
-        return NG_OOM;
-    }
-    for (i = 0; i < g->nn; i++) {
-        distance[i] = 1e300;
-        score[i] = 1e300;
-        previous[i] = SIZE_MAX;
-    }
-    distance[source] = 0;
-    score[source] = heuristic(start, target, heuristic_context);
-    if (score[source] < 0)
-        return (free(distance), free(score), free(previous), free(used), NG_INVALID_ARGUMENT);
-    for (;;) {
-        size_t current = SIZE_MAX;
-        for (i = 0; i < g->nn; i++)
-            if (!used[i] && (current == SIZE_MAX || score[i] < score[current]))
-                current = i;
-        if (current == SIZE_MAX || score[current] >= 1e299)
-            break;
-        used[current] = 1;
-        if (current == destination)
-            break;
-        for (i = 0; i < g->nr; i++) {
-            const rel_i* r = &g->re[i];
-            size_t next = SIZE_MAX;
-            double weight = 1.0, estimate, candidate;
-            const prop* property;
-            if (!ng_analytics_rel_ok(r, type))
-                continue;
-            if (direction == NG_DIRECTION_OUTGOING && r->src == g->no[current].id)
-                next = ng_node_position(g, r->dst);
-            else if (direction == NG_DIRECTION_INCOMING && r->dst == g->no[current].id)
-                next = ng_node_position(g, r->src);
-            else if (direction == NG_DIRECTION_EITHER) {
-                if (r->src == g->no[current].id)
-                    next = ng_node_position(g, r->dst);
-                else if (r->dst == g->no[current].id)
-                    next = ng_node_position(g, r->src);
-            }
-            if (next == SIZE_MAX || used[next])
-                continue;
-            if (weight_key) {
-                property = findprop(r->p, r->np, weight_key);
-                if (property) {
-                    if (property->v.type == NG_VALUE_INT64)
-                        weight = (double)property->v.as.integer;
-                    else if (property->v.type == NG_VALUE_DOUBLE)
-                        weight = property->v.as.real;
-                    else
-                        return (free(distance), free(score), free(previous), free(used),
-                                NG_PARSE_ERROR);
-                    if (weight < 0)
-                        return (free(distance), free(score), free(previous), free(used),
-                                NG_PARSE_ERROR);
-                }
-            }
-            candidate = distance[current] + weight;
-            if (candidate >= distance[next])
-                continue;
-            estimate = heuristic(g->no[next].id, target, heuristic_context);
-            if (estimate < 0)
-                return (free(distance), free(score), free(previous), free(used),
-                        NG_INVALID_ARGUMENT);
-            distance[next] = candidate;
-            score[next] = candidate + estimate;
-            previous[next] = current;
-        }
-    }
-    if (distance[destination] >= 1e299) {
-        free(distance);
-        free(score);
-        free(previous);
-        free(used);
-        if (out_count)
-            *out_count = 0;
-        return NG_NOT_FOUND;
-    }
-    for (i = destination;; i = previous[i]) {
-        path_count++;
-        if (i == source)
-            break;
-    }
-    path_length = path_count;
-    if (!out_count || !out_path || capacity < path_length) {
-        free(distance);
-        free(score);
-        free(previous);
-        free(used);
-        return NG_LIMIT;
+    return ng_path_graph(g,
+                         start,
+                         target,
+                         direction,
+                         type,
+                         weight_key,
+                         0,
+                         heuristic,
+                         heuristic_context,
+                         out_path,
+                         capacity,
+                         out_count,
+                         out_distance);
+}
+ng_status ng_degree_centrality_view(const ng_analytics_view* view,
+                                    ng_node_score* out,
+                                    size_t capacity,
+                                    size_t* out_count) {
+    size_t i;
+    ng_status s = ng_analytics_view_check(view, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    for (i = 0; i < view->node_count; i++) {
+        out[i].node = view->nodes[i];
+        out[i].score = (double)(view->out_offsets[i + 1] - view->out_offsets[i]);
     }
-    for (i = destination; i != SIZE_MAX; i = previous[i])
-        out_path[--path_count] = g->no[i].id;
-    *out_count = path_length;
-    if (out_distance)
-        *out_distance = distance[destination];
-    free(distance);
-    free(score);
-    free(previous);
-    free(used);
     return NG_OK;
 }
 ng_status ng_degree_centrality(const ng_graph* g,
@@ -2532,162 +3515,475 @@ ng_status ng_degree_centrality(const ng_graph* g,
                                ng_node_score* out,
                                size_t capacity,
                                size_t* out_count) {
-    size_t i, j;
+    ng_analytics_view* view;
     ng_status s;
-    if (direction > NG_DIRECTION_EITHER)
+    if (!g || direction > NG_DIRECTION_EITHER)
         return NG_INVALID_ARGUMENT;
     s = ng_analytics_check_output(g, type, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    for (i = 0; i < g->nn; i++) {
-        uint64_t degree = 0;
-        for (j = 0; j < g->nr; j++) {
-            const rel_i* r = &g->re[j];
-            if (!ng_analytics_rel_ok(r, type))
-                continue;
-            if (direction == NG_DIRECTION_OUTGOING && r->src == g->no[i].id)
-                degree++;
-            else if (direction == NG_DIRECTION_INCOMING && r->dst == g->no[i].id)
-                degree++;
-            else if (direction == NG_DIRECTION_EITHER &&
-                     (r->src == g->no[i].id || r->dst == g->no[i].id))
-                degree++;
-        }
-        out[i].node = g->no[i].id;
-        out[i].score = (double)degree;
+    s = ng_analytics_view_build(g, direction, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_degree_centrality_view(view, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+/* Pull formulation: each node sums its in-row, so contributions arrive in relationship order. */
+static ng_status ng_pagerank_teleport(const ng_analytics_view* view,
+                                      const ng_pagerank_options* options,
+                                      double* teleport) {
+    size_t i, n = view->node_count;
+    double total = 0.0;
+    if (!options || !options->seed_count) {
+        for (i = 0; i < n; i++)
+            teleport[i] = 1.0 / (double)n;
+        return NG_OK;
     }
+    if (!options->seeds)
+        return NG_INVALID_ARGUMENT;
+    for (i = 0; i < n; i++)
+        teleport[i] = 0.0;
+    for (i = 0; i < options->seed_count; i++) {
+        size_t p = ng_analytics_view_position(view, options->seeds[i]);
+        double w = options->seed_weights ? options->seed_weights[i] : 1.0;
+        if (p == SIZE_MAX)
+            return NG_NOT_FOUND;
+        if (!(w >= 0.0) || isinf(w))
+            return NG_INVALID_ARGUMENT;
+        teleport[p] += w;
+        total += w;
+    }
+    if (!(total > 0.0) || isinf(total))
+        return NG_INVALID_ARGUMENT;
+    for (i = 0; i < n; i++)
+        teleport[i] /= total;
     return NG_OK;
 }
-ng_status ng_pagerank(const ng_graph* g,
-                      ng_symbol_id type,
-                      double damping,
-                      uint32_t iterations,
-                      ng_node_score* out,
-                      size_t capacity,
-                      size_t* out_count) {
-    double *rank, *next;
-    uint64_t* outdeg;
-    size_t i, n;
+ng_status ng_pagerank_view_with_options(const ng_analytics_view* view,
+                                        const ng_pagerank_options* options,
+                                        ng_node_score* out,
+                                        size_t capacity,
+                                        size_t* out_count,
+                                        ng_pagerank_report* report) {
+    const size_t* deg;
+    double *rank, *next, *share, *teleport, damping = 0.85, tolerance = 0.0, delta = 0.0;
+    uint32_t limit = 20, iterations = 0;
+    size_t i, e, n;
+    int converged = 0;
     ng_status s;
-    if (!g)
-        return NG_INVALID_ARGUMENT;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (report)
+        memset(report, 0, sizeof(*report));
+    s = ng_analytics_view_check(view, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    n = g->nn;
+    if (options) {
+        if (options->damping != 0.0)
+            damping = options->damping;
+        if (options->max_iterations)
+            limit = options->max_iterations;
+        tolerance = options->tolerance;
+    }
+    if (!(damping > 0.0 && damping < 1.0) || !(tolerance >= 0.0))
+        return NG_INVALID_ARGUMENT;
+    n = view->node_count;
     if (!n)
         return NG_OK;
-    if (damping <= 0.0 || damping >= 1.0)
-        damping = 0.85;
-    if (!iterations)
-        iterations = 20;
     rank = (double*)malloc(n * sizeof(*rank));
     next = (double*)malloc(n * sizeof(*next));
-    outdeg = (uint64_t*)calloc(n, sizeof(*outdeg));
-    if (!rank || !next || !outdeg) {
+    share = (double*)malloc(n * sizeof(*share));
+    teleport = (double*)malloc(n * sizeof(*teleport));
+    s = !rank || !next || !share || !teleport ? NG_OOM
+                                                : ng_pagerank_teleport(view, options, teleport);
+    if (s != NG_OK) {
         free(rank);
         free(next);
-        free(outdeg);
-        return NG_OOM;
+        free(share);
+        free(teleport);
+        return s;
     }
+    deg = view->out_offsets;
     for (i = 0; i < n; i++)
-        rank[i] = 1.0 / (double)n;
-    for (i = 0; i < g->nr; i++)
-        if (ng_analytics_rel_ok(&g->re[i], type)) {
-            size_t p = ng_node_position(g, g->re[i].src);
-            if (p != SIZE_MAX)
-                outdeg[p]++;
-        }
-    while (iterations--) {
-        double dangling = 0.0;
+        rank[i] = teleport[i];
+    while (iterations < limit) {
+        double dangling = 0.0, *swap;
         for (i = 0; i < n; i++) {
-            next[i] = (1.0 - damping) / (double)n;
-            if (!outdeg[i])
+            size_t d = deg[i + 1] - deg[i];
+            share[i] = d ? rank[i] / (double)d : 0.0;
+            if (!d)
                 dangling += rank[i];
         }
-        for (i = 0; i < n; i++)
-            next[i] += damping * dangling / (double)n;
-        for (i = 0; i < g->nr; i++)
-            if (ng_analytics_rel_ok(&g->re[i], type)) {
-                size_t a = ng_node_position(g, g->re[i].src), b = ng_node_position(g, g->re[i].dst);
-                if (a != SIZE_MAX && b != SIZE_MAX && outdeg[a])
-                    next[b] += damping * rank[a] / (double)outdeg[a];
-            }
-        for (i = 0; i < n; i++)
-            rank[i] = next[i];
+        /* Pull: every row writes only its own entry, so rows are independent. */
+        delta = 0.0;
+        for (i = 0; i < n; i++) {
+            double sum = 0.0;
+            for (e = view->in_offsets[i]; e < view->in_offsets[i + 1]; e++)
+                sum += share[view->in_nodes[e]];
+            next[i] = (1.0 - damping + damping * dangling) * teleport[i] + damping * sum;
+            delta += fabs(next[i] - rank[i]);
+        }
+        swap = rank;
+        rank = next;
+        next = swap;
+        iterations++;
+        if (tolerance > 0.0 && delta <= tolerance) {
+            converged = 1;
+            break;
+        }
+    }
+    if (report) {
+        report->iterations = iterations;
+        report->delta = delta;
+        report->converged = converged;
     }
     for (i = 0; i < n; i++) {
-        out[i].node = g->no[i].id;
+        out[i].node = view->nodes[i];
         out[i].score = rank[i];
     }
     free(rank);
     free(next);
-    free(outdeg);
+    free(share);
+    free(teleport);
+    return NG_OK;
+}
+ng_status ng_pagerank_view(const ng_analytics_view* view,
+                           double damping,
+                           uint32_t iterations,
+                           ng_node_score* out,
+                           size_t capacity,
+                           size_t* out_count) {
+    ng_pagerank_options options;
+    memset(&options, 0, sizeof(options));
+    options.damping = damping > 0.0 && damping < 1.0 ? damping : 0.85;
+    options.max_iterations = iterations;
+    return ng_pagerank_view_with_options(view, &options, out, capacity, out_count, NULL);
+}
+ng_status ng_pagerank(const ng_graph* g,
+                      ng_symbol_id type,
+                      double damping,
+                      uint32_t iterations,
+                      ng_node_score* out,
+                      size_t capacity,
+                      size_t* out_count) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (!g)
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK || !g->nn)
+        return s;
+    s = ng_analytics_view_build(g, NG_DIRECTION_OUTGOING, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_pagerank_view(view, damping, iterations, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+ng_status ng_pagerank_with_options(const ng_graph* g,
+                                   ng_symbol_id type,
+                                   const ng_pagerank_options* options,
+                                   ng_node_score* out,
+                                   size_t capacity,
+                                   size_t* out_count,
+                                   ng_pagerank_report* report) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (report)
+        memset(report, 0, sizeof(*report));
+    if (!g)
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, NG_DIRECTION_OUTGOING, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_pagerank_view_with_options(view, options, out, capacity, out_count, report);
+    ng_analytics_view_free(view);
+    return s;
+}
+/* Sparse per-node state for forward push; only nodes that receive residual get an entry. */
+typedef struct {
+    size_t node;
+    double estimate, residual;
+    int queued;
+} ng_push_entry;
+typedef struct {
+    ng_push_entry* entries;
+    size_t *slots, count, capacity, slot_count;
+    size_t *queue, head, tail, queue_capacity;
+} ng_push_table;
+static size_t ng_push_slot(size_t node, size_t mask) {
+    return (size_t)(((uint64_t)node * 0x9E3779B97F4A7C15ULL) >> 17) & mask;
+}
+static ng_status ng_push_entry_for(ng_push_table* t, size_t node, size_t* out) {
+    size_t i;
+    if ((t->count + 1) * 2 > t->slot_count) {
+        size_t cap = t->slot_count ? t->slot_count * 2 : 64, j;
+        size_t* slots = (size_t*)calloc(cap, sizeof(*slots));
+        if (!slots)
+            return NG_OOM;
+        for (j = 0; j < t->count; j++) {
+            for (i = ng_push_slot(t->entries[j].node, cap - 1); slots[i]; i = (i + 1) & (cap - 1))
+                ;
+            slots[i] = j + 1;
+        }
+        free(t->slots);
+        t->slots = slots;
+        t->slot_count = cap;
+    }
+    for (i = ng_push_slot(node, t->slot_count - 1); t->slots[i]; i = (i + 1) & (t->slot_count - 1))
+        if (t->entries[t->slots[i] - 1].node == node) {
+            *out = t->slots[i] - 1;
+            return NG_OK;
+        }
+    if (t->count == t->capacity) {
+        size_t cap = t->capacity ? t->capacity * 2 : 32;
+        ng_push_entry* e = (ng_push_entry*)realloc(t->entries, cap * sizeof(*e));
+        if (!e)
+            return NG_OOM;
+        t->entries = e;
+        t->capacity = cap;
+    }
+    memset(&t->entries[t->count], 0, sizeof(t->entries[t->count]));
+    t->entries[t->count].node = node;
+    t->slots[i] = t->count + 1;
+    *out = t->count++;
+    return NG_OK;
+}
+static int ng_push_score_compare(const void* a, const void* b) {
+    const ng_node_score* x = (const ng_node_score*)a;
+    const ng_node_score* y = (const ng_node_score*)b;
+    if (x->score != y->score)
+        return x->score > y->score ? -1 : 1;
+    return x->node < y->node ? -1 : x->node > y->node;
+}
+/* Adds residual to node and queues it once it crosses epsilon per outgoing relationship. */
+static ng_status ng_push_add(const ng_analytics_view* view,
+                             ng_push_table* t,
+                             size_t node,
+                             double residual,
+                             double epsilon) {
+    size_t j, degree = view->out_offsets[node + 1] - view->out_offsets[node];
+    ng_push_entry* e;
+    ng_status s = ng_push_entry_for(t, node, &j);
+    if (s != NG_OK)
+        return s;
+    e = &t->entries[j];
+    e->residual += residual;
+    if (e->queued || e->residual < epsilon * (double)(degree ? degree : 1))
+        return NG_OK;
+    if (t->tail == t->queue_capacity) {
+        size_t cap = t->queue_capacity ? t->queue_capacity * 2 : 32;
+        size_t* q = (size_t*)realloc(t->queue, cap * sizeof(*q));
+        if (!q)
+            return NG_OOM;
+        t->queue = q;
+        t->queue_capacity = cap;
+    }
+    e->queued = 1;
+    t->queue[t->tail++] = j;
     return NG_OK;
 }
-ng_status ng_eigenvector_centrality(const ng_graph* g,
-                                    ng_direction direction,
-                                    ng_symbol_id type,
-                                    uint32_t iterations,
-                                    ng_node_score* out,
-                                    size_t capacity,
-                                    size_t* out_count) {
-    double* values;
-    double* next;
-    size_t i, j;
+ng_status ng_personalized_pagerank_push_view(const ng_analytics_view* view,
+                                             const ng_node_id* seeds,
+                                             size_t seed_count,
+                                             double alpha,
+                                             double epsilon,
+                                             size_t k,
+                                             ng_node_score* out,
+                                             size_t capacity,
+                                             size_t* out_count) {
+    ng_push_table table;
+    ng_node_score* ranked = NULL;
+    size_t *sources, i, e, found = 0, wanted;
+    ng_status s = NG_OK;
+    if (!view || !seeds || !seed_count || !k || !(alpha > 0.0 && alpha < 1.0) ||
+        !(epsilon > 0.0))
+        return NG_INVALID_ARGUMENT;
+    sources = (size_t*)malloc(seed_count * sizeof(*sources));
+    if (!sources)
+        return NG_OOM;
+    for (i = 0; i < seed_count; i++)
+        if ((sources[i] = ng_analytics_view_position(view, seeds[i])) == SIZE_MAX) {
+            free(sources);
+            return NG_NOT_FOUND;
+        }
+    memset(&table, 0, sizeof(table));
+    for (i = 0; s == NG_OK && i < seed_count; i++)
+        s = ng_push_add(view, &table, sources[i], 1.0 / (double)seed_count, epsilon);
+    while (s == NG_OK && table.head < table.tail) {
+        ng_push_entry* entry = &table.entries[table.queue[table.head++]];
+        size_t node = entry->node;
+        size_t degree = view->out_offsets[node + 1] - view->out_offsets[node];
+        double residual = entry->residual, share;
+        entry->queued = 0;
+        entry->estimate += alpha * residual;
+        entry->residual = 0.0;
+        /* Dangling nodes send the walk back to the seeds, as ng_pagerank_with_options() does. */
+        share = (1.0 - alpha) * residual / (double)(degree ? degree : seed_count);
+        if (degree) {
+            for (e = view->out_offsets[node]; s == NG_OK && e < view->out_offsets[node + 1]; e++)
+                s = ng_push_add(view, &table, view->out_nodes[e], share, epsilon);
+        } else {
+            for (e = 0; s == NG_OK && e < seed_count; e++)
+                s = ng_push_add(view, &table, sources[e], share, epsilon);
+        }
+        if (table.head == table.tail)
+            table.head = table.tail = 0;
+    }
+    if (s == NG_OK && table.count &&
+        !(ranked = (ng_node_score*)malloc(table.count * sizeof(*ranked))))
+        s = NG_OOM;
+    for (i = 0; s == NG_OK && i < table.count; i++)
+        if (table.entries[i].estimate > 0.0) {
+            ranked[found].node = view->nodes[table.entries[i].node];
+            ranked[found++].score = table.entries[i].estimate;
+        }
+    if (s == NG_OK) {
+        qsort(ranked, found, sizeof(*ranked), ng_push_score_compare);
+        wanted = k < found ? k : found;
+        if (!out_count || !out || capacity < wanted)
+            s = NG_LIMIT;
+        else {
+            if (wanted)
+                memcpy(out, ranked, wanted * sizeof(*out));
+            *out_count = wanted;
+        }
+    }
+    free(ranked);
+    free(sources);
+    free(table.queue);
+    free(table.entries);
+    free(table.slots);
+    return s;
+}
+ng_status ng_personalized_pagerank_push(const ng_graph* g,
+                                        ng_direction direction,
+                                        ng_symbol_id type,
+                                        const ng_node_id* seeds,
+                                        size_t seed_count,
+                                        double alpha,
+                                        double epsilon,
+                                        size_t k,
+                                        ng_node_score* out,
+                                        size_t capacity,
+                                        size_t* out_count) {
+    ng_analytics_view* view;
     ng_status s;
-    if (!g || direction > NG_DIRECTION_EITHER || !iterations)
+    if (!g || direction > NG_DIRECTION_EITHER || !ng_analytics_symbol_ok(g, type))
         return NG_INVALID_ARGUMENT;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    s = ng_analytics_view_build(g, direction, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_personalized_pagerank_push_view(
+        view, seeds, seed_count, alpha, epsilon, k, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+ng_status ng_eigenvector_centrality_view_with_tolerance(const ng_analytics_view* view,
+                                                        uint32_t max_iterations,
+                                                        double tolerance,
+                                                        ng_node_score* out,
+                                                        size_t capacity,
+                                                        size_t* out_count,
+                                                        uint32_t* out_iterations) {
+    double *values, *next;
+    uint32_t done = 0;
+    size_t i, e, n;
+    ng_status s;
+    if (out_iterations)
+        *out_iterations = 0;
+    if (!max_iterations || !(tolerance >= 0.0))
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_view_check(view, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    values = (double*)malloc(g->nn * sizeof(*values));
-    next = (double*)malloc(g->nn * sizeof(*next));
-    if ((g->nn && !values) || (g->nn && !next)) {
+    n = view->node_count;
+    values = (double*)malloc((n ? n : 1) * sizeof(*values));
+    next = (double*)malloc((n ? n : 1) * sizeof(*next));
+    if (!values || !next) {
         free(values);
         free(next);
         return NG_OOM;
     }
-    for (i = 0; i < g->nn; i++)
+    for (i = 0; i < n; i++)
         values[i] = 1.0;
-    while (iterations--) {
-        double norm = 0.0;
-        for (i = 0; i < g->nn; i++) {
-            next[i] = 0.0;
-            for (j = 0; j < g->nr; j++) {
-                const rel_i* rel = &g->re[j];
-                size_t other = SIZE_MAX;
-                if (!ng_analytics_rel_ok(rel, type))
-                    continue;
-                if (direction == NG_DIRECTION_OUTGOING && rel->src == g->no[i].id)
-                    other = ng_node_position(g, rel->dst);
-                else if (direction == NG_DIRECTION_INCOMING && rel->dst == g->no[i].id)
-                    other = ng_node_position(g, rel->src);
-                else if (direction == NG_DIRECTION_EITHER) {
-                    if (rel->src == g->no[i].id)
-                        other = ng_node_position(g, rel->dst);
-                    else if (rel->dst == g->no[i].id)
-                        other = ng_node_position(g, rel->src);
-                }
-                if (other != SIZE_MAX)
-                    next[i] += values[other];
-            }
-            norm += next[i] * next[i];
+    while (done < max_iterations) {
+        double norm = 0.0, delta = 0.0;
+        for (i = 0; i < n; i++) {
+            double sum = 0.0;
+            for (e = view->out_offsets[i]; e < view->out_offsets[i + 1]; e++)
+                sum += values[view->out_nodes[e]];
+            next[i] = sum;
+            norm += sum * sum;
         }
         norm = sqrt(norm);
         if (norm == 0.0)
             break;
-        for (i = 0; i < g->nn; i++)
-            values[i] = next[i] / norm;
+        done++;
+        for (i = 0; i < n; i++) {
+            double value = next[i] / norm;
+            delta += fabs(value - values[i]);
+            values[i] = value;
+        }
+        if (tolerance > 0.0 && delta <= tolerance)
+            break;
     }
-    for (i = 0; i < g->nn; i++) {
-        out[i].node = g->no[i].id;
+    for (i = 0; i < n; i++) {
+        out[i].node = view->nodes[i];
         out[i].score = values[i];
     }
+    if (out_iterations)
+        *out_iterations = done;
     free(values);
     free(next);
     return NG_OK;
 }
+ng_status ng_eigenvector_centrality_view(const ng_analytics_view* view,
+                                         uint32_t iterations,
+                                         ng_node_score* out,
+                                         size_t capacity,
+                                         size_t* out_count) {
+    return ng_eigenvector_centrality_view_with_tolerance(
+        view, iterations, 0.0, out, capacity, out_count, NULL);
+}
+ng_status ng_eigenvector_centrality_with_tolerance(const ng_graph* g,
+                                                   ng_direction direction,
+                                                   ng_symbol_id type,
+                                                   uint32_t max_iterations,
+                                                   double tolerance,
+                                                   ng_node_score* out,
+                                                   size_t capacity,
+                                                   size_t* out_count,
+                                                   uint32_t* out_iterations) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (out_iterations)
+        *out_iterations = 0;
+    if (!g || direction > NG_DIRECTION_EITHER || !max_iterations || !(tolerance >= 0.0))
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, direction, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_eigenvector_centrality_view_with_tolerance(
+        view, max_iterations, tolerance, out, capacity, out_count, out_iterations);
+    ng_analytics_view_free(view);
+    return s;
+}
+ng_status ng_eigenvector_centrality(const ng_graph* g,
+                                    ng_direction direction,
+                                    ng_symbol_id type,
+                                    uint32_t iterations,
+                                    ng_node_score* out,
+                                    size_t capacity,
+                                    size_t* out_count) {
+    return ng_eigenvector_centrality_with_tolerance(
+        g, direction, type, iterations, 0.0, out, capacity, out_count, NULL);
+}
 static uint64_t ng_embedding_random(uint64_t value) {
     value ^= value >> 30;
     value *= UINT64_C(0xbf58476d1ce4e5b9);
@@ -2695,60 +3991,51 @@ static uint64_t ng_embedding_random(uint64_t value) {
     value *= UINT64_C(0x94d049bb133111eb);
     return value ^ (value >> 31);
 }
-ng_status ng_fastrp(const ng_graph* g,
-                    ng_direction direction,
-                    ng_symbol_id type,
-                    uint32_t iterations,
-                    size_t dimensions,
-                    uint64_t seed,
-                    double* out,
-                    size_t capacity,
-                    size_t* out_count) {
-    double* vectors;
-    double* next;
-    size_t total, i, d, step;
+ng_status ng_fastrp_view(const ng_analytics_view* view,
+                         uint32_t iterations,
+                         size_t dimensions,
+                         uint64_t seed,
+                         double* out,
+                         size_t capacity,
+                         size_t* out_count) {
+    double *vectors, *next;
+    size_t total, i, d, e, n, step;
     ng_status s;
-    if (!g || direction > NG_DIRECTION_EITHER || !iterations || !dimensions ||
-        !ng_analytics_symbol_ok(g, type))
+    if (!view || !iterations || !dimensions)
         return NG_INVALID_ARGUMENT;
-    if (dimensions > SIZE_MAX / (g->nn ? g->nn : 1))
+    n = view->node_count;
+    if (dimensions > SIZE_MAX / (n ? n : 1))
         return NG_LIMIT;
-    total = g->nn * dimensions;
+    total = n * dimensions;
     if (capacity < total || (total && !out))
         return NG_LIMIT;
-    s = ng_analytics_check_output(g, type, g->nn ? out : NULL, g->nn, out_count);
+    s = ng_analytics_view_check(view, n ? out : NULL, n, out_count);
     if (s != NG_OK)
         return s;
-    vectors = (double*)malloc(total * sizeof(*vectors));
-    next = (double*)malloc(total * sizeof(*next));
-    if ((total && !vectors) || (total && !next)) {
+    vectors = (double*)malloc((total ? total : 1) * sizeof(*vectors));
+    next = (double*)malloc((total ? total : 1) * sizeof(*next));
+    if (!vectors || !next) {
         free(vectors);
         free(next);
         return NG_OOM;
     }
-    for (i = 0; i < g->nn; i++)
+    for (i = 0; i < n; i++)
         for (d = 0; d < dimensions; d++)
             vectors[i * dimensions + d] =
                 (double)(ng_embedding_random(seed + i * UINT64_C(1315423911) + d) % 2001) /
                     1000.0 -
                 1.0;
     for (step = 0; step < iterations; step++) {
-        for (i = 0; i < g->nn; i++)
-            for (d = 0; d < dimensions; d++)
-                next[i * dimensions + d] = vectors[i * dimensions + d];
-        for (i = 0; i < g->nr; i++) {
-            const rel_i* rel = &g->re[i];
-            size_t a = ng_node_position(g, rel->src), b = ng_node_position(g, rel->dst);
-            if (!ng_analytics_rel_ok(rel, type) || a == SIZE_MAX || b == SIZE_MAX)
-                continue;
-            if (direction == NG_DIRECTION_OUTGOING || direction == NG_DIRECTION_EITHER)
-                for (d = 0; d < dimensions; d++)
-                    next[b * dimensions + d] += vectors[a * dimensions + d];
-            if (direction == NG_DIRECTION_INCOMING || direction == NG_DIRECTION_EITHER)
+        for (i = 0; i < n; i++) {
+            double* row = next + i * dimensions;
+            memcpy(row, vectors + i * dimensions, dimensions * sizeof(*row));
+            for (e = view->in_offsets[i]; e < view->in_offsets[i + 1]; e++) {
+                const double* from = vectors + view->in_nodes[e] * dimensions;
                 for (d = 0; d < dimensions; d++)
-                    next[a * dimensions + d] += vectors[b * dimensions + d];
+                    row[d] += from[d];
+            }
         }
-        for (i = 0; i < g->nn; i++) {
+        for (i = 0; i < n; i++) {
             double norm = 0.0;
             for (d = 0; d < dimensions; d++)
                 norm += next[i * dimensions + d] * next[i * dimensions + d];
@@ -2763,6 +4050,36 @@ ng_status ng_fastrp(const ng_graph* g,
     free(next);
     return NG_OK;
 }
+ng_status ng_fastrp(const ng_graph* g,
+                    ng_direction direction,
+                    ng_symbol_id type,
+                    uint32_t iterations,
+                    size_t dimensions,
+                    uint64_t seed,
+                    double* out,
+                    size_t capacity,
+                    size_t* out_count) {
+    ng_analytics_view* view;
+    size_t total;
+    ng_status s;
+    if (!g || direction > NG_DIRECTION_EITHER || !iterations || !dimensions ||
+        !ng_analytics_symbol_ok(g, type))
+        return NG_INVALID_ARGUMENT;
+    if (dimensions > SIZE_MAX / (g->nn ? g->nn : 1))
+        return NG_LIMIT;
+    total = g->nn * dimensions;
+    if (capacity < total || (total && !out))
+        return NG_LIMIT;
+    s = ng_analytics_check_output(g, type, g->nn ? out : NULL, g->nn, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, direction, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_fastrp_view(view, iterations, dimensions, seed, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
 ng_status ng_node2vec(const ng_graph* g,
                       ng_direction direction,
                       ng_symbol_id type,
@@ -5279,70 +6596,185 @@ finish:
     ng_vector_index_free(index);
     return status;
 }
-static ng_status ng_distance_centrality(const ng_graph* g,
-                                        ng_direction direction,
-                                        ng_symbol_id type,
+static size_t ng_bit_index(uint64_t bit) {
+    static const unsigned char table[64] = {
+        0,  1,  48, 2,  57, 49, 28, 3,  61, 58, 50, 42, 38, 29, 17, 4,  62, 55, 59, 36, 53, 51,
+        43, 22, 45, 39, 33, 30, 24, 18, 12, 5,  63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21,
+        44, 32, 23, 11, 46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9,  13, 8,  7,  6};
+    return table[(bit * UINT64_C(0x03f79d71b4cb0a89)) >> 58];
+}
+static size_t ng_bit_count(uint64_t x) {
+    x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+    x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+    x = (x + (x >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+    return (size_t)((x * UINT64_C(0x0101010101010101)) >> 56);
+}
+/* Multi-source BFS: bit b of seen/visit tracks the b-th source of a batch. Advances every source
+ * by one level along side rows and leaves the newly reached bits in next. */
+static int ng_msbfs_step(const ng_analytics_view* v,
+                         size_t side,
+                         uint64_t* seen,
+                         const uint64_t* visit,
+                         uint64_t* next) {
+    size_t w, k, row_count;
+    int any = 0;
+    memset(next, 0, v->node_count * sizeof(*next));
+    for (w = 0; w < v->node_count; w++)
+        if (visit[w]) {
+            const size_t* row = ng_analytics_view_row(v, side, w, &row_count);
+            for (k = 0; k < row_count; k++) {
+                uint64_t fresh = visit[w] & ~seen[row[k]];
+                if (fresh) {
+                    next[row[k]] |= fresh;
+                    seen[row[k]] |= fresh;
+                    any = 1;
+                }
+            }
+        }
+    return any;
+}
+/* Exact scores use every node as a source, 64 per batch. With samples, batches start from that
+ * many random pivots over reversed rows, so each node accumulates its distances to the pivots. */
+static ng_status ng_distance_centrality(const ng_analytics_view* view,
                                         int harmonic,
+                                        size_t samples,
+                                        uint64_t seed,
                                         ng_node_score* out,
                                         size_t capacity,
                                         size_t* out_count) {
-    size_t i, j;
-    ng_status s;
-    if (!g || direction > NG_DIRECTION_EITHER)
-        return NG_INVALID_ARGUMENT;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    uint64_t *seen, *visit, *next;
+    size_t *sources, *hits, i, n, base, pivots;
+    double* sums;
+    ng_status s = ng_analytics_view_check(view, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    for (i = 0; i < g->nn; i++) {
-        size_t* distances = (size_t*)malloc(g->nn * sizeof(*distances));
-        size_t* queue = (size_t*)malloc(g->nn * sizeof(*queue));
-        size_t head = 0, tail = 0, reachable = 0;
-        double total = 0.0;
-        if ((g->nn && !distances) || (g->nn && !queue)) {
-            free(distances);
-            free(queue);
-            return NG_OOM;
-        }
-        for (j = 0; j < g->nn; j++)
-            distances[j] = SIZE_MAX;
-        distances[i] = 0;
-        queue[tail++] = i;
-        while (head < tail) {
-            size_t current = queue[head++];
-            for (j = 0; j < g->nr; j++) {
-                const rel_i* rel = &g->re[j];
-                size_t next = SIZE_MAX;
-                if (!ng_analytics_rel_ok(rel, type))
-                    continue;
-                if (direction == NG_DIRECTION_OUTGOING && rel->src == g->no[current].id)
-                    next = ng_node_position(g, rel->dst);
-                else if (direction == NG_DIRECTION_INCOMING && rel->dst == g->no[current].id)
-                    next = ng_node_position(g, rel->src);
-                else if (direction == NG_DIRECTION_EITHER) {
-                    if (rel->src == g->no[current].id)
-                        next = ng_node_position(g, rel->dst);
-                    else if (rel->dst == g->no[current].id)
-                        next = ng_node_position(g, rel->src);
-                }
-                if (next != SIZE_MAX && distances[next] == SIZE_MAX) {
-                    distances[next] = distances[current] + 1;
-                    queue[tail++] = next;
+    n = view->node_count;
+    pivots = samples && samples < n ? samples : n;
+    seen = (uint64_t*)malloc((n ? n : 1) * sizeof(*seen));
+    visit = (uint64_t*)malloc((n ? n : 1) * sizeof(*visit));
+    next = (uint64_t*)malloc((n ? n : 1) * sizeof(*next));
+    sources = (size_t*)malloc((n ? n : 1) * sizeof(*sources));
+    hits = (size_t*)calloc(n ? n : 1, sizeof(*hits));
+    sums = (double*)calloc(n ? n : 1, sizeof(*sums));
+    if (!seen || !visit || !next || !sources || !hits || !sums) {
+        s = NG_OOM;
+        goto done;
+    }
+    for (i = 0; i < n; i++)
+        sources[i] = i;
+    for (i = 0; samples && i < pivots; i++) {
+        size_t j = i + (size_t)(ng_embedding_random(seed + i) % (uint64_t)(n - i)), t = sources[i];
+        sources[i] = sources[j];
+        sources[j] = t;
+    }
+    for (base = 0; base < pivots; base += 64) {
+        size_t width = pivots - base < 64 ? pivots - base : 64, level, b;
+        memset(seen, 0, n * sizeof(*seen));
+        memset(visit, 0, n * sizeof(*visit));
+        for (b = 0; b < width; b++)
+            seen[sources[base + b]] = visit[sources[base + b]] = UINT64_C(1) << b;
+        for (level = 1; ng_msbfs_step(view, samples ? 1 : 0, seen, visit, next); level++) {
+            size_t reached[64] = {0};
+            uint64_t* swap;
+            for (i = 0; i < n; i++) {
+                uint64_t m = next[i];
+                if (m && samples) {
+                    size_t c = ng_bit_count(m);
+                    hits[i] += c;
+                    sums[i] += harmonic ? (double)c / (double)level : (double)c * (double)level;
                 }
+                for (; m && !samples; m &= m - 1)
+                    reached[ng_bit_index(m & (~m + 1))]++;
+            }
+            for (b = 0; !samples && b < width; b++) {
+                hits[sources[base + b]] += reached[b];
+                sums[sources[base + b]] += harmonic ? (double)reached[b] / (double)level
+                                                    : (double)reached[b] * (double)level;
             }
+            swap = visit;
+            visit = next;
+            next = swap;
         }
-        for (j = 0; j < g->nn; j++)
-            if (j != i && distances[j] != SIZE_MAX) {
-                reachable++;
-                total += harmonic ? 1.0 / (double)distances[j] : (double)distances[j];
-            }
-        out[i].node = g->no[i].id;
-        out[i].score = total == 0.0 ? 0.0
-                                   : (harmonic ? total
-                                               : (double)reachable / total);
-        free(distances);
-        free(queue);
     }
-    return NG_OK;
+    /* next is free again; reuse it to mark the pivots. */
+    memset(next, 0, n * sizeof(*next));
+    for (i = 0; samples && i < pivots; i++)
+        next[sources[i]] = 1;
+    for (i = 0; i < n; i++) {
+        out[i].node = view->nodes[i];
+        if (sums[i] == 0.0)
+            out[i].score = 0.0;
+        else if (!harmonic)
+            out[i].score = (double)hits[i] / sums[i];
+        else if (samples)
+            /* Sampled mean of 1/d over the pivots other than i, scaled to all n - 1 targets. */
+            out[i].score = sums[i] * (double)(n - 1) / (double)(pivots - (size_t)next[i]);
+        else
+            out[i].score = sums[i];
+    }
+done:
+    free(seen);
+    free(visit);
+    free(next);
+    free(sources);
+    free(hits);
+    free(sums);
+    return s;
+}
+static ng_status ng_distance_centrality_graph(const ng_graph* g,
+                                              ng_direction direction,
+                                              ng_symbol_id type,
+                                              int harmonic,
+                                              size_t samples,
+                                              uint64_t seed,
+                                              ng_node_score* out,
+                                              size_t capacity,
+                                              size_t* out_count) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (!g || direction > NG_DIRECTION_EITHER)
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, direction, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_distance_centrality(view, harmonic, samples, seed, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+ng_status ng_closeness_centrality_view(const ng_analytics_view* view,
+                                       ng_node_score* out,
+                                       size_t capacity,
+                                       size_t* out_count) {
+    return ng_distance_centrality(view, 0, 0, 0, out, capacity, out_count);
+}
+ng_status ng_harmonic_centrality_view(const ng_analytics_view* view,
+                                      ng_node_score* out,
+                                      size_t capacity,
+                                      size_t* out_count) {
+    return ng_distance_centrality(view, 1, 0, 0, out, capacity, out_count);
+}
+ng_status ng_closeness_centrality_view_sampled(const ng_analytics_view* view,
+                                               size_t samples,
+                                               uint64_t seed,
+                                               ng_node_score* out,
+                                               size_t capacity,
+                                               size_t* out_count) {
+    if (!samples)
+        return NG_INVALID_ARGUMENT;
+    return ng_distance_centrality(view, 0, samples, seed, out, capacity, out_count);
+}
+ng_status ng_harmonic_centrality_view_sampled(const ng_analytics_view* view,
+                                              size_t samples,
+                                              uint64_t seed,
+                                              ng_node_score* out,
+                                              size_t capacity,
+                                              size_t* out_count) {
+    if (!samples)
+        return NG_INVALID_ARGUMENT;
+    return ng_distance_centrality(view, 1, samples, seed, out, capacity, out_count);
 }
 ng_status ng_closeness_centrality(const ng_graph* g,
                                   ng_direction direction,
@@ -5350,7 +6782,7 @@ ng_status ng_closeness_centrality(const ng_graph* g,
                                   ng_node_score* out,
                                   size_t capacity,
                                   size_t* out_count) {
-    return ng_distance_centrality(g, direction, type, 0, out, capacity, out_count);
+    return ng_distance_centrality_graph(g, direction, type, 0, 0, 0, out, capacity, out_count);
 }
 ng_status ng_harmonic_centrality(const ng_graph* g,
                                  ng_direction direction,
@@ -5358,89 +6790,377 @@ ng_status ng_harmonic_centrality(const ng_graph* g,
                                  ng_node_score* out,
                                  size_t capacity,
                                  size_t* out_count) {
-    return ng_distance_centrality(g, direction, type, 1, out, capacity, out_count);
+    return ng_distance_centrality_graph(g, direction, type, 1, 0, 0, out, capacity, out_count);
+}
+ng_status ng_closeness_centrality_sampled(const ng_graph* g,
+                                          ng_direction direction,
+                                          ng_symbol_id type,
+                                          size_t samples,
+                                          uint64_t seed,
+                                          ng_node_score* out,
+                                          size_t capacity,
+                                          size_t* out_count) {
+    if (!samples)
+        return NG_INVALID_ARGUMENT;
+    return ng_distance_centrality_graph(
+        g, direction, type, 0, samples, seed, out, capacity, out_count);
+}
+ng_status ng_harmonic_centrality_sampled(const ng_graph* g,
+                                         ng_direction direction,
+                                         ng_symbol_id type,
+                                         size_t samples,
+                                         uint64_t seed,
+                                         ng_node_score* out,
+                                         size_t capacity,
+                                         size_t* out_count) {
+    if (!samples)
+        return NG_INVALID_ARGUMENT;
+    return ng_distance_centrality_graph(
+        g, direction, type, 1, samples, seed, out, capacity, out_count);
+}
+/* Brandes: a shortest-path pass per source (BFS, or Dijkstra when the view carries weights), then
+ * dependencies accumulated in reverse settle order along out rows. A relationship v->w lies on a
+ * shortest path when w settled after v at exactly distance[v] + weight. */
+static ng_status ng_betweenness(const ng_analytics_view* view,
+                                size_t samples,
+                                uint64_t seed,
+                                ng_node_score* out,
+                                size_t capacity,
+                                size_t* out_count) {
+    double *distance, *sigma, *delta;
+    size_t *order, *rank, *sources, i, j, e, n, k, source;
+    ng_path_heap heap;
+    ng_status s = ng_analytics_view_check(view, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    n = view->node_count;
+    k = samples && samples < n ? samples : n;
+    distance = (double*)malloc((n ? n : 1) * sizeof(*distance));
+    sigma = (double*)calloc(n ? n : 1, sizeof(*sigma));
+    delta = (double*)calloc(n ? n : 1, sizeof(*delta));
+    order = (size_t*)malloc((n ? n : 1) * sizeof(*order));
+    rank = (size_t*)malloc((n ? n : 1) * sizeof(*rank));
+    sources = (size_t*)malloc((n ? n : 1) * sizeof(*sources));
+    heap.items = (size_t*)malloc((n ? n : 1) * sizeof(*heap.items));
+    heap.slot = (size_t*)malloc((n ? n : 1) * sizeof(*heap.slot));
+    heap.key = distance;
+    heap.count = 0;
+    if (!distance || !sigma || !delta || !order || !rank || !sources || !heap.items ||
+        !heap.slot) {
+        s = NG_OOM;
+        goto done;
+    }
+    for (i = 0; i < n; i++) {
+        out[i].node = view->nodes[i];
+        out[i].score = 0.0;
+        distance[i] = 1e300;
+        rank[i] = heap.slot[i] = SIZE_MAX;
+        sources[i] = i;
+    }
+    for (i = 0; samples && i < k; i++) {
+        size_t pick = i + (size_t)(ng_embedding_random(seed + i) % (uint64_t)(n - i));
+        size_t t = sources[i];
+        sources[i] = sources[pick];
+        sources[pick] = t;
+    }
+    for (source = 0; source < k; source++) {
+        size_t count = 0, head = 0;
+        distance[sources[source]] = 0.0;
+        sigma[sources[source]] = 1.0;
+        if (view->out_weights)
+            ng_path_heap_update(&heap, sources[source]);
+        else {
+            rank[sources[source]] = 0;
+            order[count++] = sources[source];
+        }
+        while (view->out_weights ? heap.count > 0 : head < count) {
+            size_t v;
+            if (view->out_weights) {
+                v = ng_path_heap_pop(&heap);
+                rank[v] = count;
+                order[count++] = v;
+            } else
+                v = order[head++];
+            for (e = view->out_offsets[v]; e < view->out_offsets[v + 1]; e++) {
+                size_t w = view->out_nodes[e];
+                double weight = view->out_weights ? view->out_weights[e] : 1.0;
+                double candidate = distance[v] + weight;
+                if (isnan(weight) || weight < 0) {
+                    s = NG_PARSE_ERROR;
+                    goto done;
+                }
+                if (rank[w] != SIZE_MAX && (view->out_weights || distance[w] < candidate))
+                    continue;
+                if (candidate < distance[w]) {
+                    distance[w] = candidate;
+                    sigma[w] = sigma[v];
+                    if (view->out_weights)
+                        ng_path_heap_update(&heap, w);
+                    else {
+                        rank[w] = count;
+                        order[count++] = w;
+                    }
+                } else if (candidate == distance[w])
+                    sigma[w] += sigma[v];
+            }
+        }
+        for (j = count; j-- > 0;) {
+            size_t v = order[j];
+            for (e = view->out_offsets[v]; e < view->out_offsets[v + 1]; e++) {
+                size_t w = view->out_nodes[e];
+                double weight = view->out_weights ? view->out_weights[e] : 1.0;
+                if (rank[w] > rank[v] && distance[w] == distance[v] + weight)
+                    delta[v] += sigma[v] / sigma[w] * (1.0 + delta[w]);
+            }
+            if (v != sources[source])
+                out[v].score += delta[v];
+        }
+        for (j = 0; j < count; j++) {
+            size_t v = order[j];
+            distance[v] = 1e300;
+            sigma[v] = delta[v] = 0.0;
+            rank[v] = SIZE_MAX;
+        }
+    }
+    for (i = 0; i < n; i++) {
+        if (k < n)
+            out[i].score *= (double)n / (double)k;
+        /* Undirected views reach every pair from both ends. */
+        if (view->direction == NG_DIRECTION_EITHER)
+            out[i].score /= 2.0;
+    }
+done:
+    free(distance);
+    free(sigma);
+    free(delta);
+    free(order);
+    free(rank);
+    free(sources);
+    free(heap.items);
+    free(heap.slot);
+    return s;
+}
+ng_status ng_betweenness_centrality_view(const ng_analytics_view* view,
+                                         ng_node_score* out,
+                                         size_t capacity,
+                                         size_t* out_count) {
+    return ng_betweenness(view, 0, 0, out, capacity, out_count);
+}
+ng_status ng_betweenness_centrality_view_sampled(const ng_analytics_view* view,
+                                                 size_t samples,
+                                                 uint64_t seed,
+                                                 ng_node_score* out,
+                                                 size_t capacity,
+                                                 size_t* out_count) {
+    if (!samples)
+        return NG_INVALID_ARGUMENT;
+    return ng_betweenness(view, samples, seed, out, capacity, out_count);
+}
+static ng_status ng_betweenness_graph(const ng_graph* g,
+                                      ng_direction direction,
+                                      ng_symbol_id type,
+                                      ng_symbol_id weight_key,
+                                      size_t samples,
+                                      uint64_t seed,
+                                      ng_node_score* out,
+                                      size_t capacity,
+                                      size_t* out_count) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (!g || direction > NG_DIRECTION_EITHER)
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_build(g, direction, type, weight_key, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_betweenness(view, samples, seed, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+ng_status ng_betweenness_centrality(const ng_graph* g,
+                                    ng_direction direction,
+                                    ng_symbol_id type,
+                                    ng_symbol_id weight_key,
+                                    ng_node_score* out,
+                                    size_t capacity,
+                                    size_t* out_count) {
+    return ng_betweenness_graph(g, direction, type, weight_key, 0, 0, out, capacity, out_count);
+}
+ng_status ng_betweenness_centrality_sampled(const ng_graph* g,
+                                            ng_direction direction,
+                                            ng_symbol_id type,
+                                            ng_symbol_id weight_key,
+                                            size_t samples,
+                                            uint64_t seed,
+                                            ng_node_score* out,
+                                            size_t capacity,
+                                            size_t* out_count) {
+    if (!samples)
+        return NG_INVALID_ARGUMENT;
+    return ng_betweenness_graph(
+        g, direction, type, weight_key, samples, seed, out, capacity, out_count);
+}
+static size_t ng_component_find(size_t* parent, size_t node) {
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+/* Numbers components 0.. in order of their lowest node position, matching a scan in node order. */
+static void ng_component_emit(const ng_analytics_view* view,
+                              const size_t* label,
+                              size_t* number,
+                              ng_node_component* out) {
+    size_t i, component = 0;
+    for (i = 0; i < view->node_count; i++)
+        number[i] = SIZE_MAX;
+    for (i = 0; i < view->node_count; i++) {
+        if (number[label[i]] == SIZE_MAX)
+            number[label[i]] = component++;
+        out[i].node = view->nodes[i];
+        out[i].component = (uint64_t)number[label[i]];
+    }
+}
+/* Union-find over the out rows (each relationship once) with path halving and union by size, so
+ * the whole pass is O((N + R) alpha(N)). `number` holds the component sizes until
+ * ng_component_emit() reuses it to number components by their lowest position. */
+ng_status ng_weakly_connected_components_view(const ng_analytics_view* view,
+                                              ng_node_component* out,
+                                              size_t capacity,
+                                              size_t* out_count) {
+    size_t *parent, *number, i, k, n, row_count;
+    ng_status s = ng_analytics_view_check(view, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    n = view->node_count;
+    parent = (size_t*)malloc((n ? n : 1) * sizeof(*parent));
+    number = (size_t*)malloc((n ? n : 1) * sizeof(*number));
+    if (!parent || !number) {
+        free(parent);
+        free(number);
+        return NG_OOM;
+    }
+    for (i = 0; i < n; i++) {
+        parent[i] = i;
+        number[i] = 1;
+    }
+    for (i = 0; i < n; i++) {
+        const size_t* row = ng_analytics_view_row(view, 0, i, &row_count);
+        for (k = 0; k < row_count; k++) {
+            size_t a = ng_component_find(parent, i), b = ng_component_find(parent, row[k]);
+            if (a == b)
+                continue;
+            if (number[a] < number[b]) {
+                size_t t = a;
+                a = b;
+                b = t;
+            }
+            parent[b] = a;
+            number[a] += number[b];
+        }
+    }
+    for (i = 0; i < n; i++)
+        parent[i] = ng_component_find(parent, i);
+    ng_component_emit(view, parent, number, out);
+    free(parent);
+    free(number);
+    return NG_OK;
 }
 ng_status ng_weakly_connected_components(const ng_graph* g,
                                          ng_symbol_id type,
                                          ng_node_component* out,
                                          size_t capacity,
                                          size_t* out_count) {
-    unsigned char* seen;
-    size_t* q;
-    size_t i, component = 0;
-    ng_status s;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    ng_analytics_view* view;
+    ng_status s = ng_analytics_check_output(g, type, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    seen = (unsigned char*)calloc(g->nn, 1);
-    q = (size_t*)malloc(g->nn * sizeof(*q));
-    if (g->nn && (!seen || !q)) {
-        free(seen);
-        free(q);
+    s = ng_analytics_view_build(g, NG_DIRECTION_EITHER, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_weakly_connected_components_view(view, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+/* Iterative Tarjan over the out rows: `call` holds the DFS path and `edge` each node's next row
+ * position, so deep graphs need no recursion. */
+ng_status ng_strongly_connected_components_view(const ng_analytics_view* view,
+                                                ng_node_component* out,
+                                                size_t capacity,
+                                                size_t* out_count) {
+    size_t *order, *low, *edge, *call, *stack, *label, i, n, counter = 0, depth, top = 0;
+    unsigned char* on_stack;
+    ng_status s = ng_analytics_view_check(view, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    n = view->node_count;
+    order = (size_t*)malloc((n ? n : 1) * sizeof(*order));
+    low = (size_t*)malloc((n ? n : 1) * sizeof(*low));
+    edge = (size_t*)malloc((n ? n : 1) * sizeof(*edge));
+    call = (size_t*)malloc((n ? n : 1) * sizeof(*call));
+    stack = (size_t*)malloc((n ? n : 1) * sizeof(*stack));
+    label = (size_t*)malloc((n ? n : 1) * sizeof(*label));
+    on_stack = (unsigned char*)calloc(n ? n : 1, 1);
+    if (!order || !low || !edge || !call || !stack || !label || !on_stack) {
+        free(order);
+        free(low);
+        free(edge);
+        free(call);
+        free(stack);
+        free(label);
+        free(on_stack);
         return NG_OOM;
     }
-    for (i = 0; i < g->nn; i++)
-        if (!seen[i]) {
-            size_t head = 0, tail = 0;
-            seen[i] = 1;
-            q[tail++] = i;
-            while (head < tail) {
-                size_t cur = q[head++], j;
-                out[cur].node = g->no[cur].id;
-                out[cur].component = (uint64_t)component;
-                for (j = 0; j < g->nr; j++) {
-                    const rel_i* r = &g->re[j];
-                    ng_node_id other = 0;
-                    size_t p;
-                    if (!ng_analytics_rel_ok(r, type))
-                        continue;
-                    if (r->src == g->no[cur].id)
-                        other = r->dst;
-                    else if (r->dst == g->no[cur].id)
-                        other = r->src;
-                    else
-                        continue;
-                    p = ng_node_position(g, other);
-                    if (p != SIZE_MAX && !seen[p]) {
-                        seen[p] = 1;
-                        q[tail++] = p;
-                    }
+    for (i = 0; i < n; i++)
+        order[i] = SIZE_MAX;
+    for (i = 0; i < n; i++) {
+        if (order[i] != SIZE_MAX)
+            continue;
+        depth = 0;
+        call[depth++] = i;
+        order[i] = low[i] = counter++;
+        edge[i] = view->out_offsets[i];
+        stack[top++] = i;
+        on_stack[i] = 1;
+        while (depth) {
+            size_t v = call[depth - 1];
+            if (edge[v] < view->out_offsets[v + 1]) {
+                size_t w = view->out_nodes[edge[v]++];
+                if (order[w] == SIZE_MAX) {
+                    order[w] = low[w] = counter++;
+                    edge[w] = view->out_offsets[w];
+                    stack[top++] = w;
+                    on_stack[w] = 1;
+                    call[depth++] = w;
+                } else if (on_stack[w] && order[w] < low[v]) {
+                    low[v] = order[w];
                 }
-            }
-            component++;
-        }
-    free(seen);
-    free(q);
-    return NG_OK;
-}
-static ng_status ng_analytics_reach(
-    const ng_graph* g, size_t start, ng_symbol_id type, int reverse, unsigned char* seen) {
-    size_t *q, head = 0, tail = 0;
-    if (!seen)
-        return NG_INVALID_ARGUMENT;
-    q = (size_t*)malloc(g->nn * sizeof(*q));
-    if (g->nn && !q)
-        return NG_OOM;
-    seen[start] = 1;
-    q[tail++] = start;
-    while (head < tail) {
-        size_t cur = q[head++], i;
-        for (i = 0; i < g->nr; i++) {
-            const rel_i* r = &g->re[i];
-            size_t p = SIZE_MAX;
-            if (!ng_analytics_rel_ok(r, type))
                 continue;
-            if (!reverse && r->src == g->no[cur].id)
-                p = ng_node_position(g, r->dst);
-            else if (reverse && r->dst == g->no[cur].id)
-                p = ng_node_position(g, r->src);
-            if (p != SIZE_MAX && !seen[p]) {
-                seen[p] = 1;
-                q[tail++] = p;
+            }
+            depth--;
+            if (depth && low[v] < low[call[depth - 1]])
+                low[call[depth - 1]] = low[v];
+            if (low[v] == order[v]) {
+                size_t w;
+                do {
+                    w = stack[--top];
+                    on_stack[w] = 0;
+                    label[w] = v;
+                } while (w != v);
             }
         }
     }
-    free(q);
+    ng_component_emit(view, label, low, out);
+    free(order);
+    free(low);
+    free(edge);
+    free(call);
+    free(stack);
+    free(label);
+    free(on_stack);
     return NG_OK;
 }
 ng_status ng_strongly_connected_components(const ng_graph* g,
@@ -5448,92 +7168,217 @@ ng_status ng_strongly_connected_components(const ng_graph* g,
                                            ng_node_component* out,
                                            size_t capacity,
                                            size_t* out_count) {
-    unsigned char *assigned, *fwd, *rev;
-    size_t i, j, component = 0;
-    ng_status s;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    ng_analytics_view* view;
+    ng_status s = ng_analytics_check_output(g, type, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    assigned = (unsigned char*)calloc(g->nn, 1);
-    fwd = (unsigned char*)calloc(g->nn, 1);
-    rev = (unsigned char*)calloc(g->nn, 1);
-    if (g->nn && (!assigned || !fwd || !rev)) {
-        free(assigned);
-        free(fwd);
-        free(rev);
-        return NG_OOM;
+    s = ng_analytics_view_build(g, NG_DIRECTION_OUTGOING, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_strongly_connected_components_view(view, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
+}
+/* Degree-ordered triangle listing. Rows are rebuilt as sorted, duplicate-free undirected adjacency
+ * (filled in ascending node order, so no sort is needed), each edge is kept only at its
+ * lower-ranked end by (degree, position), and every triangle is found once by merging two oriented
+ * rows. Per node it reports distinct neighbours and adjacent neighbour pairs; a self-loop makes the
+ * node its own neighbour, which adds one degree and pairs it with each other neighbour. */
+static ng_status ng_analytics_view_triangles(const ng_analytics_view* view,
+                                             uint64_t* triangles,
+                                             size_t* degrees,
+                                             uint64_t* out_total) {
+    size_t *offsets, *rows, *fill, *up, i, k, n = view->node_count, total = 0, row_count;
+    unsigned char* loop;
+    uint64_t found = 0;
+    ng_status s = NG_OOM;
+    offsets = (size_t*)calloc(n + 1, sizeof(*offsets));
+    fill = (size_t*)malloc((n ? n : 1) * sizeof(*fill));
+    loop = (unsigned char*)calloc(n ? n : 1, 1);
+    rows = up = NULL;
+    if (!offsets || !fill || !loop)
+        goto done;
+    for (i = 0; i < n; i++) {
+        size_t side;
+        for (side = 0; side < ng_analytics_view_sides(view); side++) {
+            const size_t* row = ng_analytics_view_row(view, side, i, &row_count);
+            for (k = 0; k < row_count; k++)
+                offsets[row[k] + 1]++;
+        }
     }
-    for (i = 0; i < g->nn; i++)
-        if (!assigned[i]) {
-            memset(fwd, 0, g->nn);
-            memset(rev, 0, g->nn);
-            s = ng_analytics_reach(g, i, type, 0, fwd);
-            if (s == NG_OK)
-                s = ng_analytics_reach(g, i, type, 1, rev);
-            if (s != NG_OK) {
-                free(assigned);
-                free(fwd);
-                free(rev);
-                return s;
-            }
-            for (j = 0; j < g->nn; j++)
-                if (!assigned[j] && fwd[j] && rev[j]) {
-                    assigned[j] = 1;
-                    out[j].node = g->no[j].id;
-                    out[j].component = (uint64_t)component;
+    for (i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+    total = offsets[n];
+    rows = (size_t*)malloc((total ? total : 1) * sizeof(*rows));
+    if (!rows)
+        goto done;
+    memcpy(fill, offsets, n * sizeof(*fill));
+    for (i = 0; i < n; i++) {
+        size_t side;
+        for (side = 0; side < ng_analytics_view_sides(view); side++) {
+            const size_t* row = ng_analytics_view_row(view, side, i, &row_count);
+            for (k = 0; k < row_count; k++)
+                rows[fill[row[k]]++] = i;
+        }
+    }
+    /* Compact each sorted row in place: drop duplicates and the node itself. */
+    for (i = 0, total = 0; i < n; i++) {
+        size_t start = total, previous = SIZE_MAX;
+        for (k = offsets[i]; k < offsets[i + 1]; k++)
+            if (rows[k] == i)
+                loop[i] = 1;
+            else if (rows[k] != previous)
+                rows[total++] = previous = rows[k];
+        offsets[i] = start;
+        fill[i] = total - start;
+    }
+    offsets[n] = total;
+    up = (size_t*)malloc((total ? total : 1) * sizeof(*up));
+    if (!up)
+        goto done;
+    /* fill[i] now holds the distinct degree; reuse offsets as the oriented row starts. */
+    for (i = 0, total = 0; i < n; i++) {
+        size_t start = total, end = offsets[i + 1];
+        for (k = offsets[i]; k < end; k++) {
+            size_t u = rows[k];
+            if (fill[u] > fill[i] || (fill[u] == fill[i] && u > i))
+                up[total++] = u;
+        }
+        offsets[i] = start;
+    }
+    offsets[n] = total;
+    if (triangles)
+        memset(triangles, 0, n * sizeof(*triangles));
+    for (i = 0; i < n; i++) {
+        size_t end_i = offsets[i + 1];
+        for (k = offsets[i]; k < end_i; k++) {
+            size_t u = up[k], a = offsets[i], b = offsets[u], end_u = offsets[u + 1];
+            while (a < end_i && b < end_u) {
+                if (up[a] < up[b])
+                    a++;
+                else if (up[a] > up[b])
+                    b++;
+                else {
+                    found++;
+                    if (triangles) {
+                        triangles[i]++;
+                        triangles[u]++;
+                        triangles[up[a]]++;
+                    }
+                    a++;
+                    b++;
                 }
-            component++;
+            }
         }
-    free(assigned);
-    free(fwd);
-    free(rev);
-    return NG_OK;
+    }
+    for (i = 0; i < n; i++) {
+        if (triangles && loop[i])
+            triangles[i] += fill[i];
+        if (degrees)
+            degrees[i] = fill[i] + loop[i];
+    }
+    if (out_total)
+        *out_total = found;
+    s = NG_OK;
+done:
+    free(offsets);
+    free(rows);
+    free(fill);
+    free(up);
+    free(loop);
+    return s;
+}
+ng_status ng_triangle_count_view(const ng_analytics_view* view,
+                                 ng_node_metric* out,
+                                 size_t capacity,
+                                 size_t* out_count) {
+    uint64_t* triangles;
+    size_t *degrees, i, n;
+    ng_status s = ng_analytics_view_check(view, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    n = view->node_count;
+    triangles = (uint64_t*)malloc((n ? n : 1) * sizeof(*triangles));
+    degrees = (size_t*)malloc((n ? n : 1) * sizeof(*degrees));
+    if (!triangles || !degrees)
+        s = NG_OOM;
+    else
+        s = ng_analytics_view_triangles(view, triangles, degrees, NULL);
+    for (i = 0; s == NG_OK && i < n; i++) {
+        out[i].node = view->nodes[i];
+        out[i].value = triangles[i];
+    }
+    free(triangles);
+    free(degrees);
+    return s;
+}
+ng_status ng_local_clustering_coefficient_view(const ng_analytics_view* view,
+                                               ng_node_score* out,
+                                               size_t capacity,
+                                               size_t* out_count) {
+    uint64_t* triangles;
+    size_t *degrees, i, n;
+    ng_status s = ng_analytics_view_check(view, out, capacity, out_count);
+    if (s != NG_OK)
+        return s;
+    n = view->node_count;
+    triangles = (uint64_t*)malloc((n ? n : 1) * sizeof(*triangles));
+    degrees = (size_t*)malloc((n ? n : 1) * sizeof(*degrees));
+    if (!triangles || !degrees)
+        s = NG_OOM;
+    else
+        s = ng_analytics_view_triangles(view, triangles, degrees, NULL);
+    for (i = 0; s == NG_OK && i < n; i++) {
+        double d = (double)degrees[i];
+        out[i].node = view->nodes[i];
+        out[i].score = degrees[i] < 2 ? 0.0 : (2.0 * (double)triangles[i]) / (d * (d - 1.0));
+    }
+    free(triangles);
+    free(degrees);
+    return s;
+}
+ng_status ng_triangle_count_total_view(const ng_analytics_view* view, uint64_t* out_total) {
+    if (!view || !out_total)
+        return NG_INVALID_ARGUMENT;
+    return ng_analytics_view_triangles(view, NULL, NULL, out_total);
+}
+ng_status ng_triangle_count_total(const ng_graph* g, ng_symbol_id type, uint64_t* out_total) {
+    ng_analytics_view* view;
+    ng_status s;
+    if (!g || !out_total)
+        return NG_INVALID_ARGUMENT;
+    s = ng_analytics_view_build(g, NG_DIRECTION_EITHER, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_analytics_view_triangles(view, NULL, NULL, out_total);
+    ng_analytics_view_free(view);
+    return s;
 }
 ng_status ng_triangle_count(
     const ng_graph* g, ng_symbol_id type, ng_node_metric* out, size_t capacity, size_t* out_count) {
-    size_t i;
-    ng_status s;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    ng_analytics_view* view;
+    ng_status s = ng_analytics_check_output(g, type, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    for (i = 0; i < g->nn; i++) {
-        size_t *a = NULL, n = 0, j, k;
-        uint64_t triangles = 0;
-        s = ng_analytics_neighbors(g, i, type, &a, &n);
-        if (s != NG_OK)
-            return s;
-        for (j = 0; j < n; j++)
-            for (k = j + 1; k < n; k++)
-                if (ng_analytics_adjacent(g, a[j], a[k], type))
-                    triangles++;
-        out[i].node = g->no[i].id;
-        out[i].value = triangles;
-        free(a);
-    }
-    return NG_OK;
+    s = ng_analytics_view_build(g, NG_DIRECTION_EITHER, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_triangle_count_view(view, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
 }
 ng_status ng_local_clustering_coefficient(
     const ng_graph* g, ng_symbol_id type, ng_node_score* out, size_t capacity, size_t* out_count) {
-    size_t i;
-    ng_status s;
-    s = ng_analytics_check_output(g, type, out, capacity, out_count);
+    ng_analytics_view* view;
+    ng_status s = ng_analytics_check_output(g, type, out, capacity, out_count);
     if (s != NG_OK)
         return s;
-    for (i = 0; i < g->nn; i++) {
-        size_t *a = NULL, n = 0, j, k;
-        uint64_t links = 0;
-        s = ng_analytics_neighbors(g, i, type, &a, &n);
-        if (s != NG_OK)
-            return s;
-        for (j = 0; j < n; j++)
-            for (k = j + 1; k < n; k++)
-                if (ng_analytics_adjacent(g, a[j], a[k], type))
-                    links++;
-        out[i].node = g->no[i].id;
-        out[i].score = n < 2 ? 0.0 : (2.0 * (double)links) / ((double)n * (double)(n - 1));
-        free(a);
-    }
-    return NG_OK;
+    s = ng_analytics_view_build(g, NG_DIRECTION_EITHER, type, 0, &view);
+    if (s != NG_OK)
+        return s;
+    s = ng_local_clustering_coefficient_view(view, out, capacity, out_count);
+    ng_analytics_view_free(view);
+    return s;
 }
 ng_status ng_common_neighbors(
     const ng_graph* g, ng_node_id a, ng_node_id b, ng_symbol_id type, uint64_t* out) {
@@ -6147,11 +7992,8 @@ ng_status ng_validate(const ng_graph* g) {
                 return NG_CORRUPT;
     }
     for (i = 0; i < g->nn; i++) {
-        if (!g->no[i].id || g->no[i].id >= g->next_node)
+        if (!g->no[i].id || g->no[i].id >= g->next_node || (i && g->no[i - 1].id >= g->no[i].id))
             return NG_CORRUPT;
-        for (j = 0; j < i; j++)
-            if (g->no[j].id == g->no[i].id)
-                return NG_CORRUPT;
         for (j = 0; j < g->no[i].nl; j++) {
             if (!g->no[i].labels[j] || !ng_symbol_name(g, g->no[i].labels[j]))
                 return NG_CORRUPT;
@@ -6170,11 +8012,9 @@ ng_status ng_validate(const ng_graph* g) {
     }
     for (i = 0; i < g->nr; i++) {
         if (!g->re[i].id || g->re[i].id >= g->next_rel || !node((ng_graph*)g, g->re[i].src) ||
-            !node((ng_graph*)g, g->re[i].dst) || !ng_symbol_name(g, g->re[i].type))
+            !node((ng_graph*)g, g->re[i].dst) || !ng_symbol_name(g, g->re[i].type) ||
+            (i && g->re[i - 1].id >= g->re[i].id))
             return NG_CORRUPT;
-        for (j = 0; j < i; j++)
-            if (g->re[j].id == g->re[i].id)
-                return NG_CORRUPT;
         for (j = 0; j < g->re[i].np; j++) {
             if (!g->re[i].p[j].key || !ng_symbol_name(g, g->re[i].p[j].key) ||
                 !ng_valid_value(&g->re[i].p[j].v))
@@ -6261,6 +8101,42 @@ static int ng_value_equal(const ng_value* a, const ng_value* b) {
     }
     return 0;
 }
+static uint32_t ng_value_hash_from(uint32_t h, const ng_value* v) {
+    unsigned char t = (unsigned char)v->type;
+    size_t i;
+    h = hash32(h, &t, 1);
+    switch (v->type) {
+    case NG_VALUE_BOOL:
+        t = (unsigned char)(v->as.boolean != 0);
+        return hash32(h, &t, 1);
+    case NG_VALUE_INT64:
+        return hash32(h, &v->as.integer, sizeof(v->as.integer));
+    case NG_VALUE_DOUBLE:
+        return hash32(h, &v->as.real, sizeof(v->as.real));
+    case NG_VALUE_STRING:
+        return v->length ? hash32(h, v->as.string, v->length) : h;
+    case NG_VALUE_BYTES:
+        return v->length ? hash32(h, v->as.bytes, v->length) : h;
+    case NG_VALUE_LIST:
+        h = hash32(h, &v->length, sizeof(v->length));
+        if (v->as.list)
+            for (i = 0; i < v->as.list->count; i++)
+                h = ng_value_hash_from(h, &v->as.list->items[i]);
+        return h;
+    case NG_VALUE_MAP:
+        if (v->as.map)
+            for (i = 0; i < v->as.map->count; i++) {
+                h = hash32(h, v->as.map->entries[i].key, strlen(v->as.map->entries[i].key));
+                h = ng_value_hash_from(h, &v->as.map->entries[i].value);
+            }
+        return h;
+    default:
+        return h;
+    }
+}
+static uint32_t ng_value_hash(const ng_value* v) {
+    return ng_value_hash_from(2166136261u, v);
+}
 static int ng_query_compare_match(const ng_value* a, const ng_value* b, int op);
 static int ng_param_name_equal(const char* a, const char* b, size_t n) {
     return a && b && strlen(a) == n && !memcmp(a, b, n);
@@ -6346,12 +8222,25 @@ ng_status ng_require_node_property(const ng_graph* g,
         }
     return NG_OK;
 }
+typedef struct {
+    uint32_t hash;
+    size_t index;
+    const ng_value* value;
+} ng_unique_entry;
+static int ng_compare_unique_entries(const void* a, const void* b) {
+    const ng_unique_entry* x = (const ng_unique_entry*)a;
+    const ng_unique_entry* y = (const ng_unique_entry*)b;
+    if (x->hash != y->hash)
+        return x->hash < y->hash ? -1 : 1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
 ng_status ng_unique_node_property(const ng_graph* g,
                                   ng_symbol_id label,
                                   ng_symbol_id key,
                                   ng_node_id* out_first,
                                   ng_node_id* out_second) {
-    size_t i, j;
+    ng_unique_entry* entries;
+    size_t i, j, k, count = 0, first = SIZE_MAX, second = SIZE_MAX;
     if (!g || !key)
         return NG_INVALID_ARGUMENT;
     if (label && !ng_symbol_name(g, label))
@@ -6362,24 +8251,42 @@ ng_status ng_unique_node_property(const ng_graph* g,
         *out_first = 0;
     if (out_second)
         *out_second = 0;
+    entries = (ng_unique_entry*)malloc((g->nn ? g->nn : 1) * sizeof(*entries));
+    if (!entries)
+        return NG_OOM;
     for (i = 0; i < g->nn; i++)
         if (ng_node_matches_label(&g->no[i], label)) {
             const prop* a = findprop(g->no[i].p, g->no[i].np, key);
             if (!a || a->v.type == NG_VALUE_NULL)
                 continue;
-            for (j = i + 1; j < g->nn; j++)
-                if (ng_node_matches_label(&g->no[j], label)) {
-                    const prop* b = findprop(g->no[j].p, g->no[j].np, key);
-                    if (b && b->v.type != NG_VALUE_NULL && ng_value_equal(&a->v, &b->v)) {
-                        if (out_first)
-                            *out_first = g->no[i].id;
-                        if (out_second)
-                            *out_second = g->no[j].id;
-                        return NG_EXISTS;
-                    }
+            entries[count].hash = ng_value_hash(&a->v);
+            entries[count].index = i;
+            entries[count++].value = &a->v;
+        }
+    qsort(entries, count, sizeof(*entries), ng_compare_unique_entries);
+    for (i = 0; i < count; i = j) {
+        for (j = i + 1; j < count && entries[j].hash == entries[i].hash; j++)
+            ;
+        for (k = i; k < j && entries[k].index < first; k++) {
+            size_t m;
+            for (m = k + 1; m < j; m++)
+                if (ng_value_equal(entries[k].value, entries[m].value)) {
+                    first = entries[k].index;
+                    second = entries[m].index;
+                    break;
                 }
+            if (m < j)
+                break;
         }
-    return NG_OK;
+    }
+    free(entries);
+    if (first == SIZE_MAX)
+        return NG_OK;
+    if (out_first)
+        *out_first = g->no[first].id;
+    if (out_second)
+        *out_second = g->no[second].id;
+    return NG_EXISTS;
 }
 static ng_status ng_check_one_constraint(const ng_graph* g, const constraint_i* c) {
     ng_node_id a = 0, b = 0;
@@ -6428,6 +8335,7 @@ ng_status ng_node_constraint_create(ng_graph* g,
     if (!grow((void**)&g->co, &g->cc, g->nc + 1, sizeof(*g->co)))
         return NG_OOM;
     g->co[g->nc++] = c;
+    ng_graph_bump(g);
     return NG_OK;
 }
 ng_status ng_node_constraint_drop(ng_graph* g,
@@ -6442,6 +8350,7 @@ ng_status ng_node_constraint_drop(ng_graph* g,
             if (i + 1 < g->nc)
                 memmove(&g->co[i], &g->co[i + 1], (g->nc - i - 1) * sizeof(*g->co));
             g->nc--;
+            ng_graph_bump(g);
             return NG_OK;
         }
     return NG_NOT_FOUND;
@@ -6479,6 +8388,7 @@ ng_status ng_node_index_create(ng_graph* g, ng_symbol_id label, ng_symbol_id key
     g->ix[g->nix].label = label;
     g->ix[g->nix].key = key;
     g->nix++;
+    ng_graph_bump(g);
     return NG_OK;
 }
 ng_status ng_node_index_drop(ng_graph* g, ng_symbol_id label, ng_symbol_id key) {
@@ -6490,6 +8400,7 @@ ng_status ng_node_index_drop(ng_graph* g, ng_symbol_id label, ng_symbol_id key)
             if (i + 1 < g->nix)
                 memmove(&g->ix[i], &g->ix[i + 1], (g->nix - i - 1) * sizeof(*g->ix));
             g->nix--;
+            ng_graph_bump(g);
             return NG_OK;
         }
     return NG_NOT_FOUND;
@@ -6603,6 +8514,7 @@ ng_procedure_register(ng_graph* g, const char* name, ng_procedure_handler handle
     g->procedures[g->procedure_count].handler = handler;
     g->procedures[g->procedure_count].context = context;
     g->procedure_count++;
+    ng_graph_bump(g);
     return NG_OK;
 }
 ng_status ng_procedure_unregister(ng_graph* g, const char* name) {
@@ -6617,6 +8529,7 @@ ng_status ng_procedure_unregister(ng_graph* g, const char* name) {
                         &g->procedures[i + 1],
                         (g->procedure_count - i - 1) * sizeof(*g->procedures));
             g->procedure_count--;
+            ng_graph_bump(g);
             return NG_OK;
         }
     return NG_NOT_FOUND;
@@ -7651,13 +9564,6 @@ static int ng_query_node_order_compare(const void* a, const void* b) {
         c = (*x)->id > (*y)->id ? 1 : (*x)->id < (*y)->id ? -1 : 0;
     return ng_query_sort_plan->order_desc ? -c : c;
 }
-static size_t ng_node_position(const ng_graph* g, ng_node_id id) {
-    size_t i;
-    for (i = 0; i < g->nn; i++)
-        if (g->no[i].id == id)
-            return i;
-    return SIZE_MAX;
-}
 static ng_status ng_query_print_generic(const ng_graph* g, const char* q, FILE* out, int* handled);
 ng_status ng_query_nodes(const ng_graph* g, const char* q, ng_node_match_visitor visit, void* ctx) {
     ng_query_plan plan;
@@ -8294,6 +10200,23 @@ static ng_status ng_query_parameters_cover_query(const char* q, const ng_paramet
     }
     return NG_OK;
 }
+typedef ng_status (*ng_query_cache_run)(
+    ng_graph* g, const char* q, const ng_parameter* p, size_t n, FILE* out);
+static ng_status ng_query_cache_execute(ng_graph* g,
+                                        const char* q,
+                                        const ng_parameter* p,
+                                        size_t n,
+                                        FILE* out,
+                                        ng_query_cache_run run);
+static ng_status
+ng_query_print_run(ng_graph* g, const char* q, const ng_parameter* p, size_t n, FILE* out) {
+    ng_status s = ng_query_print_active(g, q, out);
+    (void)p;
+    (void)n;
+    if (s == NG_OK && ng_query_parameter_error)
+        s = NG_NOT_FOUND;
+    return s;
+}
 ng_status ng_query_print_params(
     const ng_graph* g, const char* q, const ng_parameter* p, size_t n, FILE* out) {
     const ng_parameter* oldp = ng_query_parameters;
@@ -8308,9 +10231,10 @@ ng_status ng_query_print_params(
     ng_query_parameters = p;
     ng_query_parameter_count = n;
     ng_query_parameter_error = 0;
-    s = ng_query_print_active(g, q, out);
-    if (s == NG_OK && ng_query_parameter_error)
-        s = NG_NOT_FOUND;
+    if (g && q && out)
+        s = ng_query_cache_execute((ng_graph*)g, q, p, n, out, ng_query_print_run);
+    else
+        s = ng_query_print_active(g, q, out);
     ng_query_parameters = oldp;
     ng_query_parameter_count = oldn;
     ng_query_parameter_error = olde;
@@ -8384,12 +10308,20 @@ static ng_status ng_query_parse_prop_map(const char** pp, ng_query_prop* props,
 }
 #define NG_CY_MAX_VARS 24
 #define NG_CY_MAX_MATCHES 8
-#define NG_CY_MAX_NODES 8
-#define NG_CY_MAX_RELS 7
 #define NG_CY_MAX_PATH_LENGTH 64
-#define NG_CY_MAX_RETURNS 8
+#define NG_CY_MAX_NODES (NG_CY_MAX_PATH_LENGTH + 1)
+#define NG_CY_MAX_RELS NG_CY_MAX_PATH_LENGTH
+#define NG_CY_MAX_RETURNS 32
 #define NG_CY_MAX_ROWS 4096
-#define NG_CY_MAX_SCALARS 32
+#define NG_CY_ARENA_BLOCK 4096
+typedef struct ng_cy_block ng_cy_block;
+struct ng_cy_block {
+    ng_cy_block* next;
+    size_t used, capacity;
+};
+/* Block data starts past the header rounded up to 16 bytes, so ng_cy_alloc() results keep the
+ * 16-byte alignment malloc() gives the block itself. */
+#define NG_CY_BLOCK_HEADER ((sizeof(ng_cy_block) + 15) & ~(size_t)15)
 typedef struct {
     char name[64];
     int kind, in_scope;
@@ -8410,10 +10342,10 @@ typedef struct {
     uint32_t min_depth, max_depth;
 } ng_cy_rel_pat;
 typedef struct {
-    ng_cy_node_pat nodes[NG_CY_MAX_NODES];
-    ng_cy_rel_pat rels[NG_CY_MAX_RELS];
-    size_t node_count, rel_count;
-    int path_var_index;
+    ng_cy_node_pat* nodes;
+    ng_cy_rel_pat* rels;
+    size_t node_count, rel_count, node_capacity, rel_capacity;
+    int path_var_index, shortest;
 } ng_cy_match;
 typedef struct {
     ng_id nodes[NG_CY_MAX_PATH_LENGTH + 1];
@@ -8421,16 +10353,18 @@ typedef struct {
     size_t node_count, relationship_count;
 } ng_cy_path;
 typedef struct {
-    int kind, left, right, var_index, is_property, is_id, list_count, direct_binding,
-        list_items[NG_QUERY_MAX_LIST_VALUES];
+    int kind, left, right, var_index, is_property, is_id, list_count, direct_binding;
+    int* list_items;
+    size_t list_capacity;
     int slice_start, slice_end;
     int comprehension_var, comprehension_source, comprehension_filter, comprehension_value;
     int case_operand, case_simple;
     char key[128];
+    ng_symbol_id key_id;
     ng_value value;
-    size_t map_count;
-    char map_keys[NG_QUERY_MAX_PROPS][128];
-    int map_items[NG_QUERY_MAX_PROPS];
+    size_t map_count, map_capacity;
+    const char** map_keys;
+    int* map_items;
 } ng_cy_scalar;
 typedef struct {
     int var_index, is_property, is_id, scalar_index, out_var_index, out_kind, aggregate,
@@ -8443,26 +10377,82 @@ typedef struct {
 typedef struct {
     int var_index, is_id, op, value_count;
     char key[128];
-    ng_value value, values[NG_QUERY_MAX_LIST_VALUES];
+    ng_value value, *values;
+    size_t value_capacity;
 } ng_cy_term;
 typedef struct {
     int kind, left, right, term;
 } ng_cy_expr;
 typedef struct {
+    ng_cy_block* arena;
     ng_cy_var vars[NG_CY_MAX_VARS];
     size_t var_count;
-    ng_cy_match matches[NG_CY_MAX_MATCHES];
-    size_t match_count;
-    ng_cy_projection returns[NG_CY_MAX_RETURNS];
+    ng_cy_match *matches, *patterns;
+    size_t match_count, match_capacity, pattern_count, pattern_capacity;
+    ng_cy_projection* returns;
     size_t return_count;
-    ng_cy_term terms[NG_QUERY_MAX_TERMS];
-    ng_cy_expr exprs[NG_QUERY_MAX_EXPR];
-    ng_cy_scalar scalars[NG_CY_MAX_SCALARS];
+    ng_cy_term* terms;
+    ng_cy_expr* exprs;
+    ng_cy_scalar* scalars;
+    size_t term_capacity, expr_capacity, scalar_capacity;
     int term_count, expr_count, scalar_count, where_root, has_where, has_skip, has_limit, distinct,
         create_mode;
-    char merge_on_create[4096], merge_on_match[4096];
+    const char *merge_on_create, *merge_on_match;
     uint64_t skip, limit;
 } ng_cy_query;
+static void* ng_cy_alloc(ng_cy_query* q, size_t size) {
+    ng_cy_block* b = q->arena;
+    unsigned char* out;
+    if (size > SIZE_MAX / 2)
+        return NULL;
+    size = size ? (size + 15) & ~(size_t)15 : 16;
+    if (!b || b->capacity - b->used < size) {
+        size_t capacity = b && b->capacity < (1u << 20) ? b->capacity * 2 : NG_CY_ARENA_BLOCK;
+        if (capacity < size)
+            capacity = size;
+        b = (ng_cy_block*)malloc(NG_CY_BLOCK_HEADER + capacity);
+        if (!b)
+            return NULL;
+        b->next = q->arena;
+        b->used = 0;
+        b->capacity = capacity;
+        q->arena = b;
+    }
+    out = (unsigned char*)b + NG_CY_BLOCK_HEADER + b->used;
+    b->used += size;
+    memset(out, 0, size);
+    return out;
+}
+static int ng_cy_reserve(ng_cy_query* q, void** items, size_t* capacity, size_t count, size_t size) {
+    void* next;
+    size_t n;
+    if (count < *capacity)
+        return 1;
+    n = *capacity ? *capacity * 2 : 4;
+    if (n > SIZE_MAX / 2 / size)
+        return 0;
+    next = ng_cy_alloc(q, n * size);
+    if (!next)
+        return 0;
+    if (count)
+        memcpy(next, *items, count * size);
+    *items = next;
+    *capacity = n;
+    return 1;
+}
+static const char* ng_cy_strndup(ng_cy_query* q, const char* text, size_t length) {
+    char* out = (char*)ng_cy_alloc(q, length + 1);
+    if (out)
+        memcpy(out, text, length);
+    return out;
+}
+static void ng_cy_query_free(ng_cy_query* q) {
+    while (q->arena) {
+        ng_cy_block* next = q->arena->next;
+        free(q->arena);
+        q->arena = next;
+    }
+}
 typedef struct {
     ng_value values[NG_CY_MAX_RETURNS];
 } ng_cy_result_key;
@@ -8487,12 +10477,98 @@ typedef struct {
     int type_known[NG_CY_MAX_RETURNS];
 } ng_query_schema;
 static ng_query_schema* ng_query_active_schema;
+/* Parameter batches parse a query once when its execution path has a separate parse step (kind 1
+ * for CREATE, 2 for MATCH ... RETURN). While set, the first row hands its parsed query over here
+ * instead of freeing it. */
+typedef struct {
+    int kind;
+    ng_cy_query cy;
+} ng_cy_prepared;
+static ng_cy_prepared* ng_query_active_prepared;
+static ng_cy_prepared* ng_query_take_prepared(void) {
+    ng_cy_prepared* prep = ng_query_active_prepared;
+    ng_query_active_prepared = NULL;
+    return prep;
+}
+typedef struct {
+    const char* op;
+    size_t rows_in, rows_out, relationships, index_hits, peak_bytes;
+    double wall_ms;
+} ng_query_profile_entry;
+typedef struct {
+    ng_query_profile_entry* entries;
+    size_t count, cap;
+    size_t relationships, index_hits, emitted, bytes;
+    int failed;
+} ng_query_profile_state;
+typedef struct {
+    double start;
+    size_t relationships, index_hits, emitted;
+} ng_query_profile_mark;
+static ng_query_profile_state* ng_query_active_profile;
+/* Elapsed milliseconds from a monotonic clock; clock() is the fallback where none exists. */
+static double ng_query_profile_now(void) {
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#endif
+    return (double)clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+static void ng_query_profile_begin(ng_query_profile_mark* m) {
+    ng_query_profile_state* pr = ng_query_active_profile;
+    memset(m, 0, sizeof(*m));
+    if (!pr)
+        return;
+    m->relationships = pr->relationships;
+    m->index_hits = pr->index_hits;
+    m->emitted = pr->emitted;
+    pr->bytes = 0;
+    m->start = ng_query_profile_now();
+}
+static void ng_query_profile_bytes(size_t bytes) {
+    if (ng_query_active_profile && bytes > ng_query_active_profile->bytes)
+        ng_query_active_profile->bytes = bytes;
+}
+static size_t ng_query_profile_emitted(const ng_query_profile_mark* m) {
+    return ng_query_active_profile ? ng_query_active_profile->emitted - m->emitted : 0;
+}
+static void ng_query_profile_end(const ng_query_profile_mark* m,
+                                 const char* op,
+                                 size_t rows_in,
+                                 size_t rows_out) {
+    ng_query_profile_state* pr = ng_query_active_profile;
+    ng_query_profile_entry* e;
+    double now;
+    if (!pr)
+        return;
+    now = ng_query_profile_now();
+    if (!grow((void**)&pr->entries, &pr->cap, pr->count + 1, sizeof(*pr->entries))) {
+        pr->failed = 1;
+        return;
+    }
+    e = &pr->entries[pr->count++];
+    e->op = op;
+    e->rows_in = rows_in;
+    e->rows_out = rows_out;
+    e->relationships = pr->relationships - m->relationships;
+    e->index_hits = pr->index_hits - m->index_hits;
+    e->wall_ms = now - m->start;
+    e->peak_bytes = (rows_in + rows_out) * sizeof(ng_cy_row) + pr->bytes;
+}
 static ng_status ng_cy_parse_create_pattern(const char** pp, ng_cy_query* out);
 static ng_status
 ng_cy_execute_create_match(ng_graph* g, ng_cy_query* q, const ng_cy_match* m, ng_cy_row* row);
 static ng_status ng_cy_parse_scalar_add(const char** pp, ng_cy_query* q, int* out);
 static ng_status ng_cy_eval_scalar(
     const ng_graph* g, const ng_cy_query* q, const ng_cy_row* row, int index, ng_value* out);
+static void ng_cy_prepare_scalars(const ng_graph* g, ng_cy_query* q) {
+    int i;
+    for (i = 0; i < q->scalar_count; i++)
+        if (q->scalars[i].kind == 1 && q->scalars[i].key[0] && !q->scalars[i].key_id &&
+            strcmp(q->scalars[i].key, "id"))
+            q->scalars[i].key_id = ng_symbol_id_by_text(g, q->scalars[i].key);
+}
 static int ng_cy_scalar_temporary(const ng_cy_query* q, int index) {
     int kind;
     if (index < 0 || index >= q->scalar_count)
@@ -8559,7 +10635,7 @@ static int ng_cy_var_lookup(ng_cy_query* q, const char* name) {
 }
 static int ng_cy_expr_add(ng_cy_query* q, int kind, int left, int right, int term) {
     int i = q->expr_count;
-    if (i >= NG_QUERY_MAX_EXPR)
+    if (!ng_cy_reserve(q, (void**)&q->exprs, &q->expr_capacity, (size_t)i, sizeof(*q->exprs)))
         return -1;
     q->exprs[i].kind = kind;
     q->exprs[i].left = left;
@@ -8577,8 +10653,9 @@ static ng_status ng_cy_add_inline_props(ng_cy_query* q,
     for (i = 0; i < prop_count; i++) {
         ng_cy_term* t;
         int term, node;
-        if (q->term_count >= NG_QUERY_MAX_TERMS)
-            return NG_PARSE_ERROR;
+        if (!ng_cy_reserve(
+                q, (void**)&q->terms, &q->term_capacity, (size_t)q->term_count, sizeof(*t)))
+            return NG_OOM;
         term = q->term_count;
         t = &q->terms[term];
         memset(t, 0, sizeof(*t));
@@ -8746,13 +10823,20 @@ static ng_status ng_cy_parse_rel(const char** pp, ng_cy_query* q, ng_cy_rel_pat*
     if (*p == '*') {
         out->has_var_length = 1;
         p = ng_skip_ws(p + 1);
-        if (ng_query_parse_uint64(&p, &a) != NG_OK || a < 1 || a > 64)
-            return NG_PARSE_ERROR;
-        b = a;
-        p = ng_skip_ws(p);
+        a = 1;
+        b = NG_CY_MAX_PATH_LENGTH;
+        if (isdigit((unsigned char)*p)) {
+            if (ng_query_parse_uint64(&p, &a) != NG_OK || a < 1 || a > NG_CY_MAX_PATH_LENGTH)
+                return NG_PARSE_ERROR;
+            b = a;
+            p = ng_skip_ws(p);
+            if (p[0] == '.' && p[1] == '.')
+                b = NG_CY_MAX_PATH_LENGTH;
+        }
         if (p[0] == '.' && p[1] == '.') {
             p = ng_skip_ws(p + 2);
-            if (ng_query_parse_uint64(&p, &b) != NG_OK || b < a || b > 64)
+            if (isdigit((unsigned char)*p) &&
+                (ng_query_parse_uint64(&p, &b) != NG_OK || b < a || b > NG_CY_MAX_PATH_LENGTH))
                 return NG_PARSE_ERROR;
         }
         out->min_depth = (uint32_t)a;
@@ -8794,12 +10878,38 @@ static ng_status ng_cy_parse_rel(const char** pp, ng_cy_query* q, ng_cy_rel_pat*
     *pp = p;
     return NG_OK;
 }
+static int ng_cy_match_reserve(ng_cy_query* q, ng_cy_match* m) {
+    return ng_cy_reserve(q, (void**)&m->nodes, &m->node_capacity, m->node_count, sizeof(*m->nodes)) &&
+           ng_cy_reserve(q, (void**)&m->rels, &m->rel_capacity, m->rel_count, sizeof(*m->rels));
+}
+static ng_status ng_cy_parse_chain(const char** pp, ng_cy_query* q, ng_cy_match* m) {
+    const char* p = *pp;
+    if (!ng_cy_match_reserve(q, m))
+        return NG_OOM;
+    if (ng_cy_parse_node(&p, q, &m->nodes[m->node_count++]) != NG_OK)
+        return NG_PARSE_ERROR;
+    for (;;) {
+        p = ng_skip_ws(p);
+        if (*p != '-' && *p != '<')
+            break;
+        if (m->rel_count >= NG_CY_MAX_RELS || m->node_count >= NG_CY_MAX_NODES)
+            return NG_PARSE_ERROR;
+        if (!ng_cy_match_reserve(q, m))
+            return NG_OOM;
+        if (ng_cy_parse_rel(&p, q, &m->rels[m->rel_count++]) != NG_OK)
+            return NG_PARSE_ERROR;
+        if (ng_cy_parse_node(&p, q, &m->nodes[m->node_count++]) != NG_OK)
+            return NG_PARSE_ERROR;
+    }
+    *pp = p;
+    return NG_OK;
+}
 static ng_status ng_cy_parse_match_pattern(const char** pp, ng_cy_query* q, const char* kw) {
     const char* p = ng_skip_ws(*pp);
     ng_cy_match* m;
     size_t k = strlen(kw);
-    if (q->match_count >= NG_CY_MAX_MATCHES)
-        return NG_PARSE_ERROR;
+    if (!ng_cy_reserve(q, (void**)&q->matches, &q->match_capacity, q->match_count, sizeof(*m)))
+        return NG_OOM;
     if (strncmp(p, kw, k) || !isspace((unsigned char)p[k]))
         return NG_PARSE_ERROR;
     p = ng_skip_ws(p + k);
@@ -8819,18 +10929,25 @@ static ng_status ng_cy_parse_match_pattern(const char** pp, ng_cy_query* q, cons
             }
         }
     }
-    if (ng_cy_parse_node(&p, q, &m->nodes[m->node_count++]) != NG_OK)
-        return NG_PARSE_ERROR;
-    for (;;) {
-        p = ng_skip_ws(p);
-        if (*p != '-' && *p != '<')
-            break;
-        if (m->rel_count >= NG_CY_MAX_RELS || m->node_count >= NG_CY_MAX_NODES)
-            return NG_PARSE_ERROR;
-        if (ng_cy_parse_rel(&p, q, &m->rels[m->rel_count++]) != NG_OK)
-            return NG_PARSE_ERROR;
-        if (ng_cy_parse_node(&p, q, &m->nodes[m->node_count++]) != NG_OK)
+    if (!strncmp(p, "shortestPath", 12) && *ng_skip_ws(p + 12) == '(') {
+        m->shortest = 1;
+        p = ng_skip_ws(ng_skip_ws(p + 12) + 1);
+    } else if (!strncmp(p, "allShortestPaths", 16) && *ng_skip_ws(p + 16) == '(') {
+        m->shortest = 2;
+        p = ng_skip_ws(ng_skip_ws(p + 16) + 1);
+    }
+    {
+        ng_status s = ng_cy_parse_chain(&p, q, m);
+        if (s != NG_OK)
+            return s;
+    }
+    if (m->shortest) {
+        /* As in Neo4j, a lower bound above 1 is rejected: the search stops at the first depth that
+         * reaches a target, so longer-than-shortest paths would be silently missed. */
+        if (*p != ')' || m->rel_count != 1 || m->rels[0].var_index >= 0 ||
+            m->rels[0].min_depth > 1)
             return NG_PARSE_ERROR;
+        p++;
     }
     q->match_count++;
     *pp = p;
@@ -8844,8 +10961,9 @@ static ng_status ng_cy_parse_term(const char** pp, ng_cy_query* q) {
     char name[64];
     ng_cy_term* t;
     size_t n;
-    if (q->term_count >= NG_QUERY_MAX_TERMS)
-        return NG_PARSE_ERROR;
+    if (!ng_cy_reserve(
+            q, (void**)&q->terms, &q->term_capacity, (size_t)q->term_count, sizeof(*t)))
+        return NG_OOM;
     t = &q->terms[q->term_count];
     memset(t, 0, sizeof(*t));
     if (!strncmp(p, "id(", 3)) {
@@ -8939,8 +11057,12 @@ static ng_status ng_cy_parse_term(const char** pp, ng_cy_query* q) {
         if (*p == ']')
             return NG_PARSE_ERROR;
         for (;;) {
-            if (t->value_count >= NG_QUERY_MAX_LIST_VALUES)
-                return NG_PARSE_ERROR;
+            if (!ng_cy_reserve(q,
+                               (void**)&t->values,
+                               &t->value_capacity,
+                               (size_t)t->value_count,
+                               sizeof(*t->values)))
+                return NG_OOM;
             if (ng_query_parse_value(&p, &t->values[t->value_count]) != NG_OK)
                 return NG_PARSE_ERROR;
             t->value_count++;
@@ -8970,10 +11092,94 @@ static ng_status ng_cy_parse_term(const char** pp, ng_cy_query* q) {
     *pp = ng_skip_ws(p);
     return NG_OK;
 }
+static int ng_cy_pattern_ahead(const char* p) {
+    int depth = 0;
+    char quote = 0;
+    for (; *p; p++) {
+        if (quote) {
+            if (*p == '\\' && p[1])
+                p++;
+            else if (*p == quote)
+                quote = 0;
+        } else if (*p == '"' || *p == '\'')
+            quote = *p;
+        else if (*p == '(')
+            depth++;
+        else if (*p == ')' && !--depth) {
+            p = ng_skip_ws(p + 1);
+            return *p == '-' || *p == '<';
+        }
+    }
+    return 0;
+}
+/* Pattern predicates may only reference variables bound earlier; their inline properties form a
+ * private filter checked at the end of each candidate path. */
+static ng_status ng_cy_parse_pattern_predicate(const char** pp, ng_cy_query* q, int* out) {
+    const char* p = *pp;
+    size_t vars = q->var_count, i, n;
+    int old_root = q->where_root, old_has = q->has_where, first, last, node;
+    ng_cy_match* m;
+    ng_status s;
+    if (!ng_cy_reserve(
+            q, (void**)&q->patterns, &q->pattern_capacity, q->pattern_count, sizeof(*m)))
+        return NG_OOM;
+    m = &q->patterns[q->pattern_count];
+    memset(m, 0, sizeof(*m));
+    m->path_var_index = -1;
+    q->where_root = -1;
+    s = ng_cy_parse_chain(&p, q, m);
+    node = q->where_root;
+    q->where_root = old_root;
+    q->has_where = old_has;
+    if (s != NG_OK)
+        return s;
+    if (!m->rel_count)
+        return NG_PARSE_ERROR;
+    for (i = vars; i < q->var_count; i++)
+        if (strncmp(q->vars[i].name, "__anon_", 7))
+            return NG_PARSE_ERROR;
+    first = m->nodes[0].var_index;
+    last = m->nodes[m->node_count - 1].var_index;
+    if ((first < 0 || first >= (int)vars) && last >= 0 && last < (int)vars) {
+        for (i = 0, n = m->node_count - 1; i < n; i++, n--) {
+            ng_cy_node_pat tmp = m->nodes[i];
+            m->nodes[i] = m->nodes[n];
+            m->nodes[n] = tmp;
+        }
+        for (i = 0, n = m->rel_count - 1; i < n; i++, n--) {
+            ng_cy_rel_pat tmp = m->rels[i];
+            m->rels[i] = m->rels[n];
+            m->rels[n] = tmp;
+        }
+        for (i = 0; i < m->rel_count; i++)
+            m->rels[i].dir = -m->rels[i].dir;
+    }
+    node = ng_cy_expr_add(q, 4, node, -1, (int)q->pattern_count++);
+    if (node < 0)
+        return NG_PARSE_ERROR;
+    *pp = ng_skip_ws(p);
+    *out = node;
+    return NG_OK;
+}
 static ng_status ng_cy_parse_or(const char** pp, ng_cy_query* q, int* out);
 static ng_status ng_cy_parse_primary(const char** pp, ng_cy_query* q, int* out) {
     const char* p = ng_skip_ws(*pp);
     int node, term;
+    if (!strncmp(p, "exists", 6) && *ng_skip_ws(p + 6) == '(') {
+        p = ng_skip_ws(ng_skip_ws(p + 6) + 1);
+        if (ng_cy_parse_pattern_predicate(&p, q, &node) != NG_OK || *p != ')')
+            return NG_PARSE_ERROR;
+        *pp = ng_skip_ws(p + 1);
+        *out = node;
+        return NG_OK;
+    }
+    if (*p == '(' && ng_cy_pattern_ahead(p)) {
+        if (ng_cy_parse_pattern_predicate(&p, q, &node) != NG_OK)
+            return NG_PARSE_ERROR;
+        *pp = p;
+        *out = node;
+        return NG_OK;
+    }
     if (!strncmp(p, "NOT", 3) && isspace((unsigned char)p[3])) {
         int child;
         p = ng_skip_ws(p + 3);
@@ -9057,7 +11263,8 @@ static int ng_cy_scalar_add(ng_cy_query* q,
                             const char* key,
                             const ng_value* value) {
     int i = q->scalar_count;
-    if (i >= NG_CY_MAX_SCALARS)
+    if (!ng_cy_reserve(
+            q, (void**)&q->scalars, &q->scalar_capacity, (size_t)i, sizeof(*q->scalars)))
         return -1;
     memset(&q->scalars[i], 0, sizeof(q->scalars[i]));
     q->scalars[i].kind = kind;
@@ -9071,6 +11278,17 @@ static int ng_cy_scalar_add(ng_cy_query* q,
     q->scalar_count++;
     return i;
 }
+static int ng_cy_list_push(ng_cy_query* q, int scalar, int item) {
+    ng_cy_scalar* s = &q->scalars[scalar];
+    if (!ng_cy_reserve(q,
+                       (void**)&s->list_items,
+                       &s->list_capacity,
+                       (size_t)s->list_count,
+                       sizeof(*s->list_items)))
+        return 0;
+    s->list_items[s->list_count++] = item;
+    return 1;
+}
 static ng_status ng_cy_parse_scalar_add(const char** pp, ng_cy_query* q, int* out);
 static ng_status ng_cy_parse_scalar_atom(const char** pp, ng_cy_query* q, int* out) {
     const char *p = ng_skip_ws(*pp), *s;
@@ -9136,12 +11354,11 @@ static ng_status ng_cy_parse_scalar_atom(const char** pp, ng_cy_query* q, int* o
         p = ng_skip_ws(p + 1);
         if (*p != ']')
             for (;;) {
-                if (q->scalars[list].list_count >= NG_QUERY_MAX_LIST_VALUES)
-                    return NG_PARSE_ERROR;
-                if (ng_cy_parse_scalar_add(
-                        &p, q, &q->scalars[list].list_items[q->scalars[list].list_count]) != NG_OK)
+                int item;
+                if (ng_cy_parse_scalar_add(&p, q, &item) != NG_OK)
                     return NG_PARSE_ERROR;
-                q->scalars[list].list_count++;
+                if (!ng_cy_list_push(q, list, item))
+                    return NG_OOM;
                 p = ng_skip_ws(p);
                 if (*p != ',')
                     break;
@@ -9160,27 +11377,41 @@ static ng_status ng_cy_parse_scalar_atom(const char** pp, ng_cy_query* q, int* o
         p = ng_skip_ws(p + 1);
         if (*p != '}')
             for (;;) {
-                const char* key_start = p;
+                const char *key_start = p, *key;
                 size_t key_length;
                 int item;
-                if (q->scalars[map].map_count >= NG_QUERY_MAX_PROPS)
-                    return NG_PARSE_ERROR;
+                ng_cy_scalar* entry;
                 if (!ng_ident_char((unsigned char)*p) || isdigit((unsigned char)*p))
                     return NG_PARSE_ERROR;
                 while (ng_ident_char((unsigned char)*p))
                     p++;
                 key_length = (size_t)(p - key_start);
-                if (!key_length || key_length >= sizeof(q->scalars[map].map_keys[0]))
-                    return NG_PARSE_ERROR;
-                memcpy(q->scalars[map].map_keys[q->scalars[map].map_count], key_start, key_length);
-                q->scalars[map].map_keys[q->scalars[map].map_count][key_length] = 0;
+                key = ng_cy_strndup(q, key_start, key_length);
+                if (!key)
+                    return NG_OOM;
                 p = ng_skip_ws(p);
                 if (*p != ':')
                     return NG_PARSE_ERROR;
                 p = ng_skip_ws(p + 1);
                 if (ng_cy_parse_scalar_add(&p, q, &item) != NG_OK)
                     return NG_PARSE_ERROR;
-                q->scalars[map].map_items[q->scalars[map].map_count++] = item;
+                entry = &q->scalars[map];
+                if (entry->map_count >= entry->map_capacity) {
+                    size_t capacity = entry->map_capacity;
+                    if (!ng_cy_reserve(q,
+                                       (void**)&entry->map_keys,
+                                       &capacity,
+                                       entry->map_count,
+                                       sizeof(*entry->map_keys)) ||
+                        !ng_cy_reserve(q,
+                                       (void**)&entry->map_items,
+                                       &entry->map_capacity,
+                                       entry->map_count,
+                                       sizeof(*entry->map_items)))
+                        return NG_OOM;
+                }
+                entry->map_keys[entry->map_count] = key;
+                entry->map_items[entry->map_count++] = item;
                 p = ng_skip_ws(p);
                 if (*p != ',')
                     break;
@@ -9219,11 +11450,11 @@ static ng_status ng_cy_parse_scalar_atom(const char** pp, ng_cy_query* q, int* o
             if (strncmp(p, "THEN", 4) || !isspace((unsigned char)p[4]))
                 return NG_PARSE_ERROR;
             p = ng_skip_ws(p + 4);
-            if (ng_cy_parse_scalar_add(&p, q, &value) != NG_OK ||
-                q->scalars[expression].list_count + 2 > NG_QUERY_MAX_LIST_VALUES)
+            if (ng_cy_parse_scalar_add(&p, q, &value) != NG_OK)
                 return NG_PARSE_ERROR;
-            q->scalars[expression].list_items[q->scalars[expression].list_count++] = condition;
-            q->scalars[expression].list_items[q->scalars[expression].list_count++] = value;
+            if (!ng_cy_list_push(q, expression, condition) ||
+                !ng_cy_list_push(q, expression, value))
+                return NG_OOM;
             p = ng_skip_ws(p);
         }
         if (!q->scalars[expression].list_count)
@@ -9298,10 +11529,9 @@ static ng_status ng_cy_parse_scalar_atom(const char** pp, ng_cy_query* q, int* o
                 *out = ng_cy_scalar_add(q, function_kind, -1, -1, -1, NULL, NULL);
                 if (*out < 0)
                     return NG_PARSE_ERROR;
-                q->scalars[*out].list_count = argument_count;
-                memcpy(q->scalars[*out].list_items,
-                       arguments,
-                       argument_count * sizeof(arguments[0]));
+                for (argument = 0; argument < (int)argument_count; argument++)
+                    if (!ng_cy_list_push(q, *out, arguments[argument]))
+                        return NG_OOM;
                 p = ng_skip_ws(p + 1);
                 *pp = p;
                 return NG_OK;
@@ -9468,13 +11698,13 @@ static ng_status ng_cy_parse_scalar_add(const char** pp, ng_cy_query* q, int* ou
 static ng_status ng_cy_parse_projection_list(const char** pp,
                                              ng_cy_query* q,
                                              const char* keyword,
-                                             ng_cy_projection* projs,
+                                             ng_cy_projection** projs,
                                              size_t* count,
                                              int* distinct,
                                              int for_with);
 static ng_status ng_cy_parse_return(const char** pp, ng_cy_query* q) {
     return ng_cy_parse_projection_list(
-        pp, q, "RETURN", q->returns, &q->return_count, &q->distinct, 0);
+        pp, q, "RETURN", &q->returns, &q->return_count, &q->distinct, 0);
 }
 static ng_status ng_cy_parse_query(const char* q, ng_cy_query* out) {
     const char* p = ng_skip_ws(q);
@@ -9644,17 +11874,6 @@ static ng_status ng_cy_path_to_value(const ng_cy_path* path, ng_value* out) {
     out->as.map = map;
     return NG_OK;
 }
-static int ng_cy_node_matches(const ng_graph* g, const node_i* n, const ng_cy_node_pat* p) {
-    ng_symbol_id label;
-    if (!n)
-        return 0;
-    if (p->label[0]) {
-        label = ng_symbol_id_by_text(g, p->label);
-        if (!label || !ng_query_label_matches(n, label))
-            return 0;
-    }
-    return 1;
-}
 static int ng_cy_rel_matches(const ng_graph* g, const rel_i* r, const ng_cy_rel_pat* p) {
     ng_symbol_id type;
     size_t i;
@@ -9683,44 +11902,62 @@ static int ng_cy_rel_matches(const ng_graph* g, const rel_i* r, const ng_cy_rel_
     }
     return 1;
 }
-static int ng_cy_term_matches(const ng_graph* g,
-                              const ng_cy_query* q,
-                              const ng_cy_row* row,
-                              const ng_cy_term* t) {
+#define NG_CY_OP_TERM 0
+#define NG_CY_OP_JUMP_FALSE 1
+#define NG_CY_OP_JUMP_TRUE 2
+#define NG_CY_OP_NOT 3
+#define NG_CY_OP_PATTERN 4
+/* A term instruction carries its property key and operands resolved at compile time; `missing`
+ * records an unbound parameter, reported only if a row actually reaches the comparison. */
+typedef struct {
+    int op, arg, missing;
+    ng_symbol_id key;
+    ng_value value;
+    ng_value* values;
+} ng_cy_insn;
+static int ng_cy_term_compare(const ng_cy_term* t, const ng_cy_insn* in, const ng_value* actual) {
+    ng_value v;
+    int i;
+    if (in && in->missing) {
+        ng_query_parameter_error = 1;
+        return 0;
+    }
+    if (t->op != 1)
+        return in ? ng_query_compare_match(actual, &in->value, t->op)
+                  : ng_query_resolve_compare(actual, &t->value, t->op);
+    for (i = 0; i < t->value_count; i++) {
+        if (in) {
+            v = in->values[i];
+        } else if (ng_query_resolve_value(&t->values[i], &v) != NG_OK) {
+            ng_query_parameter_error = 1;
+            return 0;
+        }
+        if (ng_value_equal(actual, &v))
+            return 1;
+    }
+    return 0;
+}
+/* Shared by the tree walker and compiled programs; `in` is the compiled instruction, or NULL to
+ * look up the key and parameters here. */
+static int ng_cy_term_eval(const ng_graph* g,
+                           const ng_cy_term* t,
+                           const ng_cy_insn* in,
+                           const ng_cy_row* row) {
     ng_cy_binding b = row->values[t->var_index];
-    ng_value idv, v;
+    ng_value idv;
     const prop* p = NULL;
     ng_symbol_id key = 0;
     size_t i;
-    (void)q;
     if (!b.kind)
         return t->op == 7;
     if (b.kind == 3) {
-        if (b.value.type == NG_VALUE_NULL) {
-            if (t->op == 7)
-                return 1;
-            if (t->op == 8)
-                return 0;
-            return 0;
-        }
+        if (b.value.type == NG_VALUE_NULL)
+            return t->op == 7;
         if (t->is_id || t->key[0])
             return 0;
-        if (t->op == 7)
-            return 0;
-        if (t->op == 8)
-            return 1;
-        if (t->op == 1) {
-            for (i = 0; i < (size_t)t->value_count; i++) {
-                if (ng_query_resolve_value(&t->values[i], &v) != NG_OK) {
-                    ng_query_parameter_error = 1;
-                    return 0;
-                }
-                if (ng_value_equal(&b.value, &v))
-                    return 1;
-            }
-            return 0;
-        }
-        return ng_query_resolve_compare(&b.value, &t->value, t->op);
+        if (t->op == 7 || t->op == 8)
+            return t->op == 8;
+        return ng_cy_term_compare(t, in, &b.value);
     }
     if (!t->key[0] && !t->is_id)
         return t->op == 8;
@@ -9728,30 +11965,18 @@ static int ng_cy_term_matches(const ng_graph* g,
         idv.type = NG_VALUE_INT64;
         idv.length = 0;
         idv.as.integer = (int64_t)b.id;
-        if (t->op == 7)
-            return 0;
-        if (t->op == 8)
-            return 1;
-        if (t->op == 1) {
-            for (i = 0; i < (size_t)t->value_count; i++)
-                if (ng_query_resolve_compare(&idv, &t->values[i], 0))
-                    return 1;
-            return 0;
-        }
-        return ng_query_resolve_compare(&idv, &t->value, t->op);
+        if (t->op == 7 || t->op == 8)
+            return t->op == 8;
+        return ng_cy_term_compare(t, in, &idv);
     }
-    key = ng_symbol_id_by_text(g, t->key);
+    key = in ? in->key : ng_symbol_id_by_text(g, t->key);
     if (key) {
         if (b.kind == 1) {
             node_i* n = node((ng_graph*)g, b.id);
             if (n)
                 p = findprop(n->p, n->np, key);
-        } else {
-            for (i = 0; i < g->nr; i++)
-                if (g->re[i].id == b.id) {
-                    p = findprop(g->re[i].p, g->re[i].np, key);
-                    break;
-                }
+        } else if ((i = ng_relationship_position(g, b.id)) != SIZE_MAX) {
+            p = findprop(g->re[i].p, g->re[i].np, key);
         }
     }
     if (!p)
@@ -9760,18 +11985,21 @@ static int ng_cy_term_matches(const ng_graph* g,
         return p->v.type == NG_VALUE_NULL;
     if (t->op == 8)
         return p->v.type != NG_VALUE_NULL;
-    if (t->op == 1) {
-        for (i = 0; i < (size_t)t->value_count; i++) {
-            if (ng_query_resolve_value(&t->values[i], &v) != NG_OK) {
-                ng_query_parameter_error = 1;
-                return 0;
-            }
-            if (ng_value_equal(&p->v, &v))
-                return 1;
-        }
-        return 0;
-    }
-    return ng_query_resolve_compare(&p->v, &t->value, t->op);
+    return ng_cy_term_compare(t, in, &p->v);
+}
+static int ng_cy_term_matches(const ng_graph* g, const ng_cy_row* row, const ng_cy_term* t) {
+    return ng_cy_term_eval(g, t, NULL, row);
+}
+static ng_status ng_cy_pattern_exists(
+    const ng_graph* g, const ng_cy_query* q, const ng_cy_row* row, int expr, int* found);
+/* Predicates evaluate to a truth value, so a failed probe is parked in ng_cy_pattern_status (first
+ * error wins) and ng_query_execute_rows() returns it instead of the query result. */
+static int
+ng_cy_pattern_matches(const ng_graph* g, const ng_cy_query* q, const ng_cy_row* row, int expr) {
+    int found = 0;
+    if (ng_cy_pattern_status == NG_OK)
+        ng_cy_pattern_status = ng_cy_pattern_exists(g, q, row, expr, &found);
+    return found;
 }
 static int
 ng_cy_expr_matches(const ng_graph* g, const ng_cy_query* q, const ng_cy_row* row, int expr) {
@@ -9787,8 +12015,346 @@ ng_cy_expr_matches(const ng_graph* g, const ng_cy_query* q, const ng_cy_row* row
         return ng_cy_expr_matches(g, q, row, e->left) || ng_cy_expr_matches(g, q, row, e->right);
     if (e->kind == 3)
         return !ng_cy_expr_matches(g, q, row, e->left);
+    if (e->kind == 4)
+        return ng_cy_pattern_matches(g, q, row, expr);
     return e->term >= 0 && e->term < q->term_count &&
-           ng_cy_term_matches(g, q, row, &q->terms[e->term]);
+           ng_cy_term_matches(g, row, &q->terms[e->term]);
+}
+/* A WHERE tree flattened into short-circuit jumps; each expression emits at most one instruction,
+ * so a program sized to q->expr_count never overflows. */
+typedef struct {
+    ng_cy_insn* code;
+    size_t count, capacity;
+} ng_cy_program;
+/* Program storage comes from the query arena and lives as long as the parsed query. */
+static ng_status ng_cy_program_init(const ng_cy_query* q, ng_cy_program* prog) {
+    prog->count = 0;
+    prog->capacity = q->expr_count > 0 ? (size_t)q->expr_count : 1;
+    prog->code = (ng_cy_insn*)ng_cy_alloc((ng_cy_query*)q, prog->capacity * sizeof(*prog->code));
+    return prog->code ? NG_OK : NG_OOM;
+}
+static ng_status
+ng_cy_compile_expr(const ng_graph* g, const ng_cy_query* q, int expr, ng_cy_program* prog) {
+    const ng_cy_expr* e;
+    ng_cy_insn* in;
+    size_t jump;
+    ng_status s;
+    if (expr < 0 || expr >= q->expr_count || prog->count >= prog->capacity)
+        return NG_PARSE_ERROR;
+    e = &q->exprs[expr];
+    if (e->kind == 1 || e->kind == 2) {
+        s = ng_cy_compile_expr(g, q, e->left, prog);
+        if (s != NG_OK)
+            return s;
+        if (prog->count >= prog->capacity)
+            return NG_PARSE_ERROR;
+        jump = prog->count++;
+        prog->code[jump].op = e->kind == 1 ? NG_CY_OP_JUMP_FALSE : NG_CY_OP_JUMP_TRUE;
+        s = ng_cy_compile_expr(g, q, e->right, prog);
+        prog->code[jump].arg = (int)prog->count;
+        return s;
+    }
+    if (e->kind == 3) {
+        s = ng_cy_compile_expr(g, q, e->left, prog);
+        if (s != NG_OK)
+            return s;
+        if (prog->count >= prog->capacity)
+            return NG_PARSE_ERROR;
+        prog->code[prog->count++].op = NG_CY_OP_NOT;
+        return NG_OK;
+    }
+    in = &prog->code[prog->count];
+    memset(in, 0, sizeof(*in));
+    if (e->kind == 4) {
+        in->op = NG_CY_OP_PATTERN;
+        in->arg = expr;
+    } else {
+        const ng_cy_term* t;
+        int i;
+        if (e->term < 0 || e->term >= q->term_count)
+            return NG_PARSE_ERROR;
+        t = &q->terms[e->term];
+        in->op = NG_CY_OP_TERM;
+        in->arg = e->term;
+        if (t->key[0] && !t->is_id)
+            in->key = ng_symbol_id_by_text(g, t->key);
+        if (t->op == 1) {
+            in->values = (ng_value*)ng_cy_alloc((ng_cy_query*)q,
+                                                (size_t)t->value_count * sizeof(*in->values));
+            if (!in->values)
+                return NG_OOM;
+            for (i = 0; i < t->value_count; i++)
+                if (ng_query_resolve_value(&t->values[i], &in->values[i]) != NG_OK)
+                    in->missing = 1;
+        } else if (t->op != 7 && t->op != 8 &&
+                   ng_query_resolve_value(&t->value, &in->value) != NG_OK) {
+            in->missing = 1;
+        }
+    }
+    prog->count++;
+    return NG_OK;
+}
+static ng_status
+ng_cy_compile_where(const ng_graph* g, const ng_cy_query* q, int root, ng_cy_program* prog) {
+    ng_status s = ng_cy_program_init(q, prog);
+    if (s != NG_OK)
+        return s;
+    return root < 0 ? NG_OK : ng_cy_compile_expr(g, q, root, prog);
+}
+static int ng_cy_program_run(const ng_graph* g,
+                             const ng_cy_query* q,
+                             const ng_cy_program* prog,
+                             size_t pc,
+                             size_t end,
+                             const ng_cy_row* row) {
+    int acc = 1;
+    while (pc < end) {
+        const ng_cy_insn* in = &prog->code[pc++];
+        switch (in->op) {
+        case NG_CY_OP_TERM:
+            acc = ng_cy_term_eval(g, &q->terms[in->arg], in, row);
+            break;
+        case NG_CY_OP_PATTERN:
+            acc = ng_cy_pattern_matches(g, q, row, in->arg);
+            break;
+        case NG_CY_OP_JUMP_FALSE:
+            if (!acc)
+                pc = (size_t)in->arg;
+            break;
+        case NG_CY_OP_JUMP_TRUE:
+            if (acc)
+                pc = (size_t)in->arg;
+            break;
+        default:
+            acc = !acc;
+            break;
+        }
+    }
+    return acc;
+}
+static int ng_cy_program_matches(const ng_graph* g,
+                                 const ng_cy_query* q,
+                                 const ng_cy_program* prog,
+                                 const ng_cy_row* row) {
+    return ng_cy_program_run(g, q, prog, 0, prog->count, row);
+}
+static void ng_cy_filter_rows(const ng_graph* g,
+                              const ng_cy_query* q,
+                              const ng_cy_program* prog,
+                              ng_cy_row* rows,
+                              size_t* count) {
+    size_t i, w = 0;
+    for (i = 0; i < *count; i++)
+        if (ng_cy_program_matches(g, q, prog, &rows[i]))
+            rows[w++] = rows[i];
+    *count = w;
+}
+typedef struct {
+    const ng_cy_query* q;
+    ng_cy_program prog;
+    size_t *start, *end;
+    int* var;
+    size_t count;
+} ng_cy_pushdown;
+static int ng_cy_expr_single_var(const ng_cy_query* q, int expr, int* var) {
+    const ng_cy_expr* e;
+    int v;
+    if (expr < 0 || expr >= q->expr_count)
+        return 0;
+    e = &q->exprs[expr];
+    if (e->kind == 1 || e->kind == 2)
+        return ng_cy_expr_single_var(q, e->left, var) && ng_cy_expr_single_var(q, e->right, var);
+    if (e->kind == 3)
+        return ng_cy_expr_single_var(q, e->left, var);
+    if (e->kind == 4 || e->term < 0 || e->term >= q->term_count)
+        return 0;
+    v = q->terms[e->term].var_index;
+    if (v < 0 || (*var >= 0 && *var != v))
+        return 0;
+    *var = v;
+    return 1;
+}
+static int ng_cy_match_binds(const ng_cy_match* m, int var) {
+    size_t i;
+    for (i = 0; i < m->node_count; i++)
+        if (m->nodes[i].var_index == var)
+            return 1;
+    for (i = 0; i < m->rel_count; i++)
+        if (m->rels[i].var_index == var && !m->rels[i].has_var_length)
+            return 1;
+    return 0;
+}
+/* Pushed-down filters run before WHERE would see the row, so they skip terms whose parameters
+ * are missing and leave the error to the full WHERE evaluation. */
+static void ng_cy_pushdown_collect(const ng_graph* g,
+                                   const ng_cy_query* q,
+                                   const ng_cy_match* m,
+                                   int expr,
+                                   ng_cy_pushdown* pd) {
+    size_t code = pd->prog.count, i;
+    int var = -1;
+    if (expr < 0 || expr >= q->expr_count || pd->count >= pd->prog.capacity)
+        return;
+    if (q->exprs[expr].kind == 1) {
+        ng_cy_pushdown_collect(g, q, m, q->exprs[expr].left, pd);
+        ng_cy_pushdown_collect(g, q, m, q->exprs[expr].right, pd);
+        return;
+    }
+    if (!ng_cy_expr_single_var(q, expr, &var) || !ng_cy_match_binds(m, var))
+        return;
+    if (ng_cy_compile_expr(g, q, expr, &pd->prog) == NG_OK) {
+        for (i = code; i < pd->prog.count; i++)
+            if (pd->prog.code[i].missing)
+                break;
+        if (i == pd->prog.count) {
+            pd->start[pd->count] = code;
+            pd->end[pd->count] = pd->prog.count;
+            pd->var[pd->count++] = var;
+            return;
+        }
+    }
+    pd->prog.count = code;
+}
+static ng_status ng_cy_plan_pushdown(const ng_graph* g,
+                                     const ng_cy_query* q,
+                                     const ng_cy_match* m,
+                                     int root,
+                                     ng_cy_pushdown* pd) {
+    ng_cy_query* arena = (ng_cy_query*)q;
+    ng_status s = ng_cy_program_init(q, &pd->prog);
+    pd->q = q;
+    pd->count = 0;
+    if (s != NG_OK)
+        return s;
+    pd->start = (size_t*)ng_cy_alloc(arena, pd->prog.capacity * sizeof(*pd->start));
+    pd->end = (size_t*)ng_cy_alloc(arena, pd->prog.capacity * sizeof(*pd->end));
+    pd->var = (int*)ng_cy_alloc(arena, pd->prog.capacity * sizeof(*pd->var));
+    if (!pd->start || !pd->end || !pd->var)
+        return NG_OOM;
+    ng_cy_pushdown_collect(g, q, m, root, pd);
+    return NG_OK;
+}
+static int
+ng_cy_pushdown_matches(const ng_graph* g, const ng_cy_pushdown* pd, int var, const ng_cy_row* row) {
+    size_t i;
+    if (!pd || var < 0)
+        return 1;
+    for (i = 0; i < pd->count; i++)
+        if (pd->var[i] == var &&
+            !ng_cy_program_run(g, pd->q, &pd->prog, pd->start[i], pd->end[i], row))
+            return 0;
+    return 1;
+}
+typedef struct {
+    size_t oi, oe, ii, ie;
+    int dir;
+} ng_cy_adjacency_iter;
+/* Returns the graph's cached MATCH adjacency, rebuilding it in O(N + R) after a write. */
+static const ng_cy_adjacency* ng_cy_adjacency_get(const ng_graph* g) {
+    ng_graph* x = (ng_graph*)g;
+    ng_cy_adjacency* a = x->adjacency;
+    size_t i, *out_fill, *in_fill;
+    if (a && a->version == g->version)
+        return a;
+    ng_cy_adjacency_free(a);
+    x->adjacency = NULL;
+    if (ng_test_maybe_fail() != NG_OK)
+        return NULL;
+    a = (ng_cy_adjacency*)calloc(1, sizeof(*a));
+    if (!a)
+        return NULL;
+    a->out_offsets = (size_t*)calloc(g->nn + 1, sizeof(size_t));
+    a->in_offsets = (size_t*)calloc(g->nn + 1, sizeof(size_t));
+    a->out_rels = (size_t*)malloc((g->nr ? g->nr : 1) * sizeof(size_t));
+    a->in_rels = (size_t*)malloc((g->nr ? g->nr : 1) * sizeof(size_t));
+    a->src_pos = (size_t*)malloc((g->nr ? g->nr : 1) * sizeof(size_t));
+    a->dst_pos = (size_t*)malloc((g->nr ? g->nr : 1) * sizeof(size_t));
+    out_fill = (size_t*)calloc(g->nn + 1, sizeof(size_t));
+    in_fill = (size_t*)calloc(g->nn + 1, sizeof(size_t));
+    if (!a->out_offsets || !a->in_offsets || !a->out_rels || !a->in_rels || !a->src_pos ||
+        !a->dst_pos || !out_fill || !in_fill) {
+        free(out_fill);
+        free(in_fill);
+        ng_cy_adjacency_free(a);
+        return NULL;
+    }
+    for (i = 0; i < g->nr; i++) {
+        a->src_pos[i] = ng_node_position(g, g->re[i].src);
+        a->dst_pos[i] = ng_node_position(g, g->re[i].dst);
+        if (a->src_pos[i] == SIZE_MAX || a->dst_pos[i] == SIZE_MAX)
+            continue;
+        a->out_offsets[a->src_pos[i] + 1]++;
+        a->in_offsets[a->dst_pos[i] + 1]++;
+    }
+    for (i = 0; i < g->nn; i++) {
+        a->out_offsets[i + 1] += a->out_offsets[i];
+        a->in_offsets[i + 1] += a->in_offsets[i];
+    }
+    for (i = 0; i < g->nr; i++) {
+        if (a->src_pos[i] == SIZE_MAX || a->dst_pos[i] == SIZE_MAX)
+            continue;
+        a->out_rels[a->out_offsets[a->src_pos[i]] + out_fill[a->src_pos[i]]++] = i;
+        a->in_rels[a->in_offsets[a->dst_pos[i]] + in_fill[a->dst_pos[i]]++] = i;
+    }
+    free(out_fill);
+    free(in_fill);
+    a->version = g->version;
+    x->adjacency = a;
+    ng_query_profile_bytes((g->nn + 1) * 2 * sizeof(size_t) + g->nr * 4 * sizeof(size_t));
+    return a;
+}
+static void ng_cy_adjacency_begin(const ng_cy_adjacency* a,
+                                  size_t pos,
+                                  int dir,
+                                  ng_cy_adjacency_iter* it) {
+    it->oi = a->out_offsets[pos];
+    it->oe = dir < 0 ? it->oi : a->out_offsets[pos + 1];
+    it->ii = a->in_offsets[pos];
+    it->ie = dir > 0 ? it->ii : a->in_offsets[pos + 1];
+    it->dir = dir;
+}
+static int ng_cy_adjacency_next(const ng_cy_adjacency* a,
+                                ng_cy_adjacency_iter* it,
+                                size_t* rel,
+                                size_t* next) {
+    if (ng_query_active_profile && (it->oi < it->oe || it->ii < it->ie))
+        ng_query_active_profile->relationships++;
+    if (it->oi < it->oe && (it->ii >= it->ie || a->out_rels[it->oi] <= a->in_rels[it->ii])) {
+        *rel = a->out_rels[it->oi++];
+        if (it->ii < it->ie && a->in_rels[it->ii] == *rel)
+            it->ii++;
+        *next = a->dst_pos[*rel];
+        return 1;
+    }
+    if (it->ii < it->ie) {
+        *rel = a->in_rels[it->ii++];
+        *next = a->src_pos[*rel];
+        return 1;
+    }
+    return 0;
+}
+typedef struct {
+    uint32_t* dist[2];
+    size_t *via[2], *queue[2], tail[2];
+} ng_cy_bfs;
+typedef struct {
+    const ng_cy_pushdown* pd;
+    const ng_cy_adjacency* adj;
+    ng_cy_bfs* bfs;
+    ng_symbol_id labels[NG_CY_MAX_NODES], types[NG_CY_MAX_RELS];
+    int where;
+    size_t limit;
+} ng_cy_expand;
+static int ng_cy_expand_done(const ng_cy_expand* x, size_t count) {
+    return x->limit && count >= x->limit;
+}
+static int ng_cy_expand_node_ok(const ng_cy_expand* x,
+                                const ng_cy_match* m,
+                                size_t pos,
+                                const node_i* n) {
+    if (!m->nodes[pos].label[0])
+        return 1;
+    return x->labels[pos] && ng_query_label_matches(n, x->labels[pos]);
 }
 static ng_status ng_cy_apply_where(
     const ng_graph* g, const ng_cy_query* q, ng_cy_row* rows, size_t* count, int root);
@@ -9803,15 +12369,27 @@ static int ng_cy_append_row(ng_cy_row** rows, size_t* count, size_t* cap, const
 static ng_status ng_cy_expand_from_node(const ng_graph* g,
                                         const ng_cy_query* q,
                                         const ng_cy_match* m,
+                                        const ng_cy_expand* x,
                                         size_t pos,
                                         const node_i* cur,
                                         const ng_cy_row* row,
                                         ng_cy_row** out,
                                         size_t* out_count,
                                         size_t* out_cap);
+static int ng_cy_expand_rel_ok(const ng_graph* g,
+                               const ng_cy_match* m,
+                               const ng_cy_expand* x,
+                               size_t pos,
+                               const rel_i* r) {
+    const ng_cy_rel_pat* pat = &m->rels[pos];
+    if (pat->type[0] && r->type != x->types[pos])
+        return 0;
+    return !pat->prop_count || ng_cy_rel_matches(g, r, pat);
+}
 static ng_status ng_cy_expand_var_rel(const ng_graph* g,
                                       const ng_cy_query* q,
                                       const ng_cy_match* m,
+                                      const ng_cy_expand* x,
                                       size_t pos,
                                       const node_i* cur,
                                       uint32_t depth,
@@ -9821,84 +12399,362 @@ static ng_status ng_cy_expand_var_rel(const ng_graph* g,
                                       size_t* out_count,
                                       size_t* out_cap) {
     const ng_cy_rel_pat* pat = &m->rels[pos];
-    size_t i;
+    ng_cy_adjacency_iter it;
+    size_t ri, npos;
     if (depth >= pat->min_depth) {
         ng_cy_row nr = *row;
-        if (ng_cy_node_matches(g, cur, &m->nodes[pos + 1]) &&
-            ng_cy_bind(&nr, m->nodes[pos + 1].var_index, 1, cur->id)) {
-            if (ng_cy_expand_from_node(g, q, m, pos + 1, cur, &nr, out, out_count, out_cap) !=
+        if (ng_cy_expand_node_ok(x, m, pos + 1, cur) &&
+            ng_cy_bind(&nr, m->nodes[pos + 1].var_index, 1, cur->id) &&
+            ng_cy_pushdown_matches(g, x->pd, m->nodes[pos + 1].var_index, &nr)) {
+            if (ng_cy_expand_from_node(g, q, m, x, pos + 1, cur, &nr, out, out_count, out_cap) !=
                 NG_OK)
                 return NG_OOM;
         }
     }
-    if (depth >= pat->max_depth)
+    if (depth >= pat->max_depth || ng_cy_expand_done(x, *out_count))
+        return NG_OK;
+    ng_cy_adjacency_begin(x->adj, (size_t)(cur - g->no), pat->dir, &it);
+    while (ng_cy_adjacency_next(x->adj, &it, &ri, &npos)) {
+        const rel_i* r = &g->re[ri];
+        const node_i* next = &g->no[npos];
+        size_t slot;
+        uint32_t nd = depth + 1;
+        if (!ng_cy_expand_rel_ok(g, m, x, pos, r))
+            continue;
+        slot = npos * (size_t)(pat->max_depth + 1) + nd;
+        if (seen[slot])
+            continue;
+        seen[slot] = 1;
+        {
+            ng_cy_row nr = *row;
+            if (!ng_cy_path_append(&nr, m->path_var_index, r->id, next->id))
+                return NG_OOM;
+            if (ng_cy_expand_var_rel(
+                    g, q, m, x, pos, next, nd, &nr, seen, out, out_count, out_cap) != NG_OK)
+                return NG_OOM;
+        }
+        if (ng_cy_expand_done(x, *out_count))
+            break;
+    }
+    return NG_OK;
+}
+typedef struct {
+    const ng_graph* g;
+    const ng_cy_query* q;
+    const ng_cy_match* m;
+    const ng_cy_expand* x;
+    const ng_cy_row* row;
+    ng_cy_row** out;
+    size_t *out_count, *out_cap;
+    size_t nodes[NG_CY_MAX_PATH_LENGTH + 1], rels[NG_CY_MAX_PATH_LENGTH];
+    uint32_t length, depth[2];
+} ng_cy_shortest;
+static void ng_cy_bfs_free(ng_cy_bfs* b) {
+    int k;
+    for (k = 0; k < 2; k++) {
+        free(b->dist[k]);
+        free(b->via[k]);
+        free(b->queue[k]);
+    }
+    memset(b, 0, sizeof(*b));
+}
+static ng_status ng_cy_bfs_ready(const ng_graph* g, ng_cy_bfs* b) {
+    size_t i, n = g->nn ? g->nn : 1;
+    int k;
+    if (b->dist[0])
+        return NG_OK;
+    if (ng_test_maybe_fail() != NG_OK)
+        return NG_OOM;
+    for (k = 0; k < 2; k++) {
+        b->dist[k] = (uint32_t*)malloc(n * sizeof(uint32_t));
+        b->via[k] = (size_t*)malloc(n * sizeof(size_t));
+        b->queue[k] = (size_t*)malloc(n * sizeof(size_t));
+        if (!b->dist[k] || !b->via[k] || !b->queue[k]) {
+            ng_cy_bfs_free(b);
+            return NG_OOM;
+        }
+        for (i = 0; i < n; i++)
+            b->dist[k][i] = UINT32_MAX;
+    }
+    ng_query_profile_bytes(n * 2 * (sizeof(uint32_t) + 2 * sizeof(size_t)));
+    return NG_OK;
+}
+static void ng_cy_bfs_seed(ng_cy_bfs* b, int k, size_t pos) {
+    b->dist[k][pos] = 0;
+    b->queue[k][0] = pos;
+    b->tail[k] = 1;
+}
+static void ng_cy_bfs_reset(ng_cy_bfs* b) {
+    size_t i;
+    int k;
+    for (k = 0; k < 2; k++) {
+        for (i = 0; i < b->tail[k]; i++)
+            b->dist[k][b->queue[k][i]] = UINT32_MAX;
+        b->tail[k] = 0;
+    }
+}
+static size_t ng_cy_bfs_other(const ng_cy_adjacency* a, size_t rel, size_t pos) {
+    return a->src_pos[rel] == pos ? a->dst_pos[rel] : a->src_pos[rel];
+}
+/* Expands one complete BFS level of side k and records the shortest meeting with the other side. */
+static void ng_cy_bfs_level(ng_cy_shortest* c, int k, size_t begin, uint32_t* best, size_t* meet) {
+    ng_cy_bfs* b = c->x->bfs;
+    size_t end = b->tail[k], i, ri, npos;
+    int dir = k ? -c->m->rels[0].dir : c->m->rels[0].dir;
+    for (i = begin; i < end; i++) {
+        size_t cur = b->queue[k][i];
+        uint32_t nd = b->dist[k][cur] + 1;
+        ng_cy_adjacency_iter it;
+        ng_cy_adjacency_begin(c->x->adj, cur, dir, &it);
+        while (ng_cy_adjacency_next(c->x->adj, &it, &ri, &npos)) {
+            if (b->dist[k][npos] != UINT32_MAX ||
+                !ng_cy_expand_rel_ok(c->g, c->m, c->x, 0, &c->g->re[ri]))
+                continue;
+            b->dist[k][npos] = nd;
+            b->via[k][npos] = ri;
+            b->queue[k][b->tail[k]++] = npos;
+            if (b->dist[!k][npos] != UINT32_MAX && nd + b->dist[!k][npos] < *best) {
+                *best = nd + b->dist[!k][npos];
+                *meet = npos;
+            }
+        }
+    }
+}
+static ng_status ng_cy_shortest_emit(ng_cy_shortest* c) {
+    const ng_cy_match* m = c->m;
+    const node_i* end = &c->g->no[c->nodes[c->length]];
+    ng_cy_row nr = *c->row;
+    uint32_t i;
+    if (c->length < m->rels[0].min_depth)
+        return NG_OK;
+    if (!ng_cy_bind(&nr, m->nodes[1].var_index, 1, end->id) ||
+        !ng_cy_pushdown_matches(c->g, c->x->pd, m->nodes[1].var_index, &nr))
+        return NG_OK;
+    if (m->path_var_index >= 0) {
+        ng_cy_path* path = (ng_cy_path*)calloc(1, sizeof(*path));
+        if (!path)
+            return NG_OOM;
+        for (i = 0; i <= c->length; i++)
+            path->nodes[i] = c->g->no[c->nodes[i]].id;
+        for (i = 0; i < c->length; i++)
+            path->relationships[i] = c->g->re[c->rels[i]].id;
+        path->node_count = c->length + 1;
+        path->relationship_count = c->length;
+        nr.values[m->path_var_index].kind = 4;
+        nr.values[m->path_var_index].pointer = path;
+    }
+    return ng_cy_expand_from_node(
+        c->g, c->q, m, c->x, 1, end, &nr, c->out, c->out_count, c->out_cap);
+}
+static ng_status ng_cy_shortest_forward(ng_cy_shortest* c, uint32_t i) {
+    ng_cy_bfs* b = c->x->bfs;
+    ng_cy_adjacency_iter it;
+    size_t ri, npos;
+    uint32_t j = i + 1;
+    ng_status s;
+    if (i == c->length)
+        return ng_cy_shortest_emit(c);
+    ng_cy_adjacency_begin(c->x->adj, c->nodes[i], c->m->rels[0].dir, &it);
+    while (ng_cy_adjacency_next(c->x->adj, &it, &ri, &npos)) {
+        if ((j <= c->depth[0] && b->dist[0][npos] != j) ||
+            (c->length - j <= c->depth[1] && b->dist[1][npos] != c->length - j) ||
+            !ng_cy_expand_rel_ok(c->g, c->m, c->x, 0, &c->g->re[ri]))
+            continue;
+        c->nodes[j] = npos;
+        c->rels[i] = ri;
+        s = ng_cy_shortest_forward(c, j);
+        if (s != NG_OK)
+            return s;
+    }
+    return NG_OK;
+}
+static ng_status ng_cy_shortest_backward(ng_cy_shortest* c, uint32_t i) {
+    ng_cy_bfs* b = c->x->bfs;
+    ng_cy_adjacency_iter it;
+    size_t ri, npos;
+    ng_status s;
+    if (!i)
+        return ng_cy_shortest_emit(c);
+    ng_cy_adjacency_begin(c->x->adj, c->nodes[i], -c->m->rels[0].dir, &it);
+    while (ng_cy_adjacency_next(c->x->adj, &it, &ri, &npos)) {
+        if (b->dist[0][npos] != i - 1 || !ng_cy_expand_rel_ok(c->g, c->m, c->x, 0, &c->g->re[ri]))
+            continue;
+        c->nodes[i - 1] = npos;
+        c->rels[i - 1] = ri;
+        s = ng_cy_shortest_backward(c, i - 1);
+        if (s != NG_OK)
+            return s;
+    }
+    return NG_OK;
+}
+static ng_status ng_cy_shortest_between(ng_cy_shortest* c, size_t src, size_t dst) {
+    ng_cy_bfs* b = c->x->bfs;
+    size_t begin[2] = {0, 0}, meet = SIZE_MAX, v;
+    uint32_t best = UINT32_MAX, i;
+    ng_status s = NG_OK;
+    if (src == dst)
         return NG_OK;
-    for (i = 0; i < g->nr; i++) {
-        const rel_i* r = &g->re[i];
-        node_i* next = NULL;
-        size_t npos, slot;
-        uint32_t nd = depth + 1;
-        if (!ng_cy_rel_matches(g, r, pat))
-            continue;
-        if (pat->dir > 0) {
-            if (r->src != cur->id)
-                continue;
-            next = node((ng_graph*)g, r->dst);
-        } else if (pat->dir < 0) {
-            if (r->dst != cur->id)
-                continue;
-            next = node((ng_graph*)g, r->src);
-        } else {
-            if (r->src == cur->id)
-                next = node((ng_graph*)g, r->dst);
-            else if (r->dst == cur->id)
-                next = node((ng_graph*)g, r->src);
-            else
-                continue;
+    c->depth[0] = c->depth[1] = 0;
+    ng_cy_bfs_seed(b, 0, src);
+    ng_cy_bfs_seed(b, 1, dst);
+    while (best == UINT32_MAX && c->depth[0] + c->depth[1] < c->m->rels[0].max_depth) {
+        int k = b->tail[0] - begin[0] <= b->tail[1] - begin[1] ? 0 : 1;
+        size_t end = b->tail[k];
+        if (begin[k] == end)
+            break;
+        ng_cy_bfs_level(c, k, begin[k], &best, &meet);
+        begin[k] = end;
+        c->depth[k]++;
+    }
+    if (best != UINT32_MAX) {
+        c->length = best;
+        c->nodes[0] = src;
+        if (c->m->shortest == 2)
+            s = ng_cy_shortest_forward(c, 0);
+        else {
+            i = b->dist[0][meet];
+            c->nodes[i] = meet;
+            for (v = meet; i; i--) {
+                c->rels[i - 1] = b->via[0][v];
+                v = ng_cy_bfs_other(c->x->adj, b->via[0][v], v);
+                c->nodes[i - 1] = v;
+            }
+            for (i = b->dist[0][meet], v = meet; i < best; i++) {
+                c->rels[i] = b->via[1][v];
+                v = ng_cy_bfs_other(c->x->adj, b->via[1][v], v);
+                c->nodes[i + 1] = v;
+            }
+            s = ng_cy_shortest_emit(c);
         }
-        if (!next)
+    }
+    ng_cy_bfs_reset(b);
+    return s;
+}
+static ng_status ng_cy_shortest_from(ng_cy_shortest* c, size_t src) {
+    ng_cy_bfs* b = c->x->bfs;
+    const ng_cy_match* m = c->m;
+    size_t begin = 0, meet = SIZE_MAX, i, v;
+    uint32_t best = UINT32_MAX, j;
+    ng_status s = NG_OK;
+    c->depth[0] = c->depth[1] = 0;
+    ng_cy_bfs_seed(b, 0, src);
+    while (c->depth[0] < m->rels[0].max_depth && begin < b->tail[0]) {
+        size_t end = b->tail[0];
+        ng_cy_bfs_level(c, 0, begin, &best, &meet);
+        begin = end;
+        c->depth[0]++;
+    }
+    for (i = 1; s == NG_OK && i < b->tail[0]; i++) {
+        ng_cy_row nr = *c->row;
+        v = b->queue[0][i];
+        if (!ng_cy_expand_node_ok(c->x, m, 1, &c->g->no[v]) ||
+            !ng_cy_bind(&nr, m->nodes[1].var_index, 1, c->g->no[v].id) ||
+            !ng_cy_pushdown_matches(c->g, c->x->pd, m->nodes[1].var_index, &nr))
             continue;
-        npos = ng_node_position(g, next->id);
-        if (npos == SIZE_MAX)
+        c->length = b->dist[0][v];
+        c->nodes[c->length] = v;
+        if (m->shortest == 2) {
+            s = ng_cy_shortest_backward(c, c->length);
             continue;
-        slot = npos * (size_t)(pat->max_depth + 1) + nd;
-        if (seen[slot])
+        }
+        for (j = c->length; j; j--) {
+            c->rels[j - 1] = b->via[0][c->nodes[j]];
+            c->nodes[j - 1] = ng_cy_bfs_other(c->x->adj, c->rels[j - 1], c->nodes[j]);
+        }
+        s = ng_cy_shortest_emit(c);
+    }
+    ng_cy_bfs_reset(b);
+    return s;
+}
+/* shortestPath/allShortestPaths: bidirectional BFS when the end node is bound or selective,
+ * otherwise one BFS from the start node that reports every reachable end candidate. */
+static ng_status ng_cy_expand_shortest(const ng_graph* g,
+                                       const ng_cy_query* q,
+                                       const ng_cy_match* m,
+                                       const ng_cy_expand* x,
+                                       const node_i* cur,
+                                       const ng_cy_row* row,
+                                       ng_cy_row** out,
+                                       size_t* out_count,
+                                       size_t* out_cap) {
+    ng_cy_shortest c;
+    size_t src = (size_t)(cur - g->no), candidates[16], candidate_count = 0, i;
+    int vi = m->nodes[1].var_index, selective = 0;
+    ng_status s;
+    if (ng_cy_bfs_ready(g, x->bfs) != NG_OK)
+        return NG_OOM;
+    memset(&c, 0, sizeof(c));
+    c.g = g;
+    c.q = q;
+    c.m = m;
+    c.x = x;
+    c.row = row;
+    c.out = out;
+    c.out_count = out_count;
+    c.out_cap = out_cap;
+    if (vi >= 0 && row->values[vi].kind) {
+        node_i* end;
+        if (row->values[vi].kind != 1)
+            return NG_OK;
+        end = node((ng_graph*)g, row->values[vi].id);
+        if (!end || !ng_cy_expand_node_ok(x, m, 1, end))
+            return NG_OK;
+        return ng_cy_shortest_between(&c, src, (size_t)(end - g->no));
+    }
+    for (i = 0; vi >= 0 && x->pd && i < x->pd->count; i++)
+        if (x->pd->var[i] == vi)
+            selective = 1;
+    for (i = 0; selective && i < g->nn; i++) {
+        ng_cy_row nr = *row;
+        if (!ng_cy_expand_node_ok(x, m, 1, &g->no[i]) || !ng_cy_bind(&nr, vi, 1, g->no[i].id) ||
+            !ng_cy_pushdown_matches(g, x->pd, vi, &nr))
             continue;
-        seen[slot] = 1;
-        {
-            ng_cy_row nr = *row;
-            if (!ng_cy_path_append(&nr, m->path_var_index, r->id, next->id))
-                return NG_OOM;
-            if (ng_cy_expand_var_rel(g, q, m, pos, next, nd, &nr, seen, out, out_count, out_cap) !=
-                NG_OK)
-                return NG_OOM;
+        if (candidate_count == sizeof(candidates) / sizeof(candidates[0])) {
+            selective = 0;
+            break;
         }
+        candidates[candidate_count++] = i;
+    }
+    if (!selective)
+        return ng_cy_shortest_from(&c, src);
+    for (i = 0; i < candidate_count; i++) {
+        s = ng_cy_shortest_between(&c, src, candidates[i]);
+        if (s != NG_OK)
+            return s;
     }
     return NG_OK;
 }
 static ng_status ng_cy_expand_from_node(const ng_graph* g,
                                         const ng_cy_query* q,
                                         const ng_cy_match* m,
+                                        const ng_cy_expand* x,
                                         size_t pos,
                                         const node_i* cur,
                                         const ng_cy_row* row,
                                         ng_cy_row** out,
                                         size_t* out_count,
                                         size_t* out_cap) {
-    size_t i;
+    ng_cy_adjacency_iter it;
+    size_t ri, npos;
+    if (m->shortest && !pos)
+        return ng_cy_expand_shortest(g, q, m, x, cur, row, out, out_count, out_cap);
     if (pos >= m->rel_count) {
         ng_cy_row nr = *row;
         if (m->path_var_index < 0 || nr.values[m->path_var_index].kind != 4) {
             if (!ng_cy_bind_path(&nr, m))
                 return NG_OOM;
         }
+        if (x->where >= 0 && !ng_cy_expr_matches(g, q, &nr, x->where))
+            return NG_OK;
+        if (!out) {
+            (*out_count)++;
+            return NG_OK;
+        }
         return ng_cy_append_row(out, out_count, out_cap, &nr) ? NG_OK : NG_OOM;
     }
     if (m->rels[pos].has_var_length) {
-        size_t start = ng_node_position(g, cur->id), cap;
+        size_t start = (size_t)(cur - g->no), cap;
         ng_cy_row path_row = *row;
-        if (start == SIZE_MAX)
-            return NG_OK;
         if (m->path_var_index >= 0) {
             ng_cy_path* path = (ng_cy_path*)calloc(1, sizeof(*path));
             if (!path)
@@ -9916,88 +12772,113 @@ static ng_status ng_cy_expand_from_node(const ng_graph* g,
                 return NG_OOM;
             seen[start * (size_t)(m->rels[pos].max_depth + 1)] = 1;
             s = ng_cy_expand_var_rel(
-                g, q, m, pos, cur, 0, &path_row, seen, out, out_count, out_cap);
+                g, q, m, x, pos, cur, 0, &path_row, seen, out, out_count, out_cap);
             free(seen);
             return s;
         }
     }
-    for (i = 0; i < g->nr; i++) {
-        const rel_i* r = &g->re[i];
-        node_i* next = NULL;
+    ng_cy_adjacency_begin(x->adj, (size_t)(cur - g->no), m->rels[pos].dir, &it);
+    while (ng_cy_adjacency_next(x->adj, &it, &ri, &npos)) {
+        const rel_i* r = &g->re[ri];
+        const node_i* next = &g->no[npos];
         ng_cy_row nr = *row;
-        if (!ng_cy_rel_matches(g, r, &m->rels[pos]))
-            continue;
-        if (m->rels[pos].dir > 0) {
-            if (r->src != cur->id)
-                continue;
-            next = node((ng_graph*)g, r->dst);
-        } else if (m->rels[pos].dir < 0) {
-            if (r->dst != cur->id)
-                continue;
-            next = node((ng_graph*)g, r->src);
-        } else {
-            if (r->src == cur->id)
-                next = node((ng_graph*)g, r->dst);
-            else if (r->dst == cur->id)
-                next = node((ng_graph*)g, r->src);
-            else
-                continue;
-        }
-        if (!next || !ng_cy_node_matches(g, next, &m->nodes[pos + 1]))
+        if (!ng_cy_expand_rel_ok(g, m, x, pos, r) || !ng_cy_expand_node_ok(x, m, pos + 1, next))
             continue;
         if (!ng_cy_bind(&nr, m->rels[pos].var_index, 2, r->id) ||
-            !ng_cy_bind(&nr, m->nodes[pos + 1].var_index, 1, next->id))
+            !ng_cy_bind(&nr, m->nodes[pos + 1].var_index, 1, next->id) ||
+            !ng_cy_pushdown_matches(g, x->pd, m->rels[pos].var_index, &nr) ||
+            !ng_cy_pushdown_matches(g, x->pd, m->nodes[pos + 1].var_index, &nr))
             continue;
         if (m->path_var_index >= 0 && nr.values[m->path_var_index].kind == 4 &&
             !ng_cy_path_append(&nr, m->path_var_index, r->id, next->id))
             return NG_OOM;
-        if (ng_cy_expand_from_node(g, q, m, pos + 1, next, &nr, out, out_count, out_cap) != NG_OK)
+        if (ng_cy_expand_from_node(g, q, m, x, pos + 1, next, &nr, out, out_count, out_cap) !=
+            NG_OK)
             return NG_OOM;
+        if (ng_cy_expand_done(x, *out_count))
+            break;
     }
     return NG_OK;
 }
 static ng_status ng_cy_apply_match(const ng_graph* g,
                                    const ng_cy_query* q,
                                    const ng_cy_match* m,
+                                   const ng_cy_pushdown* pd,
                                    const ng_cy_row* in,
                                    size_t in_count,
+                                   int where,
+                                   size_t limit,
                                    ng_cy_row** out,
                                    size_t* out_count) {
+    ng_cy_expand x;
+    ng_cy_bfs bfs;
     size_t i, j, cap = 0;
-    *out = NULL;
+    ng_status s = NG_OK;
+    if (out)
+        *out = NULL;
     *out_count = 0;
-    for (i = 0; i < in_count; i++) {
+    memset(&bfs, 0, sizeof(bfs));
+    x.pd = pd;
+    x.adj = NULL;
+    x.bfs = &bfs;
+    x.where = where;
+    x.limit = limit;
+    for (i = 0; i < m->node_count; i++)
+        x.labels[i] = m->nodes[i].label[0] ? ng_symbol_id_by_text(g, m->nodes[i].label) : 0;
+    for (i = 0; i < m->rel_count; i++)
+        x.types[i] = m->rels[i].type[0] ? ng_symbol_id_by_text(g, m->rels[i].type) : 0;
+    if (m->rel_count && in_count && !(x.adj = ng_cy_adjacency_get(g)))
+        return NG_OOM;
+    for (i = 0; s == NG_OK && i < in_count && !ng_cy_expand_done(&x, *out_count); i++) {
         const ng_cy_row* row = &in[i];
         int vi = m->nodes[0].var_index;
         if (vi >= 0 && row->values[vi].kind) {
             node_i* n;
             if (row->values[vi].kind == 3 && row->values[vi].value.type == NG_VALUE_NULL)
                 continue;
-            if (row->values[vi].kind != 1)
-                return NG_PARSE_ERROR;
-            n = node((ng_graph*)g, row->values[vi].id);
-            if (n && ng_cy_node_matches(g, n, &m->nodes[0])) {
-                if (ng_cy_expand_from_node(g, q, m, 0, n, row, out, out_count, &cap) != NG_OK) {
-                    free(*out);
-                    return NG_OOM;
-                }
+            if (row->values[vi].kind != 1) {
+                s = NG_PARSE_ERROR;
+                break;
             }
+            n = node((ng_graph*)g, row->values[vi].id);
+            if (n && ng_cy_expand_node_ok(&x, m, 0, n) && ng_cy_pushdown_matches(g, pd, vi, row) &&
+                ng_cy_expand_from_node(g, q, m, &x, 0, n, row, out, out_count, &cap) != NG_OK)
+                s = NG_OOM;
         } else {
-            for (j = 0; j < g->nn; j++) {
+            for (j = 0; s == NG_OK && j < g->nn && !ng_cy_expand_done(&x, *out_count); j++) {
                 ng_cy_row nr = *row;
-                if (!ng_cy_node_matches(g, &g->no[j], &m->nodes[0]))
+                if (!ng_cy_expand_node_ok(&x, m, 0, &g->no[j]))
                     continue;
-                if (!ng_cy_bind(&nr, vi, 1, g->no[j].id))
+                if (!ng_cy_bind(&nr, vi, 1, g->no[j].id) ||
+                    !ng_cy_pushdown_matches(g, pd, vi, &nr))
                     continue;
-                if (ng_cy_expand_from_node(g, q, m, 0, &g->no[j], &nr, out, out_count, &cap) !=
-                    NG_OK) {
-                    free(*out);
-                    return NG_OOM;
-                }
+                if (ng_cy_expand_from_node(g, q, m, &x, 0, &g->no[j], &nr, out, out_count, &cap) !=
+                    NG_OK)
+                    s = NG_OOM;
             }
         }
     }
-    return NG_OK;
+    ng_cy_bfs_free(&bfs);
+    if (s == NG_OOM && out) {
+        free(*out);
+        *out = NULL;
+        *out_count = 0;
+    }
+    return s;
+}
+/* Semi/anti-join probe: expansion stops at the first path that satisfies the pattern and counts it
+ * instead of materializing a row. */
+static ng_status ng_cy_pattern_exists(
+    const ng_graph* g, const ng_cy_query* q, const ng_cy_row* row, int expr, int* found) {
+    const ng_cy_expr* e = &q->exprs[expr];
+    size_t hits = 0;
+    ng_status s;
+    *found = 0;
+    if (e->term < 0 || (size_t)e->term >= q->pattern_count)
+        return NG_PARSE_ERROR;
+    s = ng_cy_apply_match(g, q, &q->patterns[e->term], NULL, row, 1, e->left, 1, NULL, &hits);
+    *found = hits != 0;
+    return s;
 }
 static void ng_cy_bind_optional_nulls(ng_cy_row* row, const ng_cy_match* m) {
     size_t i;
@@ -10021,40 +12902,44 @@ static ng_status ng_cy_apply_optional_match(const ng_graph* g,
                                             const ng_cy_row* in,
                                             size_t in_count,
                                             int where_root,
+                                            size_t limit,
                                             ng_cy_row** out,
                                             size_t* out_count) {
+    ng_cy_pushdown pd;
+    ng_cy_program prog;
     size_t i, cap = 0;
+    ng_status s;
     *out = NULL;
     *out_count = 0;
-    for (i = 0; i < in_count; i++) {
+    s = ng_cy_plan_pushdown(g, q, m, where_root, &pd);
+    if (s == NG_OK)
+        s = ng_cy_compile_where(g, q, limit ? -1 : where_root, &prog);
+    for (i = 0; s == NG_OK && i < in_count; i++) {
         ng_cy_row* tmp = NULL;
         size_t tmp_count = 0, j;
-        ng_status s = ng_cy_apply_match(g, q, m, &in[i], 1, &tmp, &tmp_count);
-        if (s != NG_OK) {
-            free(*out);
-            return s;
-        }
-        if (where_root >= 0)
-            ng_cy_apply_where(g, q, tmp, &tmp_count, where_root);
+        s = ng_cy_apply_match(
+            g, q, m, &pd, &in[i], 1, limit ? where_root : -1, limit, &tmp, &tmp_count);
+        if (s != NG_OK)
+            break;
+        ng_cy_filter_rows(g, q, &prog, tmp, &tmp_count);
         if (tmp_count) {
-            for (j = 0; j < tmp_count; j++)
-                if (!ng_cy_append_row(out, out_count, &cap, &tmp[j])) {
-                    free(tmp);
-                    free(*out);
-                    return NG_OOM;
-                }
+            for (j = 0; s == NG_OK && j < tmp_count; j++)
+                if (!ng_cy_append_row(out, out_count, &cap, &tmp[j]))
+                    s = NG_OOM;
         } else {
             ng_cy_row nr = in[i];
             ng_cy_bind_optional_nulls(&nr, m);
-            if (!ng_cy_append_row(out, out_count, &cap, &nr)) {
-                free(tmp);
-                free(*out);
-                return NG_OOM;
-            }
+            if (!ng_cy_append_row(out, out_count, &cap, &nr))
+                s = NG_OOM;
         }
         free(tmp);
     }
-    return NG_OK;
+    if (s != NG_OK) {
+        free(*out);
+        *out = NULL;
+        *out_count = 0;
+    }
+    return s;
 }
 static ng_status ng_cy_eval_scalar(
     const ng_graph* g, const ng_cy_query* q, const ng_cy_row* row, int index, ng_value* out) {
@@ -10105,7 +12990,7 @@ static ng_status ng_cy_eval_scalar(
             out->as.integer = (int64_t)bind.id;
             return NG_OK;
         }
-        key = ng_symbol_id_by_text(g, s->key);
+        key = s->key_id ? s->key_id : ng_symbol_id_by_text(g, s->key);
         if (key) {
             if (bind.kind == 1) {
                 node_i* n = node((ng_graph*)g, bind.id);
@@ -10624,15 +13509,12 @@ static ng_status ng_cy_eval_scalar(
         return NG_PARSE_ERROR;
     return NG_OK;
 }
-static ng_status ng_cy_apply_unwind(
-    const ng_graph* g, ng_cy_query* q, ng_cy_row** rows, size_t* row_count, const char** pp) {
+typedef ng_status (*ng_cy_row_visitor)(void* context, ng_cy_row* row);
+static ng_status ng_cy_parse_unwind(
+    const ng_graph* g, ng_cy_query* q, const char** pp, int* scalar, int* vi) {
     const char* p = ng_skip_ws(*pp + 6);
-    ng_cy_row* out = NULL;
-    size_t out_count = 0, out_cap = 0, i, j;
-    int scalar, vi;
     char name[64];
-    ng_status s;
-    if (ng_cy_parse_scalar_add(&p, q, &scalar) != NG_OK)
+    if (ng_cy_parse_scalar_add(&p, q, scalar) != NG_OK)
         return NG_PARSE_ERROR;
     p = ng_skip_ws(p);
     if (strncmp(p, "AS", 2) || !isspace((unsigned char)p[2]))
@@ -10642,55 +13524,84 @@ static ng_status ng_cy_apply_unwind(
         return NG_PARSE_ERROR;
     if (ng_cy_var_lookup(q, name) >= 0)
         return NG_PARSE_ERROR;
-    vi = ng_cy_var_index(q, name, 3, 1);
-    if (vi < 0)
+    *vi = ng_cy_var_index(q, name, 3, 1);
+    if (*vi < 0)
         return NG_PARSE_ERROR;
-    for (i = 0; i < *row_count; i++) {
-        const ng_cy_scalar* src = &q->scalars[scalar];
-        if (src->kind == 7) {
-            for (j = 0; j < (size_t)src->list_count; j++) {
-                ng_value item;
-                ng_cy_row nr = (*rows)[i];
-                s = ng_cy_eval_scalar(g, q, &(*rows)[i], src->list_items[j], &item);
-                if (s != NG_OK) {
-                    free(out);
-                    return s;
-                }
-                nr.values[vi].kind = 3;
-                nr.values[vi].value = item;
-                if (!ng_cy_append_row(&out, &out_count, &out_cap, &nr)) {
-                    free(out);
-                    return out_count >= NG_CY_MAX_ROWS ? NG_LIMIT : NG_OOM;
-                }
-            }
-        } else {
-            ng_value list;
-            s = ng_cy_eval_scalar(g, q, &(*rows)[i], scalar, &list);
-            if (s != NG_OK) {
-                free(out);
+    ng_cy_prepare_scalars(g, q);
+    *pp = ng_skip_ws(p);
+    return NG_OK;
+}
+static ng_status ng_cy_unwind_row(const ng_graph* g,
+                                  const ng_cy_query* q,
+                                  const ng_cy_row* row,
+                                  int scalar,
+                                  int vi,
+                                  ng_cy_row_visitor visitor,
+                                  void* context) {
+    const ng_cy_scalar* src = &q->scalars[scalar];
+    ng_value list;
+    size_t j;
+    ng_status s;
+    if (src->kind == 7) {
+        for (j = 0; j < (size_t)src->list_count; j++) {
+            ng_cy_row nr = *row;
+            s = ng_cy_eval_scalar(g, q, row, src->list_items[j], &nr.values[vi].value);
+            if (s != NG_OK)
                 return s;
-            }
-            if (list.type == NG_VALUE_NULL)
-                continue;
-            if (list.type != NG_VALUE_LIST || !list.as.list) {
-                free(out);
-                return NG_PARSE_ERROR;
-            }
-            for (j = 0; j < list.as.list->count; j++) {
-                ng_cy_row nr = (*rows)[i];
-                nr.values[vi].kind = 3;
-                nr.values[vi].value = list.as.list->items[j];
-                if (!ng_cy_append_row(&out, &out_count, &out_cap, &nr)) {
-                    free(out);
-                    return out_count >= NG_CY_MAX_ROWS ? NG_LIMIT : NG_OOM;
-                }
-            }
+            nr.values[vi].kind = 3;
+            s = visitor(context, &nr);
+            if (s != NG_OK)
+                return s;
+        }
+        return NG_OK;
+    }
+    s = ng_cy_eval_scalar(g, q, row, scalar, &list);
+    if (s != NG_OK)
+        return s;
+    if (list.type == NG_VALUE_NULL)
+        return NG_OK;
+    if (list.type != NG_VALUE_LIST || !list.as.list)
+        return NG_PARSE_ERROR;
+    for (j = 0; j < list.as.list->count; j++) {
+        ng_cy_row nr = *row;
+        nr.values[vi].kind = 3;
+        nr.values[vi].value = list.as.list->items[j];
+        s = visitor(context, &nr);
+        if (s != NG_OK)
+            return s;
+    }
+    return NG_OK;
+}
+typedef struct {
+    ng_cy_row* rows;
+    size_t count, cap;
+} ng_cy_row_buffer;
+static ng_status ng_cy_row_buffer_append(void* context, ng_cy_row* row) {
+    ng_cy_row_buffer* b = (ng_cy_row_buffer*)context;
+    if (!ng_cy_append_row(&b->rows, &b->count, &b->cap, row))
+        return b->count >= NG_CY_MAX_ROWS ? NG_LIMIT : NG_OOM;
+    return NG_OK;
+}
+static ng_status ng_cy_unwind_rows(const ng_graph* g,
+                                   const ng_cy_query* q,
+                                   ng_cy_row** rows,
+                                   size_t* row_count,
+                                   int scalar,
+                                   int vi) {
+    ng_cy_row_buffer out;
+    size_t i;
+    ng_status s;
+    memset(&out, 0, sizeof(out));
+    for (i = 0; i < *row_count; i++) {
+        s = ng_cy_unwind_row(g, q, &(*rows)[i], scalar, vi, ng_cy_row_buffer_append, &out);
+        if (s != NG_OK) {
+            free(out.rows);
+            return s;
         }
     }
     free(*rows);
-    *rows = out;
-    *row_count = out_count;
-    *pp = ng_skip_ws(p);
+    *rows = out.rows;
+    *row_count = out.count;
     return NG_OK;
 }
 static int ng_cy_clause_starts(const char* p, const char* kw) {
@@ -10777,6 +13688,11 @@ static int ng_query_has_statement_separator(const char* query) {
             p++;
             continue;
         }
+        if (p[0] == '/' && p[1] == '/') {
+            while (*p && *p != '\n')
+                p++;
+            continue;
+        }
         if (*p == ';')
             return 1;
         p++;
@@ -10790,9 +13706,13 @@ static ng_status ng_cy_remove_label(ng_graph* g, ng_node_id id, ng_symbol_id lab
         return NG_NOT_FOUND;
     for (i = 0; i < n->nl; i++)
         if (n->labels[i] == label) {
+            ng_count_stats_note(g, &label, 1, 0, -1);
+            ng_count_postings_note(g, n, 0, -1);
             if (i + 1 < n->nl)
                 memmove(&n->labels[i], &n->labels[i + 1], (n->nl - i - 1) * sizeof(*n->labels));
             n->nl--;
+            ng_count_postings_note(g, n, 0, 1);
+            ng_graph_bump(g);
             return NG_OK;
         }
     return NG_NOT_FOUND;
@@ -10883,35 +13803,103 @@ static int ng_cy_scope_project_var(ng_cy_query* q, const char* name, int kind) {
     }
     return ng_cy_var_index(q, name, kind, 1);
 }
-static int ng_cy_projection_seen(const ng_cy_result_key* seen,
-                                 size_t seen_count,
-                                 const ng_cy_result_key* key,
-                                 size_t count) {
-    size_t i, j;
-    for (i = 0; i < seen_count; i++) {
-        int same = 1;
-        for (j = 0; j < count; j++)
-            if (!ng_value_equal(&seen[i].values[j], &key->values[j])) {
-                same = 0;
-                break;
-            }
-        if (same)
-            return 1;
-    }
-    return 0;
+typedef struct {
+    uint32_t hash;
+    size_t entry;
+} ng_cy_hash_slot;
+typedef struct {
+    ng_cy_hash_slot* slots;
+    size_t cap, count;
+} ng_cy_hash_table;
+static ng_status ng_cy_hash_reserve(ng_cy_hash_table* t) {
+    ng_cy_hash_slot* slots;
+    size_t cap, i, j;
+    if (t->cap && (t->count + 1) * 2 <= t->cap)
+        return NG_OK;
+    if (ng_test_maybe_fail() != NG_OK)
+        return NG_OOM;
+    cap = t->cap ? t->cap * 2 : 16;
+    if (cap < t->cap || cap > SIZE_MAX / sizeof(*slots))
+        return NG_OOM;
+    slots = (ng_cy_hash_slot*)calloc(cap, sizeof(*slots));
+    if (!slots)
+        return NG_OOM;
+    for (i = 0; i < t->cap; i++)
+        if (t->slots[i].entry) {
+            for (j = t->slots[i].hash & (cap - 1); slots[j].entry; j = (j + 1) & (cap - 1))
+                ;
+            slots[j] = t->slots[i];
+        }
+    free(t->slots);
+    t->slots = slots;
+    t->cap = cap;
+    return NG_OK;
+}
+static void ng_cy_hash_insert(ng_cy_hash_table* t, size_t pos, uint32_t h, size_t entry) {
+    t->slots[pos].hash = h;
+    t->slots[pos].entry = entry + 1;
+    t->count++;
+}
+static void ng_cy_hash_free(ng_cy_hash_table* t) {
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+static uint32_t ng_cy_key_hash(const ng_cy_result_key* k, const ng_cy_projection* p, size_t n) {
+    uint32_t h = 2166136261u;
+    size_t i;
+    for (i = 0; i < n; i++)
+        if (!p || !p[i].aggregate)
+            h = ng_value_hash_from(h, &k->values[i]);
+    return h;
+}
+static int ng_cy_key_equal(const ng_cy_result_key* a,
+                           const ng_cy_result_key* b,
+                           const ng_cy_projection* p,
+                           size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++)
+        if ((!p || !p[i].aggregate) && !ng_value_equal(&a->values[i], &b->values[i]))
+            return 0;
+    return 1;
+}
+static ng_status ng_cy_projection_seen(ng_cy_result_key** seen,
+                                       size_t* seen_count,
+                                       size_t* seen_cap,
+                                       ng_cy_hash_table* index,
+                                       const ng_cy_result_key* key,
+                                       size_t count,
+                                       int* found) {
+    uint32_t h = ng_cy_key_hash(key, NULL, count);
+    size_t pos;
+    ng_status s = ng_cy_hash_reserve(index);
+    if (s != NG_OK)
+        return s;
+    for (pos = h & (index->cap - 1); index->slots[pos].entry; pos = (pos + 1) & (index->cap - 1))
+        if (index->slots[pos].hash == h &&
+            ng_cy_key_equal(&(*seen)[index->slots[pos].entry - 1], key, NULL, count)) {
+            *found = 1;
+            return NG_OK;
+        }
+    if (!grow((void**)seen, seen_cap, *seen_count + 1, sizeof(**seen)))
+        return NG_OOM;
+    (*seen)[*seen_count] = *key;
+    ng_cy_hash_insert(index, pos, h, (*seen_count)++);
+    *found = 0;
+    return NG_OK;
 }
 static ng_status ng_cy_parse_projection_list(const char** pp,
                                              ng_cy_query* q,
                                              const char* keyword,
-                                             ng_cy_projection* projs,
+                                             ng_cy_projection** projs,
                                              size_t* count,
                                              int* distinct,
                                              int for_with) {
     const char* p = ng_skip_ws(*pp);
-    size_t kw = strlen(keyword);
+    size_t kw = strlen(keyword), capacity = 0;
     if (strncmp(p, keyword, kw) || !isspace((unsigned char)p[kw]))
         return NG_PARSE_ERROR;
     p = ng_skip_ws(p + kw);
+    *projs = NULL;
     *count = 0;
     *distinct = 0;
     if (!strncmp(p, "DISTINCT", 8) && isspace((unsigned char)p[8])) {
@@ -10923,9 +13911,10 @@ static ng_status ng_cy_parse_projection_list(const char** pp,
         const char* expression_start = p;
         int scalar = -1, kind = 3;
         char alias[64] = {0};
-        if (*count >= NG_CY_MAX_RETURNS)
+        if (*count >= NG_CY_MAX_RETURNS ||
+            !ng_cy_reserve(q, (void**)projs, &capacity, *count, sizeof(**projs)))
             return NG_PARSE_ERROR;
-        r = &projs[*count];
+        r = &(*projs)[*count];
         memset(r, 0, sizeof(*r));
         r->var_index = -1;
         r->scalar_index = -1;
@@ -11008,18 +13997,53 @@ static ng_status ng_cy_parse_projection_list(const char** pp,
 }
 static ng_status ng_cy_apply_where(
     const ng_graph* g, const ng_cy_query* q, ng_cy_row* rows, size_t* count, int root) {
-    size_t i, w = 0;
-    for (i = 0; i < *count; i++)
-        if (ng_cy_expr_matches(g, q, &rows[i], root))
-            rows[w++] = rows[i];
-    *count = w;
+    ng_cy_program prog;
+    ng_status s = ng_cy_compile_where(g, q, root, &prog);
+    if (s == NG_OK)
+        ng_cy_filter_rows(g, q, &prog, rows, count);
+    return s;
+}
+typedef struct {
+    ng_value* items;
+    size_t count, cap;
+    ng_cy_hash_table index;
+} ng_cy_value_set;
+static ng_status ng_cy_value_set_add(ng_cy_value_set* set, const ng_value* v, int* added) {
+    uint32_t h = ng_value_hash(v);
+    size_t pos;
+    ng_status s = ng_cy_hash_reserve(&set->index);
+    if (s != NG_OK)
+        return s;
+    for (pos = h & (set->index.cap - 1); set->index.slots[pos].entry;
+         pos = (pos + 1) & (set->index.cap - 1))
+        if (set->index.slots[pos].hash == h &&
+            ng_value_equal(&set->items[set->index.slots[pos].entry - 1], v)) {
+            *added = 0;
+            return NG_OK;
+        }
+    if (!grow((void**)&set->items, &set->cap, set->count + 1, sizeof(*set->items)))
+        return NG_OOM;
+    memset(&set->items[set->count], 0, sizeof(*set->items));
+    s = valcopy(&set->items[set->count], v);
+    if (s != NG_OK)
+        return s;
+    ng_cy_hash_insert(&set->index, pos, h, set->count++);
+    *added = 1;
     return NG_OK;
 }
+static void ng_cy_value_set_free(ng_cy_value_set* set) {
+    size_t i;
+    for (i = 0; i < set->count; i++)
+        valfree(&set->items[i]);
+    free(set->items);
+    ng_cy_hash_free(&set->index);
+    memset(set, 0, sizeof(*set));
+}
 typedef struct {
     ng_cy_result_key key;
     ng_cy_binding passthrough[NG_CY_MAX_RETURNS];
     ng_value agg[NG_CY_MAX_RETURNS];
-    ng_value_list* seen[NG_CY_MAX_RETURNS];
+    ng_cy_value_set seen[NG_CY_MAX_RETURNS];
     int sum_seen[NG_CY_MAX_RETURNS], sum_double[NG_CY_MAX_RETURNS];
 } ng_cy_group;
 static int ng_cy_has_aggregate(const ng_cy_projection* p, size_t n) {
@@ -11029,25 +14053,6 @@ static int ng_cy_has_aggregate(const ng_cy_projection* p, size_t n) {
             return 1;
     return 0;
 }
-static int ng_cy_group_key_equal(const ng_cy_group* g,
-                                 const ng_cy_result_key* k,
-                                 const ng_cy_projection* p,
-                                 size_t n) {
-    size_t i;
-    for (i = 0; i < n; i++)
-        if (!p[i].aggregate && !ng_value_equal(&g->key.values[i], &k->values[i]))
-            return 0;
-    return 1;
-}
-static int ng_cy_list_contains(const ng_value_list* l, const ng_value* v) {
-    size_t i;
-    if (!l)
-        return 0;
-    for (i = 0; i < l->count; i++)
-        if (ng_value_equal(&l->items[i], v))
-            return 1;
-    return 0;
-}
 static ng_status ng_cy_list_add(ng_value_list** lp, const ng_value* v) {
     ng_value_list* l = *lp;
     ng_value copy;
@@ -11133,11 +14138,12 @@ static ng_status ng_cy_aggregate_row(const ng_graph* g,
             if (v.type == NG_VALUE_NULL)
                 continue;
             if (p[j].aggregate_distinct) {
-                if (ng_cy_list_contains(grp->seen[j], &v))
-                    continue;
-                s = ng_cy_list_add(&grp->seen[j], &v);
+                int added;
+                s = ng_cy_value_set_add(&grp->seen[j], &v, &added);
                 if (s != NG_OK)
                     return s;
+                if (!added)
+                    continue;
             }
             if (p[j].aggregate == 1)
                 grp->agg[j].as.integer++;
@@ -11168,6 +14174,12 @@ static ng_status ng_cy_aggregate_row(const ng_graph* g,
         }
     return NG_OK;
 }
+static void ng_cy_free_group_sets(ng_cy_group* groups, size_t count, size_t n) {
+    size_t i, j;
+    for (i = 0; i < count; i++)
+        for (j = 0; j < n; j++)
+            ng_cy_value_set_free(&groups[i].seen[j]);
+}
 static ng_status ng_cy_build_groups(const ng_graph* g,
                                     ng_cy_query* q,
                                     ng_cy_row* rows,
@@ -11177,9 +14189,11 @@ static ng_status ng_cy_build_groups(const ng_graph* g,
                                     ng_cy_group** out,
                                     size_t* out_count) {
     ng_cy_group* groups = NULL;
+    ng_cy_hash_table index;
     size_t count = 0, cap = 0, i, j;
-    ng_status s;
+    ng_status s = NG_OK;
     int has_group = 0;
+    memset(&index, 0, sizeof(index));
     for (j = 0; j < n; j++)
         if (!p[j].aggregate)
             has_group = 1;
@@ -11189,38 +14203,40 @@ static ng_status ng_cy_build_groups(const ng_graph* g,
         memset(&empty, 0, sizeof(empty));
         memset(&erow, 0, sizeof(erow));
         s = ng_cy_group_add(&groups, &count, &cap, &empty, p, n, &erow);
-        if (s != NG_OK) {
-            free(groups);
-            return s;
-        }
     }
-    for (i = 0; i < row_count; i++) {
+    for (i = 0; s == NG_OK && i < row_count; i++) {
         ng_cy_result_key key;
-        size_t gi;
+        uint32_t h;
+        size_t gi, pos;
         memset(&key, 0, sizeof(key));
-        for (j = 0; j < n; j++)
-            if (!p[j].aggregate) {
+        for (j = 0; s == NG_OK && j < n; j++)
+            if (!p[j].aggregate)
                 s = ng_cy_eval_scalar(g, q, &rows[i], p[j].scalar_index, &key.values[j]);
-                if (s != NG_OK) {
-                    free(groups);
-                    return s;
-                }
-            }
-        for (gi = 0; gi < count; gi++)
-            if (ng_cy_group_key_equal(&groups[gi], &key, p, n))
+        if (s == NG_OK)
+            s = ng_cy_hash_reserve(&index);
+        if (s != NG_OK)
+            break;
+        h = ng_cy_key_hash(&key, p, n);
+        gi = count;
+        for (pos = h & (index.cap - 1); index.slots[pos].entry; pos = (pos + 1) & (index.cap - 1))
+            if (index.slots[pos].hash == h &&
+                ng_cy_key_equal(&groups[index.slots[pos].entry - 1].key, &key, p, n)) {
+                gi = index.slots[pos].entry - 1;
                 break;
+            }
         if (gi == count) {
             s = ng_cy_group_add(&groups, &count, &cap, &key, p, n, &rows[i]);
-            if (s != NG_OK) {
-                free(groups);
-                return s;
-            }
+            if (s != NG_OK)
+                break;
+            ng_cy_hash_insert(&index, pos, h, gi);
         }
         s = ng_cy_aggregate_row(g, q, p, n, &rows[i], &groups[gi]);
-        if (s != NG_OK) {
-            free(groups);
-            return s;
-        }
+    }
+    ng_cy_hash_free(&index);
+    ng_cy_free_group_sets(groups, count, n);
+    if (s != NG_OK) {
+        free(groups);
+        return s;
     }
     *out = groups;
     *out_count = count;
@@ -11255,6 +14271,44 @@ ng_cy_activate_return_aliases(ng_cy_query* q, ng_cy_projection* projs, size_t pr
         }
     return NG_OK;
 }
+/* OPTIONAL MATCH ... WITH ..., x WHERE x IS NULL keeps only input rows without a match, so one hit
+ * per input row decides it.  Dry-run parses the WITH (query state is restored) and accepts it when
+ * it passes a new variable of the optional pattern through (or its id, which is null with it),
+ * has no aggregates, and its WHERE is nothing but the null test on that variable. */
+static int ng_cy_optional_anti_join(ng_cy_query* q, size_t first, const char* p) {
+    ng_cy_query saved = *q;
+    ng_cy_block* arena;
+    ng_cy_projection* projs = NULL;
+    const ng_cy_term* t;
+    size_t count = 0, i;
+    int distinct = 0, root, ok = 0;
+    if (!ng_cy_clause_starts(p, "WITH"))
+        return 0;
+    if (ng_cy_parse_projection_list(&p, q, "WITH", &projs, &count, &distinct, 1) != NG_OK ||
+        ng_cy_activate_with_scope(q, projs, count) != NG_OK)
+        goto done;
+    p = ng_skip_ws(p);
+    if (!ng_cy_clause_starts(p, "WHERE"))
+        goto done;
+    p = ng_skip_ws(p + 5);
+    if (ng_cy_parse_or(&p, q, &root) != NG_OK || q->exprs[root].kind != 0)
+        goto done;
+    t = &q->terms[q->exprs[root].term];
+    if (t->op != 7 || t->key[0] || t->is_id || t->var_index < (int)first)
+        goto done;
+    for (i = 0; i < count; i++) {
+        if (projs[i].aggregate)
+            goto done;
+        if (projs[i].var_index == t->var_index && projs[i].out_var_index == t->var_index &&
+            !projs[i].is_property)
+            ok = 1;
+    }
+done:
+    arena = q->arena;
+    *q = saved;
+    q->arena = arena;
+    return ok;
+}
 static int ng_cy_projection_index_for_scalar(const ng_cy_query* q,
                                              const ng_cy_projection* p,
                                              size_t n,
@@ -11382,6 +14436,82 @@ static void ng_cy_sort_projected_rows(const ng_graph* g,
     ng_cy_sort_order_count = order_count;
     qsort(rows, count, sizeof(*rows), ng_cy_projected_row_compare);
 }
+static int ng_cy_top_k_before(const ng_cy_projected_row* rows, size_t a, size_t b) {
+    int c = ng_cy_projected_row_compare(&rows[a], &rows[b]);
+    return c ? c < 0 : a < b;
+}
+static void ng_cy_top_k_sift(const ng_cy_projected_row* rows, size_t* heap, size_t n, size_t i) {
+    for (;;) {
+        size_t l = 2 * i + 1, r = l + 1, m = i, t;
+        if (l < n && ng_cy_top_k_before(rows, heap[m], heap[l]))
+            m = l;
+        if (r < n && ng_cy_top_k_before(rows, heap[m], heap[r]))
+            m = r;
+        if (m == i)
+            return;
+        t = heap[i];
+        heap[i] = heap[m];
+        heap[m] = t;
+        i = m;
+    }
+}
+static ng_status ng_cy_top_k_projected_rows(const ng_graph* g,
+                                            const ng_cy_query* q,
+                                            ng_cy_projected_row* rows,
+                                            size_t* count,
+                                            const ng_cy_order* orders,
+                                            size_t order_count,
+                                            uint64_t skip,
+                                            int has_skip,
+                                            uint64_t limit,
+                                            int has_limit) {
+    ng_cy_projected_row* kept;
+    size_t* heap;
+    size_t k, i, n;
+    if (!has_skip)
+        skip = 0;
+    if (!has_limit || !order_count || skip >= *count || limit >= *count - skip) {
+        ng_cy_sort_projected_rows(g, q, rows, *count, orders, order_count);
+        return NG_OK;
+    }
+    k = (size_t)(skip + limit);
+    if (!k) {
+        *count = 0;
+        return NG_OK;
+    }
+    if (ng_test_maybe_fail() != NG_OK || k > SIZE_MAX / sizeof(*kept))
+        return NG_OOM;
+    heap = (size_t*)malloc(k * sizeof(*heap));
+    kept = (ng_cy_projected_row*)malloc(k * sizeof(*kept));
+    if (!heap || !kept) {
+        free(heap);
+        free(kept);
+        return NG_OOM;
+    }
+    ng_cy_sort_graph = g;
+    ng_cy_sort_query = q;
+    ng_cy_sort_orders = orders;
+    ng_cy_sort_order_count = order_count;
+    for (i = 0; i < k; i++)
+        heap[i] = i;
+    for (i = k / 2; i-- > 0;)
+        ng_cy_top_k_sift(rows, heap, k, i);
+    for (i = k; i < *count; i++)
+        if (ng_cy_top_k_before(rows, i, heap[0])) {
+            heap[0] = i;
+            ng_cy_top_k_sift(rows, heap, k, 0);
+        }
+    for (n = k; n > 0; n--) {
+        kept[n - 1] = rows[heap[0]];
+        heap[0] = heap[n - 1];
+        ng_cy_top_k_sift(rows, heap, n - 1, 0);
+    }
+    memcpy(rows, kept, k * sizeof(*rows));
+    free(heap);
+    free(kept);
+    *count = k;
+    return NG_OK;
+}
 static ng_status ng_cy_project_rows(const ng_graph* g,
                                     ng_cy_query* q,
                                     ng_cy_row* rows,
@@ -11394,8 +14524,12 @@ static ng_status ng_cy_project_rows(const ng_graph* g,
                                     size_t* out_count) {
     ng_cy_projected_row* items = NULL;
     ng_cy_result_key* seen = NULL;
+    ng_cy_hash_table seen_index;
     size_t i, j, item_count = 0, item_cap = 0, seen_count = 0, seen_cap = 0;
     ng_status s;
+    int found;
+    memset(&seen_index, 0, sizeof(seen_index));
+    ng_cy_prepare_scalars(g, q);
     if (ng_cy_has_aggregate(projs, proj_count)) {
         ng_cy_group* groups = NULL;
         size_t group_count = 0;
@@ -11407,15 +14541,17 @@ static ng_status ng_cy_project_rows(const ng_graph* g,
             ng_cy_group_key(&groups[i], projs, proj_count, &item.key);
             memset(&item.row, 0, sizeof(item.row));
             if (distinct) {
-                if (ng_cy_projection_seen(seen, seen_count, &item.key, proj_count))
-                    continue;
-                if (!grow((void**)&seen, &seen_cap, seen_count + 1, sizeof(*seen))) {
+                s = ng_cy_projection_seen(
+                    &seen, &seen_count, &seen_cap, &seen_index, &item.key, proj_count, &found);
+                if (s != NG_OK) {
                     free(groups);
                     free(seen);
                     free(items);
-                    return NG_OOM;
+                    ng_cy_hash_free(&seen_index);
+                    return s;
                 }
-                seen[seen_count++] = item.key;
+                if (found)
+                    continue;
             }
             for (j = 0; j < proj_count; j++) {
                 if (projs[j].out_var_index >= 0) {
@@ -11431,12 +14567,14 @@ static ng_status ng_cy_project_rows(const ng_graph* g,
                 free(groups);
                 free(seen);
                 free(items);
+                ng_cy_hash_free(&seen_index);
                 return NG_OOM;
             }
             items[item_count++] = item;
         }
         free(groups);
         free(seen);
+        ng_cy_hash_free(&seen_index);
         *out = items;
         *out_count = item_count;
         return NG_OK;
@@ -11452,6 +14590,7 @@ static ng_status ng_cy_project_rows(const ng_graph* g,
             if (s != NG_OK) {
                 free(items);
                 free(seen);
+                ng_cy_hash_free(&seen_index);
                 return s;
             }
             item.key.values[j] = v;
@@ -11465,23 +14604,27 @@ static ng_status ng_cy_project_rows(const ng_graph* g,
             }
         }
         if (distinct) {
-            if (ng_cy_projection_seen(seen, seen_count, &item.key, proj_count))
-                continue;
-            if (!grow((void**)&seen, &seen_cap, seen_count + 1, sizeof(*seen))) {
+            s = ng_cy_projection_seen(
+                &seen, &seen_count, &seen_cap, &seen_index, &item.key, proj_count, &found);
+            if (s != NG_OK) {
                 free(items);
                 free(seen);
-                return NG_OOM;
+                ng_cy_hash_free(&seen_index);
+                return s;
             }
-            seen[seen_count++] = item.key;
+            if (found)
+                continue;
         }
         if (!grow((void**)&items, &item_cap, item_count + 1, sizeof(*items))) {
             free(items);
             free(seen);
+            ng_cy_hash_free(&seen_index);
             return NG_OOM;
         }
         items[item_count++] = item;
     }
     free(seen);
+    ng_cy_hash_free(&seen_index);
     *out = items;
     *out_count = item_count;
     return NG_OK;
@@ -11506,7 +14649,12 @@ static ng_status ng_cy_apply_with_projected(const ng_graph* g,
         g, q, *rows, *row_count, projs, proj_count, distinct, 0, &items, &item_count);
     if (s != NG_OK)
         return s;
-    ng_cy_sort_projected_rows(g, q, items, item_count, orders, order_count);
+    s = ng_cy_top_k_projected_rows(
+        g, q, items, &item_count, orders, order_count, skip, has_skip, limit, has_limit);
+    if (s != NG_OK) {
+        free(items);
+        return s;
+    }
     for (i = 0; i < item_count; i++) {
         if (has_skip && i < skip)
             continue;
@@ -11666,7 +14814,12 @@ static ng_status ng_cy_emit_rows(const ng_graph* g,
         free(items);
         return s;
     }
-    ng_cy_sort_projected_rows(g, q, items, item_count, orders, order_count);
+    s = ng_cy_top_k_projected_rows(
+        g, q, items, &item_count, orders, order_count, skip, has_skip, limit, has_limit);
+    if (s != NG_OK) {
+        free(items);
+        return s;
+    }
     for (i = 0; i < item_count; i++) {
         if (has_skip && i < skip)
             continue;
@@ -11680,6 +14833,27 @@ static ng_status ng_cy_emit_rows(const ng_graph* g,
         emitted++;
     }
     free(items);
+    if (ng_query_active_profile)
+        ng_query_active_profile->emitted += emitted;
+    return NG_OK;
+}
+static ng_status ng_cy_parse_create_clause(const char** pp, ng_cy_query* q) {
+    const char* p = ng_skip_ws(*pp + 6);
+    q->create_mode = 1;
+    if (ng_cy_parse_create_pattern(&p, q) != NG_OK)
+        return NG_PARSE_ERROR;
+    for (;;) {
+        p = ng_skip_ws(p);
+        if (*p != ',')
+            break;
+        p = ng_skip_ws(p + 1);
+        if (!*p || ng_cy_clause_starts(p, "RETURN") || *p == ',')
+            return NG_PARSE_ERROR;
+        if (ng_cy_parse_create_pattern(&p, q) != NG_OK)
+            return NG_PARSE_ERROR;
+    }
+    q->create_mode = 0;
+    *pp = p;
     return NG_OK;
 }
 static ng_status ng_cy_apply_create_to_rows(
@@ -12127,16 +15301,14 @@ static const char* ng_cy_merge_action_end(const char* p) {
     }
     return end;
 }
-static ng_status ng_cy_copy_merge_action(char* out, size_t capacity, const char* start, const char* end) {
-    size_t length;
+static ng_status
+ng_cy_copy_merge_action(ng_cy_query* q, const char** out, const char* start, const char* end) {
     while (end > start && isspace((unsigned char)end[-1]))
         end--;
-    length = (size_t)(end - start);
-    if (!length || length >= capacity)
+    if (end == start)
         return NG_PARSE_ERROR;
-    memcpy(out, start, length);
-    out[length] = 0;
-    return NG_OK;
+    *out = ng_cy_strndup(q, start, (size_t)(end - start));
+    return *out ? NG_OK : NG_OOM;
 }
 static ng_status ng_cy_apply_merge_action(
     ng_graph* g, ng_cy_query* q, ng_cy_row* row, const char* action, int* changed) {
@@ -12152,14 +15324,7 @@ static ng_status ng_cy_apply_merge_action(
         return s == NG_OK ? NG_PARSE_ERROR : s;
     return NG_OK;
 }
-static ng_status ng_cy_apply_merge_to_rows(ng_graph* g,
-                                           ng_cy_query* q,
-                                           ng_cy_row** rows,
-                                           size_t row_count,
-                                           const char** pp,
-                                           int* changed) {
-    size_t before = q->match_count, i, j;
-    ng_status s;
+static ng_status ng_cy_parse_merge_clause(const char** pp, ng_cy_query* q) {
     const char* p = ng_skip_ws(*pp + 5);
     q->create_mode = 1;
     if (ng_cy_parse_create_pattern(&p, q) != NG_OK)
@@ -12178,8 +15343,8 @@ static ng_status ng_cy_apply_merge_to_rows(ng_graph* g,
             return NG_PARSE_ERROR;
     }
     q->create_mode = 0;
-    q->merge_on_create[0] = 0;
-    q->merge_on_match[0] = 0;
+    q->merge_on_create = "";
+    q->merge_on_match = "";
     for (;;) {
         const char* action_start;
         const char* action_end;
@@ -12188,10 +15353,8 @@ static ng_status ng_cy_apply_merge_to_rows(ng_graph* g,
             if (strncmp(action_start, "SET", 3) || !isspace((unsigned char)action_start[3]))
                 return NG_PARSE_ERROR;
             action_end = ng_cy_merge_action_end(action_start);
-            if (ng_cy_copy_merge_action(q->merge_on_create,
-                                        sizeof(q->merge_on_create),
-                                        action_start,
-                                        action_end) != NG_OK)
+            if (ng_cy_copy_merge_action(q, &q->merge_on_create, action_start, action_end) !=
+                NG_OK)
                 return NG_PARSE_ERROR;
             p = ng_skip_ws(action_end);
         } else if (!strncmp(p, "ON MATCH", 8) && isspace((unsigned char)p[8])) {
@@ -12199,29 +15362,45 @@ static ng_status ng_cy_apply_merge_to_rows(ng_graph* g,
             if (strncmp(action_start, "SET", 3) || !isspace((unsigned char)action_start[3]))
                 return NG_PARSE_ERROR;
             action_end = ng_cy_merge_action_end(action_start);
-            if (ng_cy_copy_merge_action(q->merge_on_match,
-                                        sizeof(q->merge_on_match),
-                                        action_start,
-                                        action_end) != NG_OK)
+            if (ng_cy_copy_merge_action(q, &q->merge_on_match, action_start, action_end) !=
+                NG_OK)
                 return NG_PARSE_ERROR;
             p = ng_skip_ws(action_end);
         } else
             break;
     }
+    *pp = p;
+    return NG_OK;
+}
+static ng_status ng_cy_merge_rows(
+    ng_graph* g, ng_cy_query* q, ng_cy_row* rows, size_t row_count, size_t before, int* changed) {
+    size_t i, j;
+    ng_status s;
     for (i = 0; i < row_count; i++)
         for (j = before; j < q->match_count; j++) {
             int created = 0;
-            s = ng_cy_execute_merge_match(g, q, &q->matches[j], &(*rows)[i], changed, &created);
+            s = ng_cy_execute_merge_match(g, q, &q->matches[j], &rows[i], changed, &created);
             if (s != NG_OK)
                 return s;
             s = ng_cy_apply_merge_action(
-                g, q, &(*rows)[i], created ? q->merge_on_create : q->merge_on_match, changed);
+                g, q, &rows[i], created ? q->merge_on_create : q->merge_on_match, changed);
             if (s != NG_OK)
                 return s;
         }
-    *pp = p;
     return NG_OK;
 }
+static ng_status ng_cy_apply_merge_to_rows(ng_graph* g,
+                                           ng_cy_query* q,
+                                           ng_cy_row** rows,
+                                           size_t row_count,
+                                           const char** pp,
+                                           int* changed) {
+    size_t before = q->match_count;
+    ng_status s = ng_cy_parse_merge_clause(pp, q);
+    if (s != NG_OK)
+        return s;
+    return ng_cy_merge_rows(g, q, *rows, row_count, before, changed);
+}
 static ng_status ng_cy_apply_random_walk(
     const ng_graph* g, ng_cy_query* q, ng_cy_row** rows, size_t* row_count, const char** pp) {
     const char* p = ng_skip_ws(*pp + 4);
@@ -12342,6 +15521,387 @@ static ng_status ng_cy_eval_procedure_argument(const ng_graph* g,
     out->kind = NG_PROCEDURE_SCALAR;
     return ng_cy_eval_scalar(g, q, row, scalar_index, &out->value);
 }
+typedef struct {
+    ng_cy_row* rows;
+    uint64_t* order;
+    size_t count, capacity, keep;
+    uint64_t next_order;
+    int field, desc, top_k;
+} ng_cy_algorithm_sink;
+/* Dry-run parse of the following WITH/RETURN (query state is restored) to detect
+   ORDER BY <field> [SKIP n] LIMIT m over a plain projection. */
+static int ng_cy_algorithm_top_k(const char* p,
+                                 ng_cy_query* q,
+                                 int field,
+                                 ng_cy_algorithm_sink* sink) {
+    ng_cy_query saved = *q;
+    ng_cy_block* arena;
+    ng_cy_projection* projs = NULL;
+    ng_cy_order orders[NG_CY_MAX_RETURNS];
+    const ng_cy_scalar* key;
+    size_t count = 0, order_count = 0, i;
+    uint64_t skip = 0, limit = 0;
+    int distinct = 0, with, ok = 0;
+    p = ng_skip_ws(p);
+    with = ng_cy_clause_starts(p, "WITH");
+    if (field < 0 || (!with && !ng_cy_clause_starts(p, "RETURN")))
+        return 0;
+    if (ng_cy_parse_projection_list(
+            &p, q, with ? "WITH" : "RETURN", &projs, &count, &distinct, with) != NG_OK ||
+        distinct)
+        goto done;
+    if ((with ? ng_cy_activate_with_scope(q, projs, count)
+              : ng_cy_activate_return_aliases(q, projs, count)) != NG_OK)
+        goto done;
+    for (i = 0; i < count; i++)
+        if (projs[i].aggregate)
+            goto done;
+    p = ng_skip_ws(p);
+    if (ng_cy_parse_order_list(&p, q, projs, count, orders, &order_count) != NG_OK ||
+        order_count != 1)
+        goto done;
+    p = ng_skip_ws(p);
+    if (ng_cy_clause_starts(p, "SKIP")) {
+        p = ng_skip_ws(p + 4);
+        if (ng_query_parse_uint64(&p, &skip) != NG_OK)
+            goto done;
+        p = ng_skip_ws(p);
+    }
+    if (!ng_cy_clause_starts(p, "LIMIT"))
+        goto done;
+    p = ng_skip_ws(p + 5);
+    if (ng_query_parse_uint64(&p, &limit) != NG_OK || skip > NG_CY_MAX_ROWS ||
+        limit > NG_CY_MAX_ROWS || skip + limit > NG_CY_MAX_ROWS)
+        goto done;
+    key = &q->scalars[orders[0].proj_index >= 0 ? projs[orders[0].proj_index].scalar_index
+                                                : orders[0].scalar_index];
+    if (key->kind != 1 || key->key[0] || key->var_index != field)
+        goto done;
+    sink->field = field;
+    sink->desc = orders[0].desc;
+    sink->keep = (size_t)(skip + limit);
+    sink->top_k = 1;
+    ok = 1;
+done:
+    arena = q->arena;
+    *q = saved;
+    q->arena = arena;
+    return ok;
+}
+static int ng_cy_algorithm_worse(const ng_cy_algorithm_sink* sink, size_t a, size_t b) {
+    int c = ng_cy_value_compare_order(&sink->rows[a].values[sink->field].value,
+                                      &sink->rows[b].values[sink->field].value,
+                                      sink->desc);
+    return c > 0 || (c == 0 && sink->order[a] > sink->order[b]);
+}
+static void ng_cy_algorithm_swap(ng_cy_algorithm_sink* sink, size_t a, size_t b) {
+    ng_cy_row row = sink->rows[a];
+    uint64_t order = sink->order[a];
+    sink->rows[a] = sink->rows[b];
+    sink->order[a] = sink->order[b];
+    sink->rows[b] = row;
+    sink->order[b] = order;
+}
+static ng_status ng_cy_algorithm_emit(ng_cy_algorithm_sink* sink, const ng_cy_row* row) {
+    size_t i;
+    if (!sink->top_k) {
+        if (!ng_cy_append_row(&sink->rows, &sink->count, &sink->capacity, row))
+            return sink->count >= NG_CY_MAX_ROWS ? NG_LIMIT : NG_OOM;
+        return NG_OK;
+    }
+    if (!sink->keep)
+        return NG_OK;
+    if (!sink->rows) {
+        sink->rows = (ng_cy_row*)malloc(sink->keep * sizeof(*sink->rows));
+        sink->order = (uint64_t*)malloc(sink->keep * sizeof(*sink->order));
+        if (!sink->rows || !sink->order)
+            return NG_OOM;
+    }
+    if (sink->count < sink->keep) {
+        i = sink->count++;
+        sink->rows[i] = *row;
+        sink->order[i] = sink->next_order++;
+        while (i && ng_cy_algorithm_worse(sink, i, (i - 1) / 2)) {
+            ng_cy_algorithm_swap(sink, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return NG_OK;
+    }
+    {
+        int c = ng_cy_value_compare_order(
+            &row->values[sink->field].value, &sink->rows[0].values[sink->field].value, sink->desc);
+        sink->next_order++;
+        if (c >= 0)
+            return NG_OK;
+    }
+    sink->rows[0] = *row;
+    sink->order[0] = sink->next_order - 1;
+    for (i = 0;;) {
+        size_t l = 2 * i + 1, r = l + 1, w = i;
+        if (l < sink->count && ng_cy_algorithm_worse(sink, l, w))
+            w = l;
+        if (r < sink->count && ng_cy_algorithm_worse(sink, r, w))
+            w = r;
+        if (w == i)
+            break;
+        ng_cy_algorithm_swap(sink, i, w);
+        i = w;
+    }
+    return NG_OK;
+}
+typedef struct {
+    ng_symbol_id type;
+    ng_direction direction;
+    double damping, tolerance;
+    uint32_t iterations;
+} ng_cy_algorithm_config;
+static int ng_cy_algorithm_text(const ng_value* v, const char* text) {
+    return v->length == strlen(text) && !memcmp(v->as.string, text, v->length);
+}
+static ng_status ng_cy_algorithm_parse_config(const ng_graph* g,
+                                              const ng_value* v,
+                                              ng_cy_algorithm_config* config) {
+    size_t i;
+    memset(config, 0, sizeof(*config));
+    config->direction = NG_DIRECTION_EITHER;
+    config->iterations = 20;
+    if (v->type == NG_VALUE_NULL)
+        return NG_OK;
+    if (v->type != NG_VALUE_MAP || !v->as.map)
+        return NG_PARSE_ERROR;
+    for (i = 0; i < v->as.map->count; i++) {
+        const char* key = v->as.map->entries[i].key;
+        const ng_value* e = &v->as.map->entries[i].value;
+        if (!strcmp(key, "type") && e->type == NG_VALUE_STRING) {
+            char type[256];
+            if (e->length >= sizeof(type))
+                return NG_NOT_FOUND;
+            memcpy(type, e->as.string, e->length);
+            type[e->length] = 0;
+            config->type = ng_symbol_id_by_text(g, type);
+            if (!config->type)
+                return NG_NOT_FOUND;
+        } else if (!strcmp(key, "direction") && e->type == NG_VALUE_STRING) {
+            if (ng_cy_algorithm_text(e, "OUTGOING"))
+                config->direction = NG_DIRECTION_OUTGOING;
+            else if (ng_cy_algorithm_text(e, "INCOMING"))
+                config->direction = NG_DIRECTION_INCOMING;
+            else if (ng_cy_algorithm_text(e, "BOTH"))
+                config->direction = NG_DIRECTION_EITHER;
+            else
+                return NG_PARSE_ERROR;
+        } else if (!strcmp(key, "damping") &&
+                   (e->type == NG_VALUE_DOUBLE || e->type == NG_VALUE_INT64)) {
+            config->damping = e->type == NG_VALUE_DOUBLE ? e->as.real : (double)e->as.integer;
+        } else if (!strcmp(key, "tolerance") &&
+                   (e->type == NG_VALUE_DOUBLE || e->type == NG_VALUE_INT64)) {
+            config->tolerance = e->type == NG_VALUE_DOUBLE ? e->as.real : (double)e->as.integer;
+        } else if (!strcmp(key, "iterations") && e->type == NG_VALUE_INT64 &&
+                   e->as.integer >= 0 && e->as.integer <= UINT32_MAX) {
+            config->iterations = (uint32_t)e->as.integer;
+        } else {
+            return NG_PARSE_ERROR;
+        }
+    }
+    return NG_OK;
+}
+static const struct {
+    const char* name;
+    const char* field;
+    int output;
+} ng_cy_algorithms[] = {{"pagerank", "score", 0},
+                        {"degree", "score", 0},
+                        {"eigenvector", "score", 0},
+                        {"closeness", "score", 0},
+                        {"harmonic", "score", 0},
+                        {"localClustering", "score", 0},
+                        {"triangles", "triangles", 1},
+                        {"wcc", "component", 2},
+                        {"scc", "component", 2},
+                        {"labelPropagation", "community", 2},
+                        {"louvain", "community", 2},
+                        {"betweenness", "score", 0}};
+static ng_status ng_cy_algorithm_run(const ng_graph* g,
+                                     size_t algorithm,
+                                     const ng_cy_algorithm_config* c,
+                                     void* out,
+                                     size_t capacity,
+                                     size_t* count) {
+    ng_node_score* score = (ng_node_score*)out;
+    switch (algorithm) {
+    case 0: {
+        ng_pagerank_options options;
+        memset(&options, 0, sizeof(options));
+        options.damping = c->damping > 0.0 && c->damping < 1.0 ? c->damping : 0.85;
+        options.max_iterations = c->iterations;
+        options.tolerance = c->tolerance;
+        return ng_pagerank_with_options(g, c->type, &options, score, capacity, count, NULL);
+    }
+    case 1:
+        return ng_degree_centrality(g, c->direction, c->type, score, capacity, count);
+    case 2:
+        return ng_eigenvector_centrality_with_tolerance(g,
+                                                        c->direction,
+                                                        c->type,
+                                                        c->iterations,
+                                                        c->tolerance,
+                                                        score,
+                                                        capacity,
+                                                        count,
+                                                        NULL);
+    case 3:
+        return ng_closeness_centrality(g, c->direction, c->type, score, capacity, count);
+    case 4:
+        return ng_harmonic_centrality(g, c->direction, c->type, score, capacity, count);
+    case 5:
+        return ng_local_clustering_coefficient(g, c->type, score, capacity, count);
+    case 6:
+        return ng_triangle_count(g, c->type, (ng_node_metric*)out, capacity, count);
+    case 7:
+        return ng_weakly_connected_components(
+            g, c->type, (ng_node_component*)out, capacity, count);
+    case 8:
+        return ng_strongly_connected_components(
+            g, c->type, (ng_node_component*)out, capacity, count);
+    case 9:
+        return ng_label_propagation(
+            g, c->direction, c->type, c->iterations, (ng_node_component*)out, capacity, count);
+    case 10:
+        return ng_louvain(g, c->type, c->iterations, (ng_node_component*)out, capacity, count);
+    default:
+        return ng_betweenness_centrality(g, c->direction, c->type, 0, score, capacity, count);
+    }
+}
+static ng_status ng_cy_apply_algorithm(const ng_graph* g,
+                                       ng_cy_query* q,
+                                       ng_cy_row** rows,
+                                       size_t* row_count,
+                                       const char** pp) {
+    const char* p = *pp;
+    char name[64], yield_name[64], alias[64];
+    int argument = -1, node_index = -1, field_index = -1;
+    int yield_indices[2];
+    size_t algorithm, yield_count = 0, i, j, count = 0;
+    ng_cy_algorithm_sink sink;
+    void* results = NULL;
+    size_t result_size;
+    ng_status s = NG_OK;
+    if (*p != '.')
+        return NG_PARSE_ERROR;
+    p++;
+    if (ng_cy_parse_ident(&p, name, sizeof(name)) != NG_OK)
+        return NG_PARSE_ERROR;
+    for (algorithm = 0; algorithm < sizeof(ng_cy_algorithms) / sizeof(ng_cy_algorithms[0]);
+         algorithm++)
+        if (!strcmp(ng_cy_algorithms[algorithm].name, name))
+            break;
+    if (algorithm == sizeof(ng_cy_algorithms) / sizeof(ng_cy_algorithms[0]))
+        return NG_NOT_FOUND;
+    p = ng_skip_ws(p);
+    if (*p != '(')
+        return NG_PARSE_ERROR;
+    p = ng_skip_ws(p + 1);
+    if (*p != ')') {
+        if (ng_cy_parse_scalar_add(&p, q, &argument) != NG_OK)
+            return NG_PARSE_ERROR;
+        p = ng_skip_ws(p);
+    }
+    if (*p != ')')
+        return NG_PARSE_ERROR;
+    p = ng_skip_ws(p + 1);
+    if (!ng_cy_clause_starts(p, "YIELD"))
+        return NG_PARSE_ERROR;
+    p = ng_skip_ws(p + 5);
+    for (;;) {
+        int is_node;
+        if (yield_count >= 2 || ng_cy_parse_ident(&p, yield_name, sizeof(yield_name)) != NG_OK)
+            return NG_PARSE_ERROR;
+        is_node = !strcmp(yield_name, "node");
+        if (!is_node && strcmp(yield_name, ng_cy_algorithms[algorithm].field))
+            return NG_PARSE_ERROR;
+        strcpy(alias, yield_name);
+        p = ng_skip_ws(p);
+        if (ng_cy_clause_starts(p, "AS")) {
+            p = ng_skip_ws(p + 2);
+            if (ng_cy_parse_ident(&p, alias, sizeof(alias)) != NG_OK)
+                return NG_PARSE_ERROR;
+        }
+        yield_indices[yield_count] = ng_cy_var_index(q, alias, is_node ? 1 : 3, 1);
+        if (yield_indices[yield_count] < 0 || (is_node ? node_index : field_index) >= 0)
+            return NG_PARSE_ERROR;
+        if (is_node)
+            node_index = yield_indices[yield_count];
+        else
+            field_index = yield_indices[yield_count];
+        yield_count++;
+        p = ng_skip_ws(p);
+        if (*p != ',')
+            break;
+        p = ng_skip_ws(p + 1);
+    }
+    memset(&sink, 0, sizeof(sink));
+    ng_cy_algorithm_top_k(p, q, field_index, &sink);
+    result_size = ng_cy_algorithms[algorithm].output == 0   ? sizeof(ng_node_score)
+                  : ng_cy_algorithms[algorithm].output == 1 ? sizeof(ng_node_metric)
+                                                            : sizeof(ng_node_component);
+    results = malloc((g->nn ? g->nn : 1) * result_size);
+    if (!results)
+        return NG_OOM;
+    for (i = 0; i < *row_count && s == NG_OK; i++) {
+        ng_cy_algorithm_config config;
+        ng_value v = {NG_VALUE_NULL, 0, {0}};
+        if (argument >= 0) {
+            s = ng_cy_eval_scalar(g, q, &(*rows)[i], argument, &v);
+            if (s != NG_OK)
+                break;
+        }
+        s = ng_cy_algorithm_parse_config(g, &v, &config);
+        if (argument >= 0 && ng_cy_scalar_temporary(q, argument))
+            valfree(&v);
+        if (s == NG_OK)
+            s = ng_cy_algorithm_run(g, algorithm, &config, results, g->nn, &count);
+        for (j = 0; j < count && s == NG_OK; j++) {
+            ng_cy_row row = (*rows)[i];
+            ng_value value;
+            ng_node_id id;
+            if (ng_cy_algorithms[algorithm].output == 0) {
+                id = ((ng_node_score*)results)[j].node;
+                value.type = NG_VALUE_DOUBLE;
+                value.as.real = ((ng_node_score*)results)[j].score;
+            } else if (ng_cy_algorithms[algorithm].output == 1) {
+                id = ((ng_node_metric*)results)[j].node;
+                value.type = NG_VALUE_INT64;
+                value.as.integer = (int64_t)((ng_node_metric*)results)[j].value;
+            } else {
+                id = ((ng_node_component*)results)[j].node;
+                value.type = NG_VALUE_INT64;
+                value.as.integer = (int64_t)((ng_node_component*)results)[j].component;
+            }
+            value.length = 0;
+            if (node_index >= 0) {
+                row.values[node_index].kind = 1;
+                row.values[node_index].id = id;
+            }
+            if (field_index >= 0) {
+                row.values[field_index].kind = 3;
+                row.values[field_index].id = 0;
+                row.values[field_index].value = value;
+            }
+            s = ng_cy_algorithm_emit(&sink, &row);
+        }
+    }
+    free(results);
+    free(sink.order);
+    if (s != NG_OK) {
+        free(sink.rows);
+        return s;
+    }
+    free(*rows);
+    *rows = sink.rows;
+    *row_count = sink.count;
+    *pp = p;
+    return NG_OK;
+}
 static ng_status ng_cy_apply_registered_procedure(
     ng_graph* g, ng_cy_query* q, ng_cy_row** rows, size_t* row_count, const char** pp) {
     const char* p = ng_skip_ws(*pp + 4);
@@ -12357,6 +15917,12 @@ static ng_status ng_cy_apply_registered_procedure(
         return NG_PARSE_ERROR;
     if (!strcmp(procedure_name, "randomWalk"))
         return ng_cy_apply_random_walk(g, q, rows, row_count, pp);
+    if (!strcmp(procedure_name, "algo") && *p == '.') {
+        ng_status s = ng_cy_apply_algorithm(g, q, rows, row_count, &p);
+        if (s == NG_OK)
+            *pp = p;
+        return s;
+    }
     procedure = ng_find_procedure(g, procedure_name);
     if (!procedure)
         return NG_NOT_FOUND;
@@ -12488,10 +16054,19 @@ static ng_status ng_cy_apply_registered_procedure(
     *row_count = output_count;
     return NG_OK;
 }
+static ng_status ng_cy_apply_unwind_write(ng_graph* g,
+                                          ng_cy_query* q,
+                                          ng_cy_row** rows,
+                                          size_t* row_count,
+                                          const char** pp,
+                                          const char** op,
+                                          size_t* streamed,
+                                          int* changed);
 static ng_status
 ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int* handled) {
     const char* p = ng_skip_ws(q);
     ng_cy_query cy;
+    ng_cy_pushdown pd;
     ng_cy_row *rows = NULL, *next = NULL;
     size_t row_count = 1, next_count = 0;
     ng_status s = NG_OK;
@@ -12508,15 +16083,31 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
     if (!rows)
         return NG_OOM;
     for (;;) {
+        const char* op = NULL;
+        size_t rows_in = row_count;
+        ng_query_profile_mark mark;
+        ng_query_profile_begin(&mark);
         last_write = 0;
         p = ng_skip_ws(p);
         if (ng_cy_clause_starts(p, "MATCH")) {
             size_t mi = cy.match_count;
+            int where_root = -1;
             if (ng_cy_parse_match_clause(&p, &cy) != NG_OK) {
                 s = NG_PARSE_ERROR;
                 break;
             }
-            s = ng_cy_apply_match(g, &cy, &cy.matches[mi], rows, row_count, &next, &next_count);
+            p = ng_skip_ws(p);
+            if (ng_cy_clause_starts(p, "WHERE")) {
+                p = ng_skip_ws(p + 5);
+                if (ng_cy_parse_or(&p, &cy, &where_root) != NG_OK) {
+                    s = NG_PARSE_ERROR;
+                    break;
+                }
+            }
+            s = ng_cy_plan_pushdown(g, &cy, &cy.matches[mi], where_root, &pd);
+            if (s == NG_OK)
+                s = ng_cy_apply_match(
+                    g, &cy, &cy.matches[mi], &pd, rows, row_count, -1, 0, &next, &next_count);
             free(rows);
             rows = next;
             row_count = next_count;
@@ -12524,15 +16115,25 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
             next_count = 0;
             if (s != NG_OK)
                 break;
+            ng_query_profile_end(&mark, "Match", rows_in, row_count);
+            if (cy.has_where || where_root >= 0) {
+                rows_in = row_count;
+                ng_query_profile_begin(&mark);
+                op = "Filter";
+            }
             if (cy.has_where) {
                 s = ng_cy_apply_where(g, &cy, rows, &row_count, cy.where_root);
                 if (s != NG_OK)
                     break;
             }
+            if (where_root >= 0) {
+                s = ng_cy_apply_where(g, &cy, rows, &row_count, where_root);
+                if (s != NG_OK)
+                    break;
+            }
         } else if (ng_cy_clause_starts(p, "OPTIONAL")) {
-            size_t mi = cy.match_count;
+            size_t mi = cy.match_count, vars = cy.var_count, limit;
             int old_root = cy.where_root, old_has = cy.has_where, where_root = -1;
-            const char* op = p;
             p = ng_skip_ws(p + 8);
             if (!ng_cy_clause_starts(p, "MATCH")) {
                 s = NG_PARSE_ERROR;
@@ -12560,8 +16161,9 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
             }
             cy.where_root = old_root;
             cy.has_where = old_has;
+            limit = ng_cy_optional_anti_join(&cy, vars, ng_skip_ws(p)) ? 1 : 0;
             s = ng_cy_apply_optional_match(
-                g, &cy, &cy.matches[mi], rows, row_count, where_root, &next, &next_count);
+                g, &cy, &cy.matches[mi], rows, row_count, where_root, limit, &next, &next_count);
             free(rows);
             rows = next;
             row_count = next_count;
@@ -12569,11 +16171,20 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
             next_count = 0;
             if (s != NG_OK)
                 break;
-            (void)op;
+            op = limit ? "AntiSemiApply" : "OptionalMatch";
         } else if (ng_cy_clause_starts(p, "UNWIND")) {
-            s = ng_cy_apply_unwind(g, &cy, &rows, &row_count, &p);
+            size_t streamed = SIZE_MAX;
+            op = "Unwind";
+            s = ng_cy_apply_unwind_write(
+                g, &cy, &rows, &row_count, &p, &op, &streamed, &did_write);
             if (s != NG_OK)
                 break;
+            if (strcmp(op, "Unwind"))
+                last_write = 1;
+            if (streamed != SIZE_MAX) {
+                ng_query_profile_end(&mark, op, rows_in, streamed);
+                op = NULL;
+            }
         } else if (ng_cy_clause_starts(p, "WHERE")) {
             int root;
             p = ng_skip_ws(p + 5);
@@ -12584,15 +16195,18 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
             s = ng_cy_apply_where(g, &cy, rows, &row_count, root);
             if (s != NG_OK)
                 break;
+            op = "Filter";
         } else if (ng_cy_clause_starts(p, "CALL")) {
             s = ng_cy_apply_registered_procedure(g, &cy, &rows, &row_count, &p);
             if (s != NG_OK)
                 break;
+            op = "Call";
         } else if (ng_cy_clause_starts(p, "REMOVE")) {
             s = ng_cy_apply_remove_to_rows(g, &cy, rows, row_count, &p, &did_write);
             if (s != NG_OK)
                 break;
             last_write = 1;
+            op = "Remove";
         } else if (ng_cy_clause_starts(p, "DETACH")) {
             if (!ng_cy_clause_starts(p, "DETACH")) {
                 s = NG_PARSE_ERROR;
@@ -12607,13 +16221,14 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
             if (s != NG_OK)
                 break;
             last_write = 1;
+            op = "Delete";
         } else if (ng_cy_clause_starts(p, "WITH")) {
-            ng_cy_projection projs[NG_CY_MAX_RETURNS];
+            ng_cy_projection* projs;
             ng_cy_order orders[NG_CY_MAX_RETURNS];
             size_t count = 0, order_count = 0;
             int distinct = 0, has_skip = 0, has_limit = 0;
             uint64_t skip = 0, limit = 0;
-            if (ng_cy_parse_projection_list(&p, &cy, "WITH", projs, &count, &distinct, 1) !=
+            if (ng_cy_parse_projection_list(&p, &cy, "WITH", &projs, &count, &distinct, 1) !=
                 NG_OK) {
                 s = NG_PARSE_ERROR;
                 break;
@@ -12660,60 +16275,46 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
                                            has_limit);
             if (s != NG_OK)
                 break;
+            op = "With";
         } else if (ng_cy_clause_starts(p, "CREATE")) {
             size_t before = cy.match_count;
-            cy.create_mode = 1;
-            p = ng_skip_ws(p + 6);
-            if (ng_cy_parse_create_pattern(&p, &cy) != NG_OK) {
+            if (ng_cy_parse_create_clause(&p, &cy) != NG_OK) {
                 s = NG_PARSE_ERROR;
                 break;
             }
-            for (;;) {
-                p = ng_skip_ws(p);
-                if (*p != ',')
-                    break;
-                p = ng_skip_ws(p + 1);
-                if (!*p || ng_cy_clause_starts(p, "RETURN") || *p == ',') {
-                    s = NG_PARSE_ERROR;
-                    break;
-                }
-                if (ng_cy_parse_create_pattern(&p, &cy) != NG_OK) {
-                    s = NG_PARSE_ERROR;
-                    break;
-                }
-            }
-            if (s != NG_OK)
-                break;
-            cy.create_mode = 0;
             s = ng_cy_apply_create_to_rows(g, &cy, &rows, row_count, before);
             if (s != NG_OK)
                 break;
             if (cy.match_count > before)
                 did_write = 1;
             last_write = 1;
+            op = "Create";
         } else if (ng_cy_clause_starts(p, "SET")) {
             s = ng_cy_apply_set_to_rows(g, &cy, rows, row_count, &p, &did_write);
             if (s != NG_OK)
                 break;
             last_write = 1;
+            op = "Set";
         } else if (ng_cy_clause_starts(p, "DELETE")) {
             s = ng_cy_apply_delete_to_rows(g, &cy, rows, row_count, &p, &did_write);
             if (s != NG_OK)
                 break;
             last_write = 1;
+            op = "Delete";
         } else if (ng_cy_clause_starts(p, "MERGE")) {
             s = ng_cy_apply_merge_to_rows(g, &cy, &rows, row_count, &p, &did_write);
             if (s != NG_OK)
                 break;
             last_write = 1;
+            op = "Merge";
         } else if (ng_cy_clause_starts(p, "RETURN")) {
-            ng_cy_projection ret[NG_CY_MAX_RETURNS];
+            ng_cy_projection* ret;
             ng_cy_order orders[NG_CY_MAX_RETURNS];
             size_t count = 0, order_count = 0;
             int distinct = 0;
             uint64_t skip = 0, limit = 0;
             int has_skip = 0, has_limit = 0;
-            if (ng_cy_parse_projection_list(&p, &cy, "RETURN", ret, &count, &distinct, 0) !=
+            if (ng_cy_parse_projection_list(&p, &cy, "RETURN", &ret, &count, &distinct, 0) !=
                 NG_OK) {
                 s = NG_PARSE_ERROR;
                 break;
@@ -12764,50 +16365,286 @@ ng_query_execute_with(ng_graph* g, const char* q, FILE* out, int* mutated, int*
                                 limit,
                                 has_limit,
                                 out);
+            if (s == NG_OK)
+                ng_query_profile_end(&mark, "Return", rows_in, ng_query_profile_emitted(&mark));
             break;
         } else {
             s = NG_PARSE_ERROR;
             break;
         }
+        if (op)
+            ng_query_profile_end(&mark, op, rows_in, row_count);
         if (!*ng_skip_ws(p)) {
             s = last_write ? NG_OK : NG_PARSE_ERROR;
             break;
         }
     }
-    if (ng_query_active_schema && !ng_query_active_schema->valid) {
-        ng_query_active_schema->valid = 1;
-        ng_query_active_schema->count = 0;
+    if (ng_query_active_schema && !ng_query_active_schema->valid) {
+        ng_query_active_schema->valid = 1;
+        ng_query_active_schema->count = 0;
+    }
+    free(rows);
+    ng_cy_query_free(&cy);
+    if (mutated)
+        *mutated = did_write;
+    return s;
+}
+/* Built on first use; the node and relationship mutators keep it current through
+ * ng_count_stats_note() and ng_count_postings_note(), so later writes never force a rebuild. */
+static count_stats_i* ng_count_stats_get(const ng_graph* cg) {
+    ng_graph* g = (ng_graph*)cg;
+    count_stats_i* c = g->counts;
+    size_t i, j, k, symbols = (size_t)g->next_sym + 1;
+    if (c && c->version == g->version)
+        return c;
+    if (!c && !(c = g->counts = (count_stats_i*)calloc(1, sizeof(*c))))
+        return NULL;
+    for (i = 0; i < c->posting_count; i++)
+        c->postings[i].valid = 0;
+    free(c->labels);
+    free(c->types);
+    c->labels = (size_t*)calloc(symbols, sizeof(size_t));
+    c->types = (size_t*)calloc(symbols, sizeof(size_t));
+    if (!c->labels || !c->types) {
+        ng_count_stats_free(c);
+        g->counts = NULL;
+        return NULL;
+    }
+    c->symbols = symbols;
+    for (i = 0; i < g->nn; i++)
+        for (j = 0; j < g->no[i].nl; j++) {
+            for (k = 0; k < j && g->no[i].labels[k] != g->no[i].labels[j]; k++)
+                ;
+            if (k == j && g->no[i].labels[j] < symbols)
+                c->labels[g->no[i].labels[j]]++;
+        }
+    for (i = 0; i < g->nr; i++)
+        if (g->re[i].type < symbols)
+            c->types[g->re[i].type]++;
+    c->version = g->version;
+    return c;
+}
+static int ng_posting_insert(posting_table_i* t, uint32_t h, const ng_value* v) {
+    size_t pos;
+    if ((t->used + 1) * 2 > t->capacity) {
+        size_t capacity = t->capacity * 2, i;
+        posting_i* slots = (posting_i*)calloc(capacity, sizeof(*slots));
+        if (!slots)
+            return 0;
+        for (i = 0; i < t->capacity; i++)
+            if (t->slots[i].count) {
+                for (pos = t->slots[i].hash & (capacity - 1); slots[pos].count;
+                     pos = (pos + 1) & (capacity - 1))
+                    ;
+                slots[pos] = t->slots[i];
+            }
+        free(t->slots);
+        t->slots = slots;
+        t->capacity = capacity;
+    }
+    for (pos = h & (t->capacity - 1); t->slots[pos].count; pos = (pos + 1) & (t->capacity - 1))
+        if (t->slots[pos].hash == h && ng_value_equal(&t->slots[pos].value, v)) {
+            t->slots[pos].count++;
+            return 1;
+        }
+    if (valcopy(&t->slots[pos].value, v) != NG_OK)
+        return 0;
+    t->slots[pos].hash = h;
+    t->slots[pos].count = 1;
+    t->used++;
+    return 1;
+}
+static const posting_table_i*
+ng_count_postings(const ng_graph* g, ng_symbol_id label, ng_symbol_id key) {
+    count_stats_i* c = ng_count_stats_get(g);
+    posting_table_i* t = NULL;
+    size_t i, j;
+    if (!c)
+        return NULL;
+    for (i = 0; i < c->posting_count && !t; i++)
+        if (c->postings[i].label == label && c->postings[i].key == key)
+            t = &c->postings[i];
+    if (!t) {
+        if (!grow((void**)&c->postings,
+                  &c->posting_capacity,
+                  c->posting_count + 1,
+                  sizeof(*c->postings)))
+            return NULL;
+        t = &c->postings[c->posting_count++];
+        memset(t, 0, sizeof(*t));
+        t->label = label;
+        t->key = key;
+    }
+    if (t->slots && t->valid)
+        return t;
+    for (j = 0; j < t->capacity; j++)
+        if (t->slots[j].count)
+            valfree(&t->slots[j].value);
+    free(t->slots);
+    t->used = 0;
+    t->capacity = 16;
+    t->slots = (posting_i*)calloc(t->capacity, sizeof(*t->slots));
+    if (!t->slots) {
+        t->capacity = 0;
+        return NULL;
+    }
+    for (i = 0; i < g->nn; i++) {
+        const prop* p;
+        if (!ng_node_has_label_id(&g->no[i], label) ||
+            !(p = findprop(g->no[i].p, g->no[i].np, key)))
+            continue;
+        if (!ng_posting_insert(t, ng_value_hash_from(2166136261u, &p->v), &p->v))
+            return NULL;
     }
-    free(rows);
-    if (mutated)
-        *mutated = did_write;
-    return s;
+    t->valid = 1;
+    return t;
 }
-static ng_status ng_query_print_generic(const ng_graph* g, const char* q, FILE* out, int* handled) {
-    ng_cy_query cy;
+static void ng_posting_remove(posting_table_i* t, uint32_t h, const ng_value* v) {
+    size_t mask = t->capacity - 1, pos, next;
+    for (pos = h & mask; t->slots[pos].count; pos = (pos + 1) & mask)
+        if (t->slots[pos].hash == h && ng_value_equal(&t->slots[pos].value, v))
+            break;
+    if (!t->slots[pos].count || --t->slots[pos].count)
+        return;
+    valfree(&t->slots[pos].value);
+    t->used--;
+    /* Backward-shift deletion: pull later entries of the probe run into the hole unless their
+     * home slot lies cyclically in (pos, next]. */
+    for (next = (pos + 1) & mask; t->slots[next].count; next = (next + 1) & mask) {
+        size_t home = t->slots[next].hash & mask;
+        if (pos < next ? home <= pos || home > next : home <= pos && home > next) {
+            t->slots[pos] = t->slots[next];
+            pos = next;
+        }
+    }
+    memset(&t->slots[pos], 0, sizeof(t->slots[pos]));
+}
+/* Adds (delta 1) or removes (delta -1) the entries node `n` contributes to the current posting
+ * tables, restricted to `key` when it is nonzero. Mutators call it with -1 before and 1 after a
+ * label or property change. */
+static void ng_count_postings_note(ng_graph* g, const node_i* n, ng_symbol_id key, int delta) {
+    count_stats_i* c = g->counts;
+    size_t i;
+    if (!c || c->version != g->version)
+        return;
+    for (i = 0; i < c->posting_count; i++) {
+        posting_table_i* t = &c->postings[i];
+        const prop* p;
+        uint32_t h;
+        if (!t->valid || (key && t->key != key) || !ng_node_has_label_id(n, t->label) ||
+            !(p = findprop(n->p, n->np, t->key)))
+            continue;
+        h = ng_value_hash_from(2166136261u, &p->v);
+        if (delta < 0)
+            ng_posting_remove(t, h, &p->v);
+        else if (!ng_posting_insert(t, h, &p->v))
+            t->valid = 0;
+    }
+}
+static size_t ng_posting_count(const posting_table_i* t, const ng_value* v) {
+    uint32_t h = ng_value_hash_from(2166136261u, v);
+    size_t pos;
+    for (pos = h & (t->capacity - 1); t->slots[pos].count; pos = (pos + 1) & (t->capacity - 1))
+        if (t->slots[pos].hash == h && ng_value_equal(&t->slots[pos].value, v))
+            return t->slots[pos].count;
+    return 0;
+}
+static int ng_node_index_declared(const ng_graph* g, ng_symbol_id label, ng_symbol_id key) {
+    size_t i;
+    for (i = 0; i < g->nix; i++)
+        if (g->ix[i].label == label && g->ix[i].key == key)
+            return 1;
+    return 0;
+}
+static int ng_cy_count_only(const ng_graph* g, ng_cy_query* q, FILE* out, ng_status* status) {
+    const ng_cy_match* m;
+    const ng_cy_projection* r;
+    const count_stats_i* c;
+    ng_cy_projected_row item;
+    ng_query_profile_mark mark;
+    ng_symbol_id symbol = 0, key;
+    size_t count = 0;
+    int var, index_hit = 0;
+    if (q->match_count != 1 || q->return_count != 1 || q->has_skip || q->has_limit ||
+        q->distinct)
+        return 0;
+    m = &q->matches[0];
+    r = &q->returns[0];
+    if (m->shortest || m->path_var_index >= 0 || r->aggregate != 1)
+        return 0;
+    var = m->rel_count ? m->rels[0].var_index : m->nodes[0].var_index;
+    if (!r->count_star && (r->var_index < 0 || r->var_index != var || r->is_property))
+        return 0;
+    if (!(c = ng_count_stats_get(g)))
+        return 0;
+    if (m->node_count == 1 && !m->rel_count) {
+        const ng_cy_node_pat* a = &m->nodes[0];
+        if (a->label[0])
+            symbol = ng_symbol_id_by_text(g, a->label);
+        if (q->has_where) {
+            const ng_cy_term* t;
+            const posting_table_i* postings;
+            ng_value v;
+            if (q->where_root < 0 || q->exprs[q->where_root].kind != 0)
+                return 0;
+            t = &q->terms[q->exprs[q->where_root].term];
+            if (t->op != 0 || t->is_id || t->var_index != a->var_index || !t->key[0] ||
+                ng_query_resolve_value(&t->value, &v) != NG_OK)
+                return 0;
+            key = ng_symbol_id_by_text(g, t->key);
+            if ((!a->label[0] || symbol) && key) {
+                if (!ng_node_index_declared(g, symbol, key) ||
+                    !(postings = ng_count_postings(g, symbol, key)))
+                    return 0;
+                count = ng_posting_count(postings, &v);
+                index_hit = 1;
+            }
+        } else
+            count = symbol ? c->labels[symbol] : a->label[0] ? 0 : g->nn;
+    } else if (m->node_count == 2 && m->rel_count == 1 && !q->has_where) {
+        const ng_cy_node_pat *a = &m->nodes[0], *b = &m->nodes[1];
+        const ng_cy_rel_pat* rel = &m->rels[0];
+        if (a->label[0] || b->label[0] || rel->prop_count || rel->has_var_length || !rel->dir ||
+            (a->var_index >= 0 && a->var_index == b->var_index) || strchr(rel->type, '|'))
+            return 0;
+        if (rel->type[0])
+            symbol = ng_symbol_id_by_text(g, rel->type);
+        count = symbol ? c->types[symbol] : rel->type[0] ? 0 : g->nr;
+    } else
+        return 0;
+    ng_query_profile_begin(&mark);
+    memset(&item, 0, sizeof(item));
+    item.key.values[0].type = NG_VALUE_INT64;
+    item.key.values[0].as.integer = (int64_t)count;
+    *status = ng_cy_capture_schema(q, q->returns, 1, &item, 1);
+    if (*status == NG_OK)
+        *status = ng_cy_emit_key(&item.key, 1, out);
+    if (*status == NG_OK && ng_query_active_profile) {
+        ng_query_active_profile->emitted++;
+        ng_query_active_profile->index_hits += (size_t)index_hit;
+        ng_query_profile_end(&mark, "Count", 1, 1);
+    }
+    return 1;
+}
+static ng_status ng_cy_execute_read_query(const ng_graph* g, ng_cy_query* cy, FILE* out) {
+    ng_cy_pushdown pd;
+    ng_query_profile_mark mark;
     ng_cy_row *rows = NULL, *next = NULL;
     ng_cy_order orders[NG_CY_MAX_RETURNS];
-    size_t row_count = 1, next_count = 0, i, w, order_count = 0;
+    size_t row_count = 1, next_count = 0, i, order_count = 0, rows_in;
     ng_status s;
-    int with_handled = 0, mut = 0;
-    if (handled)
-        *handled = 0;
-    s = ng_query_execute_with((ng_graph*)g, q, out, &mut, &with_handled);
-    if (with_handled) {
-        if (handled)
-            *handled = 1;
-        return mut ? NG_PARSE_ERROR : s;
-    }
-    s = ng_cy_parse_query(q, &cy);
-    if (s != NG_OK)
-        return NG_OK;
-    if (handled)
-        *handled = 1;
+    if (ng_cy_count_only(g, cy, out, &s))
+        return s;
     rows = calloc(1, sizeof(*rows));
     if (!rows)
         return NG_OOM;
-    for (i = 0; i < cy.match_count; i++) {
-        s = ng_cy_apply_match(g, &cy, &cy.matches[i], rows, row_count, &next, &next_count);
+    for (i = 0; i < cy->match_count; i++) {
+        rows_in = row_count;
+        ng_query_profile_begin(&mark);
+        s = ng_cy_plan_pushdown(g, cy, &cy->matches[i], cy->has_where ? cy->where_root : -1, &pd);
+        if (s == NG_OK)
+            s = ng_cy_apply_match(
+                g, cy, &cy->matches[i], &pd, rows, row_count, -1, 0, &next, &next_count);
         free(rows);
         rows = next;
         row_count = next_count;
@@ -12817,32 +16654,70 @@ static ng_status ng_query_print_generic(const ng_graph* g, const char* q, FILE*
             free(rows);
             return s;
         }
+        ng_query_profile_end(&mark, "Match", rows_in, row_count);
         if (!row_count)
             break;
     }
-    if (cy.has_where) {
-        for (i = 0, w = 0; i < row_count; i++)
-            if (ng_cy_expr_matches(g, &cy, &rows[i], cy.where_root))
-                rows[w++] = rows[i];
-        row_count = w;
+    if (cy->has_where) {
+        rows_in = row_count;
+        ng_query_profile_begin(&mark);
+        s = ng_cy_apply_where(g, cy, rows, &row_count, cy->where_root);
+        if (s != NG_OK) {
+            free(rows);
+            return s;
+        }
+        ng_query_profile_end(&mark, "Filter", rows_in, row_count);
     }
+    rows_in = row_count;
+    ng_query_profile_begin(&mark);
     s = ng_cy_emit_rows(g,
-                        &cy,
+                        cy,
                         rows,
                         row_count,
-                        cy.returns,
-                        cy.return_count,
-                        cy.distinct,
+                        cy->returns,
+                        cy->return_count,
+                        cy->distinct,
                         orders,
                         order_count,
-                        cy.skip,
-                        cy.has_skip,
-                        cy.limit,
-                        cy.has_limit,
+                        cy->skip,
+                        cy->has_skip,
+                        cy->limit,
+                        cy->has_limit,
                         out);
+    if (s == NG_OK)
+        ng_query_profile_end(&mark, "Return", rows_in, ng_query_profile_emitted(&mark));
     free(rows);
     return s;
 }
+static ng_status ng_query_print_generic(const ng_graph* g, const char* q, FILE* out, int* handled) {
+    ng_cy_prepared* prep = ng_query_take_prepared();
+    ng_cy_query cy;
+    ng_status s;
+    int with_handled = 0, mut = 0;
+    if (handled)
+        *handled = 0;
+    s = ng_query_execute_with((ng_graph*)g, q, out, &mut, &with_handled);
+    if (with_handled) {
+        if (handled)
+            *handled = 1;
+        return mut ? NG_PARSE_ERROR : s;
+    }
+    s = ng_cy_parse_query(q, &cy);
+    if (s != NG_OK) {
+        ng_cy_query_free(&cy);
+        return NG_OK;
+    }
+    if (handled)
+        *handled = 1;
+    s = ng_cy_execute_read_query(g, &cy, out);
+    if (prep && !prep->kind) {
+        prep->kind = 2;
+        prep->cy = cy;
+    } else {
+        ng_cy_query_free(&cy);
+    }
+    return s;
+}
 static ng_status ng_query_parse_write_node(const char** pp,
                                            char* var,
                                            size_t var_capacity,
@@ -12981,10 +16856,13 @@ static void ng_query_init_return_plan(ng_query_plan* ret, const ng_query_plan* s
 static ng_status ng_cy_parse_create_pattern(const char** pp, ng_cy_query* out) {
     const char* p = ng_skip_ws(*pp);
     ng_cy_match* m;
-    if (out->match_count >= NG_CY_MAX_MATCHES)
-        return NG_PARSE_ERROR;
+    if (!ng_cy_reserve(
+            out, (void**)&out->matches, &out->match_capacity, out->match_count, sizeof(*m)))
+        return NG_OOM;
     m = &out->matches[out->match_count];
     memset(m, 0, sizeof(*m));
+    if (!ng_cy_match_reserve(out, m))
+        return NG_OOM;
     if (ng_cy_parse_node(&p, out, &m->nodes[m->node_count++]) != NG_OK)
         return NG_PARSE_ERROR;
     for (;;) {
@@ -12993,6 +16871,8 @@ static ng_status ng_cy_parse_create_pattern(const char** pp, ng_cy_query* out) {
             break;
         if (m->rel_count >= NG_CY_MAX_RELS || m->node_count >= NG_CY_MAX_NODES)
             return NG_PARSE_ERROR;
+        if (!ng_cy_match_reserve(out, m))
+            return NG_OOM;
         if (ng_cy_parse_rel(&p, out, &m->rels[m->rel_count]) != NG_OK)
             return NG_PARSE_ERROR;
         if (m->rels[m->rel_count].dir == 0 || !m->rels[m->rel_count].type[0] ||
@@ -13099,40 +16979,544 @@ static ng_status ng_cy_create_relationship_from_pattern(ng_graph* g,
         if (s != NG_OK)
             return s;
     }
-    if (pat->var_index >= 0 && !ng_cy_bind(row, pat->var_index, 2, id))
-        return NG_PARSE_ERROR;
+    if (pat->var_index >= 0 && !ng_cy_bind(row, pat->var_index, 2, id))
+        return NG_PARSE_ERROR;
+    return NG_OK;
+}
+static ng_status
+ng_cy_execute_create_match(ng_graph* g, ng_cy_query* q, const ng_cy_match* m, ng_cy_row* row) {
+    ng_node_id node_ids[NG_CY_MAX_NODES];
+    ng_status s;
+    size_t i;
+    memset(node_ids, 0, sizeof(node_ids));
+    for (i = 0; i < m->node_count; i++) {
+        s = ng_cy_create_node_from_pattern(g, q, &m->nodes[i], row, &node_ids[i]);
+        if (s != NG_OK)
+            return s;
+    }
+    for (i = 0; i < m->rel_count; i++) {
+        s = ng_cy_create_relationship_from_pattern(
+            g, q, &m->rels[i], node_ids[i], node_ids[i + 1], row);
+        if (s != NG_OK)
+            return s;
+    }
+    return NG_OK;
+}
+typedef struct {
+    ng_symbol_id label, keys[NG_QUERY_MAX_PROPS];
+    int ready;
+    ng_cy_hash_table index;
+    int indexed;
+} ng_cy_batch_node;
+typedef struct {
+    ng_symbol_id type, keys[NG_QUERY_MAX_PROPS];
+    int ready;
+} ng_cy_batch_rel;
+typedef struct {
+    ng_graph* g;
+    ng_cy_query* q;
+    size_t before, rows;
+    int changed;
+    unsigned char merge[NG_CY_MAX_MATCHES];
+    ng_cy_value_set* unique;
+    unsigned char* unique_ready;
+    ng_cy_batch_node nodes[NG_CY_MAX_MATCHES][NG_CY_MAX_NODES];
+    ng_cy_batch_rel rels[NG_CY_MAX_MATCHES][NG_CY_MAX_RELS];
+    ng_cy_hash_table rel_index;
+    int rel_indexed;
+} ng_cy_batch;
+static ng_status ng_cy_batch_symbols(ng_graph* g,
+                                     const char* name,
+                                     const ng_query_prop* props,
+                                     size_t count,
+                                     ng_symbol_id* id,
+                                     ng_symbol_id* keys) {
+    size_t i;
+    *id = 0;
+    if (name[0] && ng_symbol(g, name, id) != NG_OK)
+        return NG_OOM;
+    for (i = 0; i < count; i++)
+        if (ng_symbol(g, props[i].key, &keys[i]) != NG_OK)
+            return NG_OOM;
+    return NG_OK;
+}
+static ng_status ng_cy_batch_values(const ng_cy_batch* b,
+                                    const ng_query_prop* props,
+                                    const int* scalars,
+                                    const ng_symbol_id* keys,
+                                    size_t count,
+                                    const ng_cy_row* row,
+                                    ng_property* out) {
+    size_t i;
+    ng_status s;
+    for (i = 0; i < count; i++) {
+        out[i].key = keys[i];
+        if (scalars[i] >= 0)
+            s = ng_cy_eval_scalar(b->g, b->q, row, scalars[i], &out[i].value);
+        else
+            s = ng_query_resolve_value(&props[i].value, &out[i].value);
+        if (s != NG_OK)
+            return s;
+    }
+    return NG_OK;
+}
+static int ng_cy_batch_node_hash(const ng_cy_batch_node* bn,
+                                 size_t key_count,
+                                 const node_i* n,
+                                 uint32_t* h) {
+    size_t i;
+    if (!ng_query_label_matches(n, bn->label))
+        return 0;
+    *h = 2166136261u;
+    for (i = 0; i < key_count; i++) {
+        const prop* p = findprop(n->p, n->np, bn->keys[i]);
+        if (!p)
+            return 0;
+        *h = ng_value_hash_from(*h, &p->v);
+    }
+    return 1;
+}
+static ng_status ng_cy_batch_index_add(ng_cy_hash_table* t, uint32_t h, size_t entry) {
+    size_t pos;
+    ng_status s = ng_cy_hash_reserve(t);
+    if (s != NG_OK)
+        return s;
+    for (pos = h & (t->cap - 1); t->slots[pos].entry; pos = (pos + 1) & (t->cap - 1))
+        ;
+    ng_cy_hash_insert(t, pos, h, entry);
+    return NG_OK;
+}
+static uint32_t ng_cy_batch_rel_hash(ng_node_id src, ng_node_id dst, ng_symbol_id type) {
+    uint32_t h = hash32(2166136261u, &src, sizeof(src));
+    h = hash32(h, &dst, sizeof(dst));
+    return hash32(h, &type, sizeof(type));
+}
+static ng_status ng_cy_batch_note_node(ng_cy_batch* b, size_t pos) {
+    const node_i* n = &b->g->no[pos];
+    size_t i, j;
+    uint32_t h;
+    ng_status s;
+    for (i = 0; i < b->g->nc; i++) {
+        const prop* p;
+        int added;
+        if (!b->unique_ready[i] || !ng_node_matches_label(n, b->g->co[i].label))
+            continue;
+        p = findprop(n->p, n->np, b->g->co[i].key);
+        if (p && p->v.type != NG_VALUE_NULL &&
+            (s = ng_cy_value_set_add(&b->unique[i], &p->v, &added)) != NG_OK)
+            return s;
+    }
+    for (i = b->before; i < b->q->match_count; i++)
+        for (j = 0; j < b->q->matches[i].node_count; j++) {
+            ng_cy_batch_node* bn = &b->nodes[i - b->before][j];
+            if (bn->indexed &&
+                ng_cy_batch_node_hash(bn, b->q->matches[i].nodes[j].prop_count, n, &h) &&
+                (s = ng_cy_batch_index_add(&bn->index, h, pos)) != NG_OK)
+                return s;
+        }
+    return NG_OK;
+}
+static ng_status ng_cy_batch_unique(ng_cy_batch* b,
+                                    ng_symbol_id label,
+                                    const ng_property* props,
+                                    size_t count) {
+    ng_graph* g = b->g;
+    size_t i, j;
+    ng_status s;
+    for (i = 0; i < g->nc; i++) {
+        const ng_value* v;
+        int added;
+        if (g->co[i].kind != NG_NODE_CONSTRAINT_UNIQUE_PROPERTY ||
+            !ng_label_list_matches(&label, label ? 1 : 0, g->co[i].label))
+            continue;
+        v = ng_property_list_find(props, count, g->co[i].key);
+        if (!v || v->type == NG_VALUE_NULL)
+            continue;
+        if (!b->unique_ready[i]) {
+            for (j = 0; j < g->nn; j++) {
+                const prop* p;
+                if (!ng_node_matches_label(&g->no[j], g->co[i].label))
+                    continue;
+                p = findprop(g->no[j].p, g->no[j].np, g->co[i].key);
+                if (p && p->v.type != NG_VALUE_NULL &&
+                    (s = ng_cy_value_set_add(&b->unique[i], &p->v, &added)) != NG_OK)
+                    return s;
+            }
+            b->unique_ready[i] = 1;
+        }
+        s = ng_cy_value_set_add(&b->unique[i], v, &added);
+        if (s != NG_OK)
+            return s;
+        if (!added)
+            return NG_EXISTS;
+    }
+    return NG_OK;
+}
+static ng_status ng_cy_batch_create_node(ng_cy_batch* b,
+                                         ng_symbol_id label,
+                                         const ng_property* props,
+                                         size_t count,
+                                         ng_node_id* id) {
+    ng_graph* g = b->g;
+    node_i* n;
+    size_t i;
+    ng_status s =
+        ng_node_create_properties_check(g, label ? &label : NULL, label ? 1 : 0, props, count, 0);
+    if (s == NG_OK)
+        s = ng_cy_batch_unique(b, label, props, count);
+    if (s == NG_OK)
+        s = ng_node_create(g, label ? &label : NULL, label ? 1 : 0, id);
+    if (s != NG_OK)
+        return s;
+    /* The checks above cover everything ng_node_set() validates, with unique constraints answered
+     * by the batch's value sets instead of a node scan per property. */
+    n = &g->no[g->nn - 1];
+    for (i = 0; i < count && s == NG_OK; i++)
+        s = setprop(&n->p, &n->np, &n->cap, props[i].key, &props[i].value);
+    ng_count_postings_note(g, n, 0, 1);
+    if (s != NG_OK)
+        return s;
+    if (count)
+        ng_graph_bump(g);
+    return ng_cy_batch_note_node(b, g->nn - 1);
+}
+static ng_status ng_cy_batch_node_pattern(ng_cy_batch* b,
+                                          ng_cy_batch_node* bn,
+                                          const ng_cy_node_pat* pat,
+                                          int merge,
+                                          ng_cy_row* row,
+                                          ng_node_id* id) {
+    ng_graph* g = b->g;
+    ng_property props[NG_QUERY_MAX_PROPS];
+    size_t i, pos, best = SIZE_MAX;
+    uint32_t h = 2166136261u;
+    ng_status s;
+    if (pat->var_index >= 0 && row->values[pat->var_index].kind) {
+        if (merge)
+            return ng_cy_merge_node_from_pattern(g, b->q, pat, row, id, &b->changed);
+        if (row->values[pat->var_index].kind != 1)
+            return NG_PARSE_ERROR;
+        *id = row->values[pat->var_index].id;
+        return NG_OK;
+    }
+    if (merge && !pat->label[0] && !pat->prop_count)
+        return NG_PARSE_ERROR;
+    if (!bn->ready) {
+        s = ng_cy_batch_symbols(g, pat->label, pat->props, pat->prop_count, &bn->label, bn->keys);
+        if (s != NG_OK)
+            return s;
+        bn->ready = 1;
+    }
+    s = ng_cy_batch_values(b, pat->props, pat->prop_scalars, bn->keys, pat->prop_count, row, props);
+    if (s != NG_OK)
+        return s;
+    if (merge) {
+        for (i = 0; i < pat->prop_count; i++)
+            h = ng_value_hash_from(h, &props[i].value);
+        if (!bn->indexed) {
+            uint32_t nh;
+            for (pos = 0; pos < g->nn; pos++)
+                if (ng_cy_batch_node_hash(bn, pat->prop_count, &g->no[pos], &nh) &&
+                    (s = ng_cy_batch_index_add(&bn->index, nh, pos)) != NG_OK)
+                    return s;
+            bn->indexed = 1;
+        }
+        if (bn->index.cap)
+            for (pos = h & (bn->index.cap - 1); bn->index.slots[pos].entry;
+                 pos = (pos + 1) & (bn->index.cap - 1)) {
+                size_t at = bn->index.slots[pos].entry - 1;
+                if (bn->index.slots[pos].hash == h && at < best &&
+                    ng_query_node_matches_props(&g->no[at], props, pat->prop_count))
+                    best = at;
+            }
+        if (ng_query_active_profile)
+            ng_query_active_profile->index_hits++;
+    }
+    if (best != SIZE_MAX)
+        *id = g->no[best].id;
+    else {
+        s = ng_cy_batch_create_node(b, bn->label, props, pat->prop_count, id);
+        if (s != NG_OK)
+            return s;
+        b->changed = 1;
+    }
+    if (pat->var_index >= 0 && !ng_cy_bind(row, pat->var_index, 1, *id))
+        return NG_PARSE_ERROR;
+    return NG_OK;
+}
+static ng_status ng_cy_batch_rel_pattern(ng_cy_batch* b,
+                                         ng_cy_batch_rel* br,
+                                         const ng_cy_rel_pat* pat,
+                                         int merge,
+                                         ng_node_id left,
+                                         ng_node_id right,
+                                         ng_cy_row* row) {
+    ng_graph* g = b->g;
+    ng_property props[NG_QUERY_MAX_PROPS];
+    ng_node_id src = pat->dir < 0 ? right : left, dst = pat->dir < 0 ? left : right;
+    ng_relationship_id id;
+    size_t i, pos, best = SIZE_MAX;
+    uint32_t h;
+    rel_i* r;
+    ng_status s;
+    if (pat->dir == 0 || !pat->type[0] || pat->has_var_length)
+        return NG_PARSE_ERROR;
+    if (pat->var_index >= 0 && row->values[pat->var_index].kind) {
+        if (merge)
+            return ng_cy_merge_relationship_from_pattern(
+                g, b->q, pat, left, right, row, &b->changed);
+        return NG_PARSE_ERROR;
+    }
+    if (!br->ready) {
+        s = ng_cy_batch_symbols(g, pat->type, pat->props, pat->prop_count, &br->type, br->keys);
+        if (s != NG_OK)
+            return s;
+        br->ready = 1;
+    }
+    s = ng_cy_batch_values(b, pat->props, pat->prop_scalars, br->keys, pat->prop_count, row, props);
+    if (s != NG_OK)
+        return s;
+    h = ng_cy_batch_rel_hash(src, dst, br->type);
+    if (merge) {
+        if (!b->rel_indexed) {
+            for (i = 0; i < g->nr; i++) {
+                r = &g->re[i];
+                s = ng_cy_batch_index_add(
+                    &b->rel_index, ng_cy_batch_rel_hash(r->src, r->dst, r->type), i);
+                if (s != NG_OK)
+                    return s;
+            }
+            b->rel_indexed = 1;
+        }
+        if (b->rel_index.cap)
+            for (pos = h & (b->rel_index.cap - 1); b->rel_index.slots[pos].entry;
+                 pos = (pos + 1) & (b->rel_index.cap - 1)) {
+                size_t at = b->rel_index.slots[pos].entry - 1;
+                r = &g->re[at];
+                if (b->rel_index.slots[pos].hash == h && at < best && r->src == src &&
+                    r->dst == dst && r->type == br->type &&
+                    ng_query_rel_matches_props(r, props, pat->prop_count))
+                    best = at;
+            }
+    }
+    if (best != SIZE_MAX)
+        id = g->re[best].id;
+    else {
+        /* Same value check as ng_relationship_set(), done before creating so a bad value leaves
+         * no relationship behind; the new relationship is the last one, so no id search. */
+        for (i = 0; i < pat->prop_count; i++)
+            if (!ng_valid_value(&props[i].value))
+                return NG_INVALID_ARGUMENT;
+        s = ng_relationship_create(g, src, br->type, dst, &id);
+        if (s != NG_OK)
+            return s;
+        r = &g->re[g->nr - 1];
+        for (i = 0; i < pat->prop_count; i++) {
+            s = setprop(&r->p, &r->np, &r->cap, props[i].key, &props[i].value);
+            if (s != NG_OK)
+                return s;
+        }
+        if (pat->prop_count)
+            ng_graph_bump(g);
+        if (b->rel_indexed && (s = ng_cy_batch_index_add(&b->rel_index, h, g->nr - 1)) != NG_OK)
+            return s;
+        b->changed = 1;
+    }
+    if (pat->var_index >= 0 && !ng_cy_bind(row, pat->var_index, 2, id))
+        return NG_PARSE_ERROR;
+    return NG_OK;
+}
+static ng_status ng_cy_batch_row(void* context, ng_cy_row* row) {
+    ng_cy_batch* b = (ng_cy_batch*)context;
+    ng_node_id ids[NG_CY_MAX_NODES];
+    size_t i, j;
+    ng_status s;
+    for (i = b->before; i < b->q->match_count; i++) {
+        const ng_cy_match* m = &b->q->matches[i];
+        int merge = b->merge[i - b->before];
+        for (j = 0; j < m->node_count; j++) {
+            s = ng_cy_batch_node_pattern(
+                b, &b->nodes[i - b->before][j], &m->nodes[j], merge, row, &ids[j]);
+            if (s != NG_OK)
+                return s;
+        }
+        for (j = 0; j < m->rel_count; j++) {
+            s = ng_cy_batch_rel_pattern(
+                b, &b->rels[i - b->before][j], &m->rels[j], merge, ids[j], ids[j + 1], row);
+            if (s != NG_OK)
+                return s;
+        }
+    }
+    b->rows++;
+    return NG_OK;
+}
+static ng_status ng_cy_batch_reserve(ng_cy_batch* b,
+                                     const ng_cy_row* rows,
+                                     size_t row_count,
+                                     int scalar) {
+    ng_graph* g = b->g;
+    const ng_cy_scalar* src = &b->q->scalars[scalar];
+    size_t items = 0, nodes = 0, rels = 0, i, j;
+    for (i = 0; i < row_count; i++) {
+        ng_value list;
+        if (src->kind == 7)
+            items += (size_t)src->list_count;
+        else if (ng_cy_eval_scalar(g, b->q, &rows[i], scalar, &list) == NG_OK &&
+                 list.type == NG_VALUE_LIST && list.as.list)
+            items += list.as.list->count;
+    }
+    for (i = b->before; i < b->q->match_count; i++) {
+        const ng_cy_match* m = &b->q->matches[i];
+        if (b->merge[i - b->before])
+            continue;
+        for (j = 0; j < m->node_count; j++)
+            if (m->nodes[j].var_index < 0 || !rows[0].values[m->nodes[j].var_index].kind)
+                nodes++;
+        rels += m->rel_count;
+    }
+    if (!items || !row_count)
+        return NG_OK;
+    if ((nodes && items > (SIZE_MAX - g->nn) / nodes) ||
+        (rels && items > (SIZE_MAX - g->nr) / rels))
+        return NG_LIMIT;
+    if (nodes && !grow((void**)&g->no, &g->cn, g->nn + items * nodes, sizeof(*g->no)))
+        return NG_OOM;
+    if (rels && !grow((void**)&g->re, &g->cr, g->nr + items * rels, sizeof(*g->re)))
+        return NG_OOM;
     return NG_OK;
 }
-static ng_status
-ng_cy_execute_create_match(ng_graph* g, ng_cy_query* q, const ng_cy_match* m, ng_cy_row* row) {
-    ng_node_id node_ids[NG_CY_MAX_NODES];
+static void ng_cy_batch_free(ng_cy_batch* b) {
+    size_t i, j;
+    for (i = 0; b->unique && i < b->g->nc; i++)
+        ng_cy_value_set_free(&b->unique[i]);
+    free(b->unique);
+    free(b->unique_ready);
+    for (i = 0; i < NG_CY_MAX_MATCHES; i++)
+        for (j = 0; j < NG_CY_MAX_NODES; j++)
+            ng_cy_hash_free(&b->nodes[i][j].index);
+    ng_cy_hash_free(&b->rel_index);
+}
+static ng_status ng_cy_write_rows(ng_graph* g,
+                                  ng_cy_query* q,
+                                  ng_cy_row* rows,
+                                  size_t row_count,
+                                  size_t start,
+                                  size_t end,
+                                  int merge,
+                                  int actions,
+                                  int* changed) {
+    size_t i, j;
     ng_status s;
-    size_t i;
-    memset(node_ids, 0, sizeof(node_ids));
-    for (i = 0; i < m->node_count; i++) {
-        s = ng_cy_create_node_from_pattern(g, q, &m->nodes[i], row, &node_ids[i]);
+    for (i = 0; i < row_count; i++)
+        for (j = start; j < end; j++) {
+            int created = 0;
+            if (!merge) {
+                s = ng_cy_execute_create_match(g, q, &q->matches[j], &rows[i]);
+                if (s != NG_OK)
+                    return s;
+                continue;
+            }
+            s = ng_cy_execute_merge_match(g, q, &q->matches[j], &rows[i], changed, &created);
+            if (s == NG_OK && actions)
+                s = ng_cy_apply_merge_action(
+                    g, q, &rows[i], created ? q->merge_on_create : q->merge_on_match, changed);
+            if (s != NG_OK)
+                return s;
+        }
+    return NG_OK;
+}
+static ng_status ng_cy_apply_unwind_write(ng_graph* g,
+                                          ng_cy_query* q,
+                                          ng_cy_row** rows,
+                                          size_t* row_count,
+                                          const char** pp,
+                                          const char** op,
+                                          size_t* streamed,
+                                          int* changed) {
+    const char* p = *pp;
+    size_t ends[NG_CY_MAX_MATCHES];
+    unsigned char merges[NG_CY_MAX_MATCHES];
+    size_t before, clauses = 0, i;
+    int scalar, vi, actions = 0, any_merge = 0;
+    ng_cy_batch* b;
+    ng_status s = ng_cy_parse_unwind(g, q, &p, &scalar, &vi);
+    if (s != NG_OK)
+        return s;
+    before = q->match_count;
+    while (!actions && clauses < NG_CY_MAX_MATCHES &&
+           (ng_cy_clause_starts(p, "MERGE") || ng_cy_clause_starts(p, "CREATE"))) {
+        int merge = ng_cy_clause_starts(p, "MERGE");
+        s = merge ? ng_cy_parse_merge_clause(&p, q) : ng_cy_parse_create_clause(&p, q);
         if (s != NG_OK)
             return s;
+        merges[clauses] = (unsigned char)merge;
+        ends[clauses++] = q->match_count;
+        actions = merge && (q->merge_on_create[0] || q->merge_on_match[0]);
+        any_merge |= merge;
+        if (!merge)
+            *changed = 1;
+        p = ng_skip_ws(p);
     }
-    for (i = 0; i < m->rel_count; i++) {
-        s = ng_cy_create_relationship_from_pattern(
-            g, q, &m->rels[i], node_ids[i], node_ids[i + 1], row);
-        if (s != NG_OK)
-            return s;
+    if (!clauses) {
+        s = ng_cy_unwind_rows(g, q, rows, row_count, scalar, vi);
+        if (s == NG_OK)
+            *pp = p;
+        return s;
     }
-    return NG_OK;
+    *op = any_merge ? "UnwindMerge" : "UnwindCreate";
+    if (*p || actions || q->match_count - before > NG_CY_MAX_MATCHES) {
+        s = ng_cy_unwind_rows(g, q, rows, row_count, scalar, vi);
+        for (i = 0; s == NG_OK && i < clauses; i++)
+            s = ng_cy_write_rows(g,
+                                 q,
+                                 *rows,
+                                 *row_count,
+                                 i ? ends[i - 1] : before,
+                                 ends[i],
+                                 merges[i],
+                                 i + 1 == clauses && actions,
+                                 changed);
+        if (s == NG_OK)
+            *pp = p;
+        return s;
+    }
+    b = (ng_cy_batch*)calloc(1, sizeof(*b));
+    if (!b)
+        return NG_OOM;
+    b->g = g;
+    b->q = q;
+    b->before = before;
+    for (i = 0; i < clauses; i++)
+        memset(b->merge + (i ? ends[i - 1] : before) - before,
+               merges[i],
+               ends[i] - (i ? ends[i - 1] : before));
+    if (g->nc) {
+        b->unique = (ng_cy_value_set*)calloc(g->nc, sizeof(*b->unique));
+        b->unique_ready = (unsigned char*)calloc(g->nc, 1);
+        if (!b->unique || !b->unique_ready)
+            s = NG_OOM;
+    }
+    if (s == NG_OK)
+        s = ng_cy_batch_reserve(b, *rows, *row_count, scalar);
+    for (i = 0; s == NG_OK && i < *row_count; i++)
+        s = ng_cy_unwind_row(g, q, &(*rows)[i], scalar, vi, ng_cy_batch_row, b);
+    if (s == NG_OK && b->changed)
+        *changed = 1;
+    *streamed = b->rows;
+    ng_cy_batch_free(b);
+    free(b);
+    if (s == NG_OK)
+        *pp = p;
+    return s;
 }
-static ng_status ng_query_execute_create(ng_graph* g, const char* q, FILE* out, int* mutated) {
-    ng_cy_query cy;
+static ng_status
+ng_cy_execute_create_query(ng_graph* g, ng_cy_query* cy, FILE* out, int* mutated) {
     ng_cy_row row;
     ng_status s;
     size_t i;
-    cy.create_mode = 1;
-    if (ng_cy_parse_create_query(q, &cy) != NG_OK)
-        return NG_PARSE_ERROR;
     memset(&row, 0, sizeof(row));
-    for (i = 0; i < cy.match_count; i++) {
-        s = ng_cy_execute_create_match(g, &cy, &cy.matches[i], &row);
+    for (i = 0; i < cy->match_count; i++) {
+        s = ng_cy_execute_create_match(g, cy, &cy->matches[i], &row);
         if (s != NG_OK)
             return s;
     }
@@ -13142,12 +17526,12 @@ static ng_status ng_query_execute_create(ng_graph* g, const char* q, FILE* out,
         size_t item_count = 0;
         memset(&projected, 0, sizeof(projected));
         s = ng_cy_project_rows(
-            g, &cy, &row, 1, cy.returns, cy.return_count, 0, 1, &items, &item_count);
+            g, cy, &row, 1, cy->returns, cy->return_count, 0, 1, &items, &item_count);
         if (s == NG_OK) {
             if (item_count)
                 projected = items[0];
             s = ng_cy_capture_schema(
-                &cy, cy.returns, cy.return_count, item_count ? &projected : NULL, item_count);
+                cy, cy->returns, cy->return_count, item_count ? &projected : NULL, item_count);
         }
         free(items);
         if (s != NG_OK)
@@ -13155,20 +17539,37 @@ static ng_status ng_query_execute_create(ng_graph* g, const char* q, FILE* out,
     }
     if (mutated)
         *mutated = 1;
-    for (i = 0; i < cy.return_count; i++) {
+    for (i = 0; i < cy->return_count; i++) {
         ng_value value;
         if (i && fputc('\t', out) == EOF)
             return NG_IO_ERROR;
-        s = ng_cy_eval_scalar(g, &cy, &row, cy.returns[i].scalar_index, &value);
+        s = ng_cy_eval_scalar(g, cy, &row, cy->returns[i].scalar_index, &value);
         if (s != NG_OK)
             return s;
         if (!ng_print_value(out, &value))
             return NG_IO_ERROR;
     }
-    if (cy.return_count && fputc('\n', out) == EOF)
+    if (cy->return_count && fputc('\n', out) == EOF)
         return NG_IO_ERROR;
     return NG_OK;
 }
+static ng_status ng_query_execute_create(ng_graph* g, const char* q, FILE* out, int* mutated) {
+    ng_cy_prepared* prep = ng_query_take_prepared();
+    ng_cy_query cy;
+    ng_status s = ng_cy_parse_create_query(q, &cy);
+    if (s != NG_OK) {
+        ng_cy_query_free(&cy);
+        return NG_PARSE_ERROR;
+    }
+    s = ng_cy_execute_create_query(g, &cy, out, mutated);
+    if (prep && !prep->kind) {
+        prep->kind = 1;
+        prep->cy = cy;
+    } else {
+        ng_cy_query_free(&cy);
+    }
+    return s;
+}
 static ng_status ng_query_parse_match_write(const char* q, ng_query_plan* plan, const char** tail) {
     const char* p;
     memset(plan, 0, sizeof(*plan));
@@ -13817,6 +18218,7 @@ static ng_status ng_query_execute_batch(ng_graph* g, const char* query, FILE* ou
 static ng_status ng_query_execute_impl(ng_graph* g, const char* q, FILE* out, int* mutated);
 static ng_status ng_query_execute_impl(ng_graph* g, const char* q, FILE* out, int* mutated) {
     const char* p = ng_skip_ws(q);
+    ng_cy_prepared* prep = ng_query_take_prepared();
     int handled = 0;
     ng_status ws;
     if (!g || !q || !out)
@@ -13830,8 +18232,10 @@ static ng_status ng_query_execute_impl(ng_graph* g, const char* q, FILE* out, in
     ws = ng_query_execute_with(g, p, out, mutated, &handled);
     if (handled)
         return ws;
-    if (!strncmp(p, "CREATE", 6) && isspace((unsigned char)p[6]))
+    if (!strncmp(p, "CREATE", 6) && isspace((unsigned char)p[6])) {
+        ng_query_active_prepared = prep;
         return ng_query_execute_create(g, p, out, mutated);
+    }
     if (!strncmp(p, "MERGE", 5) && isspace((unsigned char)p[5]))
         return ng_query_execute_merge(g, p, out, mutated);
     if (!strncmp(p, "MATCH", 5) && isspace((unsigned char)p[5])) {
@@ -13846,6 +18250,7 @@ static ng_status ng_query_execute_impl(ng_graph* g, const char* q, FILE* out, in
             return ng_query_execute_create_relationship(g, p, out, mutated);
         if (s == NG_OK && (!strncmp(tail, "MERGE", 5) && isspace((unsigned char)tail[5])))
             return ng_query_execute_merge_relationship(g, p, out, mutated);
+        ng_query_active_prepared = prep;
         return ng_query_print_active(g, p, out);
     }
     return NG_PARSE_ERROR;
@@ -14041,74 +18446,77 @@ static ng_status ng_query_execute_union(ng_graph* g, const char* query, FILE* ou
         free(branches[i]);
     return s;
 }
+static int ng_query_append_text(char** text, size_t* length, size_t* cap, const char* s, size_t n) {
+    if (*length + n + 1 > *cap && !grow((void**)text, cap, *length + n + 1, 1))
+        return 0;
+    memcpy(*text + *length, s, n);
+    *length += n;
+    (*text)[*length] = 0;
+    return 1;
+}
 static ng_status ng_query_execute_batch(ng_graph* g, const char* query, FILE* out, int* mutated) {
-    char* statements[16] = {0};
-    const char* start = query;
+    char* statement = 0;
+    const char* segment = query;
     const char* p = query;
-    size_t count = 0, i;
+    size_t length = 0, cap = 0, count = 0;
     int did_mutate = 0;
     ng_status s = NG_OK;
-    while (*p) {
+    for (;;) {
         if (*p == '"') {
             p++;
             while (*p && *p != '"')
                 p++;
-            if (!*p)
-                return NG_PARSE_ERROR;
+            if (!*p) {
+                s = NG_PARSE_ERROR;
+                break;
+            }
             p++;
             continue;
         }
-        if (*p == ';') {
-            const char* end = p;
-            size_t length;
-            while (end > start && isspace((unsigned char)end[-1]))
-                end--;
-            length = (size_t)(end - start);
-            if (!length || count >= 16)
-                s = length ? NG_LIMIT : NG_PARSE_ERROR;
-            else {
-                statements[count] = (char*)malloc(length + 1);
-                if (!statements[count])
-                    s = NG_OOM;
-                else {
-                    memcpy(statements[count], start, length);
-                    statements[count][length] = 0;
-                    count++;
-                }
-            }
-            if (s != NG_OK)
+        if (p[0] == '/' && p[1] == '/') {
+            if (!ng_query_append_text(&statement, &length, &cap, segment, (size_t)(p - segment))) {
+                s = NG_OOM;
                 break;
-            start = p + 1;
+            }
+            while (*p && *p != '\n')
+                p++;
+            segment = p;
+            continue;
         }
-        p++;
-    }
-    if (s == NG_OK) {
-        const char* end = p;
-        size_t length;
-        while (end > start && isspace((unsigned char)end[-1]))
-            end--;
-        length = (size_t)(end - start);
-        if (!length || count >= 16)
-            s = length ? NG_LIMIT : NG_PARSE_ERROR;
-        else {
-            statements[count] = (char*)malloc(length + 1);
-            if (!statements[count])
+        if (*p == ';' || !*p) {
+            char* text;
+            size_t n;
+            int statement_mutated = 0;
+            if (!ng_query_append_text(&statement, &length, &cap, segment, (size_t)(p - segment))) {
                 s = NG_OOM;
-            else {
-                memcpy(statements[count], start, length);
-                statements[count][length] = 0;
-                count++;
+                break;
             }
+            text = statement;
+            n = length;
+            while (n && isspace((unsigned char)*text)) {
+                text++;
+                n--;
+            }
+            while (n && isspace((unsigned char)text[n - 1]))
+                n--;
+            text[n] = 0;
+            if (!n) {
+                if (*p || !count)
+                    s = NG_PARSE_ERROR;
+                break;
+            }
+            s = ng_query_execute_impl(g, text, out, &statement_mutated);
+            if (statement_mutated)
+                did_mutate = 1;
+            if (s != NG_OK || !*p)
+                break;
+            count++;
+            length = 0;
+            segment = p + 1;
         }
+        p++;
     }
-    for (i = 0; s == NG_OK && i < count; i++) {
-        int statement_mutated = 0;
-        s = ng_query_execute_impl(g, statements[i], out, &statement_mutated);
-        if (statement_mutated)
-            did_mutate = 1;
-    }
-    for (i = 0; i < count; i++)
-        free(statements[i]);
+    free(statement);
     if (mutated)
         *mutated = did_mutate;
     return s;
@@ -14127,7 +18535,232 @@ static ng_status ng_query_copy_output(FILE* src, FILE* dst) {
         return NG_IO_ERROR;
     return NG_OK;
 }
-static ng_status ng_query_execute_active(ng_graph* g, const char* q, FILE* out, int* mutated) {
+/* Runs a query parsed by an earlier row against the current parameters. Per-row allocations such
+ * as compiled WHERE programs are released afterwards, so the arena stays at its parsed size. */
+static ng_status
+ng_cy_execute_prepared(ng_graph* g, ng_cy_prepared* prep, FILE* out, int* mutated) {
+    ng_cy_block* top = prep->cy.arena;
+    size_t used = top ? top->used : 0;
+    ng_status s;
+    if (mutated)
+        *mutated = 0;
+    if (prep->kind == 1)
+        s = ng_cy_execute_create_query(g, &prep->cy, out, mutated);
+    else
+        s = ng_cy_execute_read_query(g, &prep->cy, out);
+    while (prep->cy.arena != top) {
+        ng_cy_block* next = prep->cy.arena->next;
+        free(prep->cy.arena);
+        prep->cy.arena = next;
+    }
+    if (top)
+        top->used = used;
+    return s;
+}
+static ng_status ng_query_execute_rows(ng_graph* g,
+                                       const char* q,
+                                       const ng_parameter* rows,
+                                       size_t parameter_count,
+                                       size_t row_count,
+                                       FILE* out,
+                                       int* mutated) {
+    ng_cy_prepared prep;
+    size_t r;
+    ng_status s = NG_OK, pattern_status = ng_cy_pattern_status;
+    memset(&prep, 0, sizeof(prep));
+    for (r = 0; s == NG_OK && r < row_count; r++) {
+        int row_mutated = 0;
+        ng_query_parameters = rows ? rows + r * parameter_count : NULL;
+        ng_query_parameter_count = parameter_count;
+        ng_query_parameter_error = 0;
+        ng_cy_pattern_status = NG_OK;
+        if (prep.kind) {
+            s = ng_cy_execute_prepared(g, &prep, out, &row_mutated);
+        } else {
+            ng_query_active_prepared = row_count > 1 ? &prep : NULL;
+            s = ng_query_execute_impl(g, q, out, &row_mutated);
+            ng_query_active_prepared = NULL;
+        }
+        if (s == NG_OK && ng_query_parameter_error)
+            s = NG_NOT_FOUND;
+        if (s == NG_OK)
+            s = ng_cy_pattern_status;
+        if (row_mutated && mutated)
+            *mutated = 1;
+    }
+    ng_cy_query_free(&prep.cy);
+    ng_cy_pattern_status = pattern_status;
+    return s;
+}
+static void ng_query_cache_entry_free(query_cache_entry_i* e) {
+    size_t i;
+    free(e->query);
+    for (i = 0; i < e->parameter_count; i++) {
+        free((char*)e->parameters[i].name);
+        valfree(&e->parameters[i].value);
+    }
+    free(e->parameters);
+    free(e->output);
+    memset(e, 0, sizeof(*e));
+}
+static void ng_query_cache_evict(query_cache_i* c, size_t entries, size_t bytes) {
+    while (c->count && (c->count + entries > c->max_entries || c->bytes + bytes > c->max_bytes)) {
+        size_t i, oldest = 0;
+        for (i = 1; i < c->count; i++)
+            if (c->entries[i].used < c->entries[oldest].used)
+                oldest = i;
+        c->bytes -= c->entries[oldest].bytes;
+        ng_query_cache_entry_free(&c->entries[oldest]);
+        c->entries[oldest] = c->entries[--c->count];
+    }
+}
+static void ng_query_cache_clear(query_cache_i* c) {
+    while (c->count)
+        ng_query_cache_entry_free(&c->entries[--c->count]);
+    c->bytes = 0;
+}
+static void ng_query_cache_free(query_cache_i* c) {
+    if (!c)
+        return;
+    ng_query_cache_clear(c);
+    free(c->entries);
+    free(c);
+}
+static uint32_t ng_query_cache_hash(const char* q, const ng_parameter* p, size_t n) {
+    uint32_t h = hash32(2166136261u, q, strlen(q));
+    size_t i;
+    for (i = 0; i < n; i++) {
+        h = hash32(h, p[i].name, strlen(p[i].name) + 1);
+        h = ng_value_hash_from(h, &p[i].value);
+    }
+    return h;
+}
+static int ng_query_cache_matches(
+    const query_cache_entry_i* e, uint32_t h, const char* q, const ng_parameter* p, size_t n) {
+    size_t i;
+    if (e->hash != h || e->parameter_count != n || strcmp(e->query, q))
+        return 0;
+    for (i = 0; i < n; i++)
+        if (strcmp(e->parameters[i].name, p[i].name) ||
+            !ng_value_equal(&e->parameters[i].value, &p[i].value))
+            return 0;
+    return 1;
+}
+static int ng_query_cacheable(const ng_graph* g, const char* q) {
+    const char* p;
+    if (!g->query_cache || ng_query_active_profile)
+        return 0;
+    if (g->procedure_count)
+        for (p = q; *p; p++)
+            if ((p == q || !ng_ident_char((unsigned char)p[-1])) && ng_cy_clause_starts(p, "CALL"))
+                return 0;
+    return 1;
+}
+static void ng_query_cache_store(query_cache_i* c,
+                                 uint32_t h,
+                                 const char* q,
+                                 const ng_parameter* p,
+                                 size_t n,
+                                 char* output,
+                                 size_t length) {
+    query_cache_entry_i e;
+    size_t i, bytes = sizeof(e) + strlen(q) + 1 + length + n * sizeof(*p);
+    memset(&e, 0, sizeof(e));
+    if (bytes > c->max_bytes) {
+        free(output);
+        return;
+    }
+    ng_query_cache_evict(c, 1, bytes);
+    e.hash = h;
+    e.output = output;
+    e.length = length;
+    e.bytes = bytes;
+    e.used = ++c->tick;
+    e.query = dupstr(q);
+    if (n)
+        e.parameters = (ng_parameter*)calloc(n, sizeof(*e.parameters));
+    if (!e.query || (n && !e.parameters) ||
+        !grow((void**)&c->entries, &c->capacity, c->count + 1, sizeof(*c->entries))) {
+        ng_query_cache_entry_free(&e);
+        return;
+    }
+    for (i = 0; i < n; i++, e.parameter_count++) {
+        e.parameters[i].name = dupstr(p[i].name);
+        if (!e.parameters[i].name || valcopy(&e.parameters[i].value, &p[i].value) != NG_OK) {
+            free((char*)e.parameters[i].name);
+            ng_query_cache_entry_free(&e);
+            return;
+        }
+    }
+    c->entries[c->count++] = e;
+    c->bytes += bytes;
+}
+static ng_status ng_query_cache_execute(ng_graph* g,
+                                        const char* q,
+                                        const ng_parameter* p,
+                                        size_t n,
+                                        FILE* out,
+                                        ng_query_cache_run run) {
+    query_cache_i* c = g->query_cache;
+    char* output = NULL;
+    long length;
+    FILE* buf;
+    uint32_t h;
+    size_t i;
+    ng_status s;
+    if (!ng_query_cacheable(g, q))
+        return run(g, q, p, n, out);
+    if (c->version != g->version) {
+        ng_query_cache_clear(c);
+        c->version = g->version;
+    }
+    h = ng_query_cache_hash(q, p, n);
+    for (i = 0; i < c->count; i++)
+        if (ng_query_cache_matches(&c->entries[i], h, q, p, n)) {
+            c->hits++;
+            c->entries[i].used = ++c->tick;
+            return fwrite(c->entries[i].output, 1, c->entries[i].length, out) ==
+                           c->entries[i].length
+                       ? NG_OK
+                       : NG_IO_ERROR;
+        }
+    c->misses++;
+    buf = tmpfile();
+    if (!buf)
+        return run(g, q, p, n, out);
+    s = run(g, q, p, n, buf);
+    if (s != NG_OK || g->version != c->version) {
+        ng_status copied = ng_query_copy_output(buf, out);
+        fclose(buf);
+        return s != NG_OK ? s : copied;
+    }
+    if (fflush(buf) != 0 || fseek(buf, 0, SEEK_END) != 0 || (length = ftell(buf)) < 0 ||
+        fseek(buf, 0, SEEK_SET) != 0)
+        s = NG_IO_ERROR;
+    else if (!(output = (char*)malloc((size_t)length + 1)))
+        s = NG_OOM;
+    else if (fread(output, 1, (size_t)length, buf) != (size_t)length)
+        s = NG_IO_ERROR;
+    else if (fwrite(output, 1, (size_t)length, out) != (size_t)length)
+        s = NG_IO_ERROR;
+    fclose(buf);
+    if (s == NG_OK)
+        ng_query_cache_store(c, h, q, p, n, output, (size_t)length);
+    else
+        free(output);
+    return s;
+}
+static ng_status
+ng_query_execute_read(ng_graph* g, const char* q, const ng_parameter* p, size_t n, FILE* out) {
+    return ng_query_execute_rows(g, q, p, n, 1, out, NULL);
+}
+static ng_status ng_query_execute_active(ng_graph* g,
+                                         const char* q,
+                                         const ng_parameter* rows,
+                                         size_t parameter_count,
+                                         size_t row_count,
+                                         FILE* out,
+                                         int* mutated) {
     const char* p = ng_skip_ws(q);
     ng_transaction* tx = NULL;
     ng_graph* tg;
@@ -14138,8 +18771,10 @@ static ng_status ng_query_execute_active(ng_graph* g, const char* q, FILE* out,
         return NG_INVALID_ARGUMENT;
     if (mutated)
         *mutated = 0;
+    if (!ng_query_is_write(p) && row_count == 1)
+        return ng_query_cache_execute(g, p, rows, parameter_count, out, ng_query_execute_read);
     if (!ng_query_is_write(p))
-        return ng_query_execute_impl(g, p, out, mutated);
+        return ng_query_execute_rows(g, p, rows, parameter_count, row_count, out, mutated);
     s = ng_transaction_begin(g, &tx);
     if (s != NG_OK)
         return s;
@@ -14153,7 +18788,7 @@ static ng_status ng_query_execute_active(ng_graph* g, const char* q, FILE* out,
         ng_transaction_rollback(tx);
         return NG_IO_ERROR;
     }
-    s = ng_query_execute_impl(tg, p, buf, &tx_mutated);
+    s = ng_query_execute_rows(tg, p, rows, parameter_count, row_count, buf, &tx_mutated);
     if (s == NG_OK)
         s = ng_transaction_commit(tx);
     else
@@ -14166,23 +18801,35 @@ static ng_status ng_query_execute_active(ng_graph* g, const char* q, FILE* out,
     fclose(buf);
     return s;
 }
+static const char* ng_query_profile_strip(const char* q) {
+    const char* p = ng_skip_ws(q);
+    if (!strncmp(p, "PROFILE", 7) && isspace((unsigned char)p[7]))
+        return ng_skip_ws(p + 7);
+    return NULL;
+}
+static ng_status ng_query_profile_run(ng_graph* g,
+                                      const char* q,
+                                      const ng_parameter* p,
+                                      size_t n,
+                                      FILE* out,
+                                      FILE* report,
+                                      const char* heading,
+                                      int* mutated);
 ng_status ng_query_execute_params(
     ng_graph* g, const char* q, const ng_parameter* p, size_t n, FILE* out, int* mutated) {
     const ng_parameter* oldp = ng_query_parameters;
     size_t oldn = ng_query_parameter_count;
     int olde = ng_query_parameter_error;
-    ng_status s = ng_query_parameters_valid(p, n);
+    ng_status s;
+    if (q && ng_query_profile_strip(q))
+        return ng_query_profile_run(g, q, p, n, out, out, "# profile\n", mutated);
+    s = ng_query_parameters_valid(p, n);
     if (s != NG_OK)
         return s;
     s = ng_query_parameters_cover_query(q, p, n);
     if (s != NG_OK)
         return s;
-    ng_query_parameters = p;
-    ng_query_parameter_count = n;
-    ng_query_parameter_error = 0;
-    s = ng_query_execute_active(g, q, out, mutated);
-    if (s == NG_OK && ng_query_parameter_error)
-        s = NG_NOT_FOUND;
+    s = ng_query_execute_active(g, q, p, n, 1, out, mutated);
     ng_query_parameters = oldp;
     ng_query_parameter_count = oldn;
     ng_query_parameter_error = olde;
@@ -14191,6 +18838,169 @@ ng_status ng_query_execute_params(
 ng_status ng_query_execute(ng_graph* g, const char* q, FILE* out, int* mutated) {
     return ng_query_execute_params(g, q, NULL, 0, out, mutated);
 }
+uint64_t ng_graph_version(const ng_graph* g) {
+    return g ? g->version : 0;
+}
+ng_status ng_query_cache_configure(ng_graph* g, size_t max_entries, size_t max_bytes) {
+    query_cache_i* c;
+    if (!g)
+        return NG_INVALID_ARGUMENT;
+    if (!max_entries || !max_bytes) {
+        ng_query_cache_free(g->query_cache);
+        g->query_cache = NULL;
+        return NG_OK;
+    }
+    c = g->query_cache;
+    if (!c) {
+        c = (query_cache_i*)calloc(1, sizeof(*c));
+        if (!c)
+            return NG_OOM;
+        c->version = g->version;
+        g->query_cache = c;
+    }
+    c->max_entries = max_entries;
+    c->max_bytes = max_bytes;
+    ng_query_cache_evict(c, 0, 0);
+    return NG_OK;
+}
+ng_status ng_query_cache_get_stats(const ng_graph* g, ng_query_cache_stats* out) {
+    if (!g || !out)
+        return NG_INVALID_ARGUMENT;
+    memset(out, 0, sizeof(*out));
+    if (g->query_cache) {
+        out->hits = g->query_cache->hits;
+        out->misses = g->query_cache->misses;
+        out->entries = g->query_cache->count;
+        out->bytes = g->query_cache->bytes;
+    }
+    return NG_OK;
+}
+ng_status ng_query_execute_batch_params(ng_graph* g,
+                                        const char* q,
+                                        const ng_parameter* rows,
+                                        size_t parameter_count,
+                                        size_t row_count,
+                                        FILE* out,
+                                        int* mutated) {
+    const ng_parameter* oldp = ng_query_parameters;
+    size_t oldn = ng_query_parameter_count;
+    int olde = ng_query_parameter_error;
+    size_t r, i;
+    ng_status s = NG_OK;
+    if (mutated)
+        *mutated = 0;
+    if (!g || !q || !out || (row_count && parameter_count && !rows))
+        return NG_INVALID_ARGUMENT;
+    if (!row_count)
+        return NG_OK;
+    for (r = 0; s == NG_OK && r < row_count; r++) {
+        const ng_parameter* row = rows ? rows + r * parameter_count : NULL;
+        s = ng_query_parameters_valid(row, parameter_count);
+        for (i = 0; s == NG_OK && r && i < parameter_count; i++)
+            if (strcmp(row[i].name, rows[i].name))
+                s = NG_INVALID_ARGUMENT;
+    }
+    if (s == NG_OK)
+        s = ng_query_parameters_cover_query(q, rows, parameter_count);
+    if (s != NG_OK)
+        return s;
+    s = ng_query_execute_active(g, q, rows, parameter_count, row_count, out, mutated);
+    ng_query_parameters = oldp;
+    ng_query_parameter_count = oldn;
+    ng_query_parameter_error = olde;
+    return s;
+}
+ng_status ng_query_execute_batch_params_file(ng_graph* g,
+                                             const char* q,
+                                             const ng_parameter* rows,
+                                             size_t parameter_count,
+                                             size_t row_count,
+                                             const char* output_path,
+                                             int* mutated) {
+    FILE* out;
+    ng_status s;
+    if (!g || !q || !output_path)
+        return NG_INVALID_ARGUMENT;
+    out = fopen(output_path, "wb");
+    if (!out)
+        return NG_IO_ERROR;
+    s = ng_secure_file(output_path);
+    if (s != NG_OK) {
+        fclose(out);
+        return s;
+    }
+    s = ng_query_execute_batch_params(g, q, rows, parameter_count, row_count, out, mutated);
+    if (fclose(out) != 0 && s == NG_OK)
+        s = NG_IO_ERROR;
+    if (s == NG_OK)
+        s = ng_secure_file(output_path);
+    return s;
+}
+static ng_status ng_query_profile_run(ng_graph* g,
+                                      const char* q,
+                                      const ng_parameter* p,
+                                      size_t n,
+                                      FILE* out,
+                                      FILE* report,
+                                      const char* heading,
+                                      int* mutated) {
+    ng_query_profile_state profile, *previous = ng_query_active_profile;
+    ng_query_profile_mark mark;
+    const char* body;
+    FILE* rows = out;
+    size_t i;
+    ng_status s;
+    if (mutated)
+        *mutated = 0;
+    if (!g || !q || !report)
+        return NG_INVALID_ARGUMENT;
+    body = ng_query_profile_strip(q);
+    if (!body)
+        body = q;
+    if (!rows && !(rows = tmpfile()))
+        return NG_IO_ERROR;
+    memset(&profile, 0, sizeof(profile));
+    ng_query_active_profile = &profile;
+    ng_query_profile_begin(&mark);
+    s = ng_query_execute_params(g, body, p, n, rows, mutated);
+    if (s == NG_OK && !profile.count)
+        ng_query_profile_end(&mark, "Query", 0, ng_query_profile_emitted(&mark));
+    ng_query_active_profile = previous;
+    if (s == NG_OK && profile.failed)
+        s = NG_OOM;
+    if (s == NG_OK && heading && fputs(heading, report) == EOF)
+        s = NG_IO_ERROR;
+    if (s == NG_OK && fprintf(report,
+                              "operator\trows_in\trows_out\trelationships\tindex_hits\twall_ms\t"
+                              "peak_bytes\n") < 0)
+        s = NG_IO_ERROR;
+    for (i = 0; s == NG_OK && i < profile.count; i++) {
+        const ng_query_profile_entry* e = &profile.entries[i];
+        if (fprintf(report,
+                    "%s\t%llu\t%llu\t%llu\t%llu\t%.3f\t%llu\n",
+                    e->op,
+                    (unsigned long long)e->rows_in,
+                    (unsigned long long)e->rows_out,
+                    (unsigned long long)e->relationships,
+                    (unsigned long long)e->index_hits,
+                    e->wall_ms,
+                    (unsigned long long)e->peak_bytes) < 0)
+            s = NG_IO_ERROR;
+    }
+    free(profile.entries);
+    if (rows != out)
+        fclose(rows);
+    return s;
+}
+ng_status ng_query_profile(ng_graph* g,
+                           const char* q,
+                           const ng_parameter* p,
+                           size_t n,
+                           FILE* out,
+                           FILE* report,
+                           int* mutated) {
+    return ng_query_profile_run(g, q, p, n, out, report, NULL, mutated);
+}
 ng_status ng_query_execute_file(ng_graph* g,
                                 const char* q,
                                 const char* output_path,
@@ -14722,7 +19532,11 @@ static ng_status ng_attach_labels(ng_graph* g, node_i* n, char* text) {
         if (i == n->nl) {
             if (!grow((void**)&n->labels, &n->cap, n->nl + 1, sizeof(*n->labels)))
                 return NG_OOM;
+            ng_count_stats_note(g, &label, 1, 0, 1);
+            ng_count_postings_note(g, n, 0, -1);
             n->labels[n->nl++] = label;
+            ng_count_postings_note(g, n, 0, 1);
+            ng_graph_bump(g);
         }
         text = q ? q + 1 : NULL;
     }
@@ -15159,8 +19973,28 @@ static void ng_free_contents(ng_graph* g) {
     for (i = 0; i < g->procedure_count; i++)
         free(g->procedures[i].name);
     free(g->procedures);
+    ng_query_cache_free(g->query_cache);
+    ng_count_stats_free(g->counts);
+    ng_cy_adjacency_free(g->adjacency);
     memset(g, 0, sizeof(*g));
 }
+static void ng_replace_contents(ng_graph* g, ng_graph* next) {
+    ng_graph old = *g;
+    *g = *next;
+    if (g->counts && g->counts->version == g->version)
+        g->counts->version = old.version + 1;
+    else {
+        ng_count_stats_free(g->counts);
+        g->counts = NULL;
+    }
+    g->version = old.version + 1;
+    ng_cy_adjacency_free(g->adjacency);
+    g->adjacency = NULL;
+    g->query_cache = old.query_cache;
+    old.query_cache = NULL;
+    memset(next, 0, sizeof(*next));
+    ng_free_contents(&old);
+}
 static int ng_clone_graph(const ng_graph* src, ng_graph* dst) {
     size_t i, j;
     memset(dst, 0, sizeof(*dst));
@@ -15168,8 +20002,47 @@ static int ng_clone_graph(const ng_graph* src, ng_graph* dst) {
     dst->next_node = src->next_node;
     dst->next_rel = src->next_rel;
     dst->next_sym = src->next_sym;
+    dst->version = src->version;
     if (!dst->path)
         return 0;
+    if (src->counts && src->counts->version == src->version && src->counts->symbols) {
+        dst->counts = (count_stats_i*)calloc(1, sizeof(*dst->counts));
+        if (!dst->counts)
+            return 0;
+        dst->counts->labels = (size_t*)malloc(src->counts->symbols * sizeof(size_t));
+        dst->counts->types = (size_t*)malloc(src->counts->symbols * sizeof(size_t));
+        if (!dst->counts->labels || !dst->counts->types)
+            return 0;
+        memcpy(dst->counts->labels, src->counts->labels, src->counts->symbols * sizeof(size_t));
+        memcpy(dst->counts->types, src->counts->types, src->counts->symbols * sizeof(size_t));
+        dst->counts->symbols = src->counts->symbols;
+        dst->counts->version = src->version;
+        for (i = 0; i < src->counts->posting_count; i++) {
+            const posting_table_i* from = &src->counts->postings[i];
+            posting_table_i* to;
+            if (!from->valid)
+                continue;
+            if (!grow((void**)&dst->counts->postings,
+                      &dst->counts->posting_capacity,
+                      dst->counts->posting_count + 1,
+                      sizeof(*dst->counts->postings)))
+                return 0;
+            to = &dst->counts->postings[dst->counts->posting_count++];
+            *to = *from;
+            to->slots = (posting_i*)calloc(from->capacity, sizeof(*to->slots));
+            if (!to->slots) {
+                to->capacity = 0;
+                return 0;
+            }
+            for (j = 0; j < from->capacity; j++)
+                if (from->slots[j].count) {
+                    if (valcopy(&to->slots[j].value, &from->slots[j].value) != NG_OK)
+                        return 0;
+                    to->slots[j].hash = from->slots[j].hash;
+                    to->slots[j].count = from->slots[j].count;
+                }
+        }
+    }
     for (i = 0; i < src->ns; i++) {
         if (!grow((void**)&dst->sy, &dst->cs, dst->ns + 1, sizeof(*dst->sy)))
             return 0;
@@ -15267,9 +20140,7 @@ ng_import_triples(ng_graph* g, const char* file, int preserve_parallel, size_t*
     if (s == NG_OK)
         s = ng_validate(g);
     if (s != NG_OK) {
-        ng_graph failed = *g;
-        *g = snapshot;
-        ng_free_contents(&failed);
+        ng_replace_contents(g, &snapshot);
         if (accepted)
             *accepted = 0;
     } else {
@@ -15293,9 +20164,7 @@ ng_import_triples_csv(ng_graph* g, const char* file, int preserve_parallel, size
     if (s == NG_OK)
         s = ng_validate(g);
     if (s != NG_OK) {
-        ng_graph failed = *g;
-        *g = snapshot;
-        ng_free_contents(&failed);
+        ng_replace_contents(g, &snapshot);
         if (accepted)
             *accepted = 0;
     } else {
@@ -15334,9 +20203,7 @@ ng_status ng_import_property_graph(
             d->column = 0;
             d->status = NG_OOM;
         }
-        ng_graph failed = *g;
-        *g = snapshot;
-        ng_free_contents(&failed);
+        ng_replace_contents(g, &snapshot);
     } else {
         ng_free_contents(&snapshot);
     }
@@ -15363,18 +20230,14 @@ ng_graph* ng_transaction_graph(ng_transaction* tx) {
     return tx && tx->active ? &tx->working : NULL;
 }
 ng_status ng_transaction_commit(ng_transaction* tx) {
-    ng_graph old;
     ng_status s;
     if (!tx || !tx->active)
         return NG_INVALID_ARGUMENT;
     s = ng_validate(&tx->working);
     if (s != NG_OK)
         return s;
-    old = *tx->target;
-    *tx->target = tx->working;
-    memset(&tx->working, 0, sizeof(tx->working));
+    ng_replace_contents(tx->target, &tx->working);
     tx->active = 0;
-    ng_free_contents(&old);
     free(tx);
     return NG_OK;
 }
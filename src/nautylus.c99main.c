@@ -46,8 +46,9 @@ static void usage(FILE* out) {
             "  nautylus bench FILE NODE_COUNT\n"
             "  nautylus serve DB PORT [--auth-env VAR]\n"
             "  nautylus search DB QUERY\n"
-            "  nautylus query DB QUERY [--format auto|verbose|plain|json]\n"
-            "  nautylus explain QUERY\n");
+            "  nautylus query DB QUERY|@FILE [--format auto|verbose|plain|json]\n"
+            "  nautylus explain QUERY\n"
+            "  nautylus explain DB QUERY\n");
 }
 
 static void print_stats_to(FILE* out, const ng_graph* g) {
@@ -419,6 +420,11 @@ static void capture_execute(FILE* f, void* ctx) {
     q->status = ng_query_execute(q->g, q->query, f, &q->mutated);
 }
 
+static void capture_profile(FILE* f, void* ctx) {
+    execute_capture* q = (execute_capture*)ctx;
+    q->status = ng_query_profile(q->g, q->query, 0, 0, 0, f, &q->mutated);
+}
+
 static int capture_query_node_id(ng_node_id node, void* ctx) {
     FILE* f = (FILE*)ctx;
     return fprintf(f, "%llu\n", (unsigned long long)node) >= 0;
@@ -473,6 +479,22 @@ capture_graph_execute(ng_graph* g, const char* query, int* mutated, ng_status* s
     return out;
 }
 
+static char* capture_graph_profile(ng_graph* g, const char* query, ng_status* status) {
+    execute_capture qc;
+    char* out;
+    qc.g = g;
+    qc.query = query;
+    qc.status = NG_OK;
+    qc.mutated = 0;
+    out = run_text_capture(status, capture_profile, &qc);
+    if (*status == NG_OK && qc.status != NG_OK) {
+        free(out);
+        *status = qc.status;
+        return 0;
+    }
+    return out;
+}
+
 static int split_pair(char* body, char** label, char** key) {
     char* tab = strchr(body, '\t');
     if (!tab || tab == body || !tab[1])
@@ -894,6 +916,9 @@ static void handle_api(int fd, const char* db_path, const char* route, char* bod
             s = ng_save(g);
     } else if (!strcmp(route, "/api/query-nodes"))
         out = capture_graph_text(g, "query-nodes", body, &s);
+    else if (!strcmp(route, "/api/explain") && !strncmp(body, "PROFILE", 7) &&
+             isspace((unsigned char)body[7]))
+        out = capture_graph_profile(g, body, &s);
     else if (!strcmp(route, "/api/explain")) {
         out = (char*)malloc(512);
         if (!out)
@@ -1597,6 +1622,7 @@ int main(int argc, char** argv) {
         s = run_server(argv[2], port, credential);
     } else if (!strcmp(argv[1], "query") && (argc == 4 || argc == 6 || argc == 5)) {
         query_format format = QUERY_FORMAT_AUTO;
+        char* script = 0;
         int mutated = 0;
         if (argc == 5 && strncmp(argv[4], "--format=", 9)) {
             usage(stderr);
@@ -1614,15 +1640,27 @@ int main(int argc, char** argv) {
             fprintf(stderr, "invalid query format\n");
             return 2;
         }
+        if (argv[3][0] == '@') {
+            script = read_file_bytes(argv[3] + 1, 0);
+            if (!script) {
+                fprintf(stderr, "%s\n", ng_status_name(NG_IO_ERROR));
+                return 1;
+            }
+        }
         s = ng_open(&g, argv[2]);
         if (s == NG_OK)
-            s = run_query_cli(g, argv[3], format, &mutated);
+            s = run_query_cli(g, script ? script : argv[3], format, &mutated);
         if (s == NG_OK && mutated)
             s = ng_save(g);
+        free(script);
     } else if (!strcmp(argv[1], "search") && argc == 4) {
         s = ng_open(&g, argv[2]);
         if (s == NG_OK)
             s = ng_query_print(g, argv[3], stdout);
+    } else if (!strcmp(argv[1], "explain") && argc == 4) {
+        s = ng_open(&g, argv[2]);
+        if (s == NG_OK)
+            s = ng_query_profile(g, argv[3], 0, 0, 0, stdout, 0);
     } else if (!strcmp(argv[1], "explain") && argc == 3) {
         char plan[512];
         s = ng_query_explain(argv[2], plan, sizeof(plan));
@@ -74,6 +74,7 @@ typedef struct ng_transaction ng_transaction;
 typedef struct ng_node_index ng_node_index;
 typedef struct ng_graphsage_model ng_graphsage_model;
 typedef struct ng_vector_index ng_vector_index;
+typedef struct ng_analytics_view ng_analytics_view;
 typedef struct {
     uint32_t layers;
     size_t input_dimensions;
@@ -214,6 +215,43 @@ typedef struct {
     uint32_t max_steps;
     uint64_t seed;
 } ng_random_walk_options;
+typedef struct {
+    uint64_t hits, misses;
+    size_t entries, bytes;
+} ng_query_cache_stats;
+/* Zero fields take defaults: damping 0.85, 20 iterations, no early stop, uniform teleport. When
+ * seed_count is non-zero, teleport and dangling mass go to seeds, weighted by seed_weights or
+ * uniformly when that is NULL. */
+typedef struct {
+    double damping;
+    uint32_t max_iterations;
+    double tolerance;
+    const ng_node_id* seeds;
+    const double* seed_weights;
+    size_t seed_count;
+} ng_pagerank_options;
+typedef struct {
+    uint32_t iterations;
+    double delta;
+    int converged;
+} ng_pagerank_report;
+/* Zero fields take defaults: 10 levels, 20 local-moving sweeps per level, stop once a level or
+ * sweep gains at most `tolerance` modularity. `leiden` refines communities before aggregation. */
+typedef struct {
+    uint32_t max_levels;
+    uint32_t max_iterations;
+    double tolerance;
+    int leiden;
+} ng_louvain_options;
+/* Set level_modularity/level_capacity to receive the modularity after each level; levels beyond
+ * the capacity are counted but not stored. */
+typedef struct {
+    double* level_modularity;
+    size_t level_capacity;
+    uint32_t levels;
+    uint64_t communities;
+    double modularity;
+} ng_louvain_report;
 
 ng_status ng_open(ng_graph** out, const char* path);
 ng_status ng_create(ng_graph** out, const char* path);
@@ -297,6 +335,115 @@ ng_status ng_traverse(const ng_graph* g,
                       const ng_traversal_options* options,
                       ng_node_visitor visitor,
                       void* context);
+/* Immutable CSR projection of the relationships of one type (0 for all), oriented by direction:
+ * OUTGOING keeps relationships as stored, INCOMING reverses them, and EITHER makes them undirected.
+ * Missing weight properties read as 1.0.  The *_view algorithms reuse one projection. */
+ng_status ng_analytics_view_build(const ng_graph* g,
+                                  ng_direction direction,
+                                  ng_symbol_id type,
+                                  ng_symbol_id weight_key,
+                                  ng_analytics_view** out);
+void ng_analytics_view_free(ng_analytics_view* view);
+size_t ng_analytics_view_node_count(const ng_analytics_view* view);
+size_t ng_analytics_view_relationship_count(const ng_analytics_view* view);
+ng_status ng_degree_centrality_view(const ng_analytics_view* view,
+                                    ng_node_score* out,
+                                    size_t capacity,
+                                    size_t* out_count);
+ng_status ng_pagerank_view(const ng_analytics_view* view,
+                           double damping,
+                           uint32_t iterations,
+                           ng_node_score* out,
+                           size_t capacity,
+                           size_t* out_count);
+ng_status ng_pagerank_view_with_options(const ng_analytics_view* view,
+                                        const ng_pagerank_options* options,
+                                        ng_node_score* out,
+                                        size_t capacity,
+                                        size_t* out_count,
+                                        ng_pagerank_report* report);
+ng_status ng_eigenvector_centrality_view(const ng_analytics_view* view,
+                                         uint32_t iterations,
+                                         ng_node_score* out,
+                                         size_t capacity,
+                                         size_t* out_count);
+ng_status ng_eigenvector_centrality_view_with_tolerance(const ng_analytics_view* view,
+                                                        uint32_t max_iterations,
+                                                        double tolerance,
+                                                        ng_node_score* out,
+                                                        size_t capacity,
+                                                        size_t* out_count,
+                                                        uint32_t* out_iterations);
+ng_status ng_closeness_centrality_view(const ng_analytics_view* view,
+                                       ng_node_score* out,
+                                       size_t capacity,
+                                       size_t* out_count);
+ng_status ng_harmonic_centrality_view(const ng_analytics_view* view,
+                                      ng_node_score* out,
+                                      size_t capacity,
+                                      size_t* out_count);
+ng_status ng_closeness_centrality_view_sampled(const ng_analytics_view* view,
+                                               size_t samples,
+                                               uint64_t seed,
+                                               ng_node_score* out,
+                                               size_t capacity,
+                                               size_t* out_count);
+ng_status ng_harmonic_centrality_view_sampled(const ng_analytics_view* view,
+                                              size_t samples,
+                                              uint64_t seed,
+                                              ng_node_score* out,
+                                              size_t capacity,
+                                              size_t* out_count);
+ng_status ng_betweenness_centrality_view(const ng_analytics_view* view,
+                                         ng_node_score* out,
+                                         size_t capacity,
+                                         size_t* out_count);
+ng_status ng_betweenness_centrality_view_sampled(const ng_analytics_view* view,
+                                                 size_t samples,
+                                                 uint64_t seed,
+                                                 ng_node_score* out,
+                                                 size_t capacity,
+                                                 size_t* out_count);
+ng_status ng_fastrp_view(const ng_analytics_view* view,
+                         uint32_t iterations,
+                         size_t dimensions,
+                         uint64_t seed,
+                         double* out,
+                         size_t capacity,
+                         size_t* out_count);
+ng_status ng_weakly_connected_components_view(const ng_analytics_view* view,
+                                              ng_node_component* out,
+                                              size_t capacity,
+                                              size_t* out_count);
+ng_status ng_strongly_connected_components_view(const ng_analytics_view* view,
+                                                ng_node_component* out,
+                                                size_t capacity,
+                                                size_t* out_count);
+ng_status ng_label_propagation_view(const ng_analytics_view* view,
+                                    uint32_t iterations,
+                                    ng_node_component* out,
+                                    size_t capacity,
+                                    size_t* out_count);
+ng_status ng_louvain_view(const ng_analytics_view* view,
+                          uint32_t iterations,
+                          ng_node_component* out,
+                          size_t capacity,
+                          size_t* out_count);
+ng_status ng_louvain_multilevel_view(const ng_analytics_view* view,
+                                     const ng_louvain_options* options,
+                                     ng_node_component* out,
+                                     size_t capacity,
+                                     size_t* out_count,
+                                     ng_louvain_report* report);
+ng_status ng_triangle_count_view(const ng_analytics_view* view,
+                                 ng_node_metric* out,
+                                 size_t capacity,
+                                 size_t* out_count);
+ng_status ng_triangle_count_total_view(const ng_analytics_view* view, uint64_t* out_total);
+ng_status ng_local_clustering_coefficient_view(const ng_analytics_view* view,
+                                               ng_node_score* out,
+                                               size_t capacity,
+                                               size_t* out_count);
 ng_status ng_degree_centrality(const ng_graph* g,
                                ng_direction direction,
                                ng_symbol_id type,
@@ -343,6 +490,41 @@ ng_status ng_a_star(const ng_graph* g,
                     size_t capacity,
                     size_t* out_count,
                     double* out_distance);
+ng_status ng_bidirectional_dijkstra(const ng_graph* g,
+                                    ng_node_id start,
+                                    ng_node_id target,
+                                    ng_direction direction,
+                                    ng_symbol_id type,
+                                    ng_symbol_id weight_key,
+                                    ng_node_id* out_path,
+                                    size_t capacity,
+                                    size_t* out_count,
+                                    double* out_distance);
+/* Shortest paths over a view built with the relationship weight key; reuse one view across many
+ * route queries to skip rebuilding adjacency. */
+ng_status ng_dijkstra_view(const ng_analytics_view* view,
+                           ng_node_id start,
+                           ng_node_id target,
+                           ng_node_id* out_path,
+                           size_t capacity,
+                           size_t* out_count,
+                           double* out_distance);
+ng_status ng_bidirectional_dijkstra_view(const ng_analytics_view* view,
+                                         ng_node_id start,
+                                         ng_node_id target,
+                                         ng_node_id* out_path,
+                                         size_t capacity,
+                                         size_t* out_count,
+                                         double* out_distance);
+ng_status ng_a_star_view(const ng_analytics_view* view,
+                         ng_node_id start,
+                         ng_node_id target,
+                         ng_path_heuristic heuristic,
+                         void* heuristic_context,
+                         ng_node_id* out_path,
+                         size_t capacity,
+                         size_t* out_count,
+                         double* out_distance);
 ng_status ng_pagerank(const ng_graph* g,
                       ng_symbol_id type,
                       double damping,
@@ -350,6 +532,39 @@ ng_status ng_pagerank(const ng_graph* g,
                       ng_node_score* out,
                       size_t capacity,
                       size_t* out_count);
+/* Stops once the L1 change between iterations is at most options->tolerance (when positive). */
+ng_status ng_pagerank_with_options(const ng_graph* g,
+                                   ng_symbol_id type,
+                                   const ng_pagerank_options* options,
+                                   ng_node_score* out,
+                                   size_t capacity,
+                                   size_t* out_count,
+                                   ng_pagerank_report* report);
+/* Forward-push Personalized PageRank from seeds with teleport probability alpha; pushes stop once
+ * every residual is below epsilon per outgoing relationship, so the push work is O(1 / (alpha *
+ * epsilon)). Writes the k highest estimates, best first. This entry point first builds a view,
+ * which is O(N + R); reuse one view across seed sets with the _view variant to pay only the push
+ * cost. */
+ng_status ng_personalized_pagerank_push(const ng_graph* g,
+                                        ng_direction direction,
+                                        ng_symbol_id type,
+                                        const ng_node_id* seeds,
+                                        size_t seed_count,
+                                        double alpha,
+                                        double epsilon,
+                                        size_t k,
+                                        ng_node_score* out,
+                                        size_t capacity,
+                                        size_t* out_count);
+ng_status ng_personalized_pagerank_push_view(const ng_analytics_view* view,
+                                             const ng_node_id* seeds,
+                                             size_t seed_count,
+                                             double alpha,
+                                             double epsilon,
+                                             size_t k,
+                                             ng_node_score* out,
+                                             size_t capacity,
+                                             size_t* out_count);
 ng_status ng_eigenvector_centrality(const ng_graph* g,
                                     ng_direction direction,
                                     ng_symbol_id type,
@@ -357,6 +572,16 @@ ng_status ng_eigenvector_centrality(const ng_graph* g,
                                     ng_node_score* out,
                                     size_t capacity,
                                     size_t* out_count);
+/* Stops early once the L1 change of the normalized vector is at most tolerance (when positive). */
+ng_status ng_eigenvector_centrality_with_tolerance(const ng_graph* g,
+                                                   ng_direction direction,
+                                                   ng_symbol_id type,
+                                                   uint32_t max_iterations,
+                                                   double tolerance,
+                                                   ng_node_score* out,
+                                                   size_t capacity,
+                                                   size_t* out_count,
+                                                   uint32_t* out_iterations);
 ng_status ng_closeness_centrality(const ng_graph* g,
                                   ng_direction direction,
                                   ng_symbol_id type,
@@ -369,6 +594,41 @@ ng_status ng_harmonic_centrality(const ng_graph* g,
                                  ng_node_score* out,
                                  size_t capacity,
                                  size_t* out_count);
+/* Estimates from BFS to `samples` seeded random pivots; samples >= node count is exact. */
+ng_status ng_closeness_centrality_sampled(const ng_graph* g,
+                                          ng_direction direction,
+                                          ng_symbol_id type,
+                                          size_t samples,
+                                          uint64_t seed,
+                                          ng_node_score* out,
+                                          size_t capacity,
+                                          size_t* out_count);
+ng_status ng_harmonic_centrality_sampled(const ng_graph* g,
+                                         ng_direction direction,
+                                         ng_symbol_id type,
+                                         size_t samples,
+                                         uint64_t seed,
+                                         ng_node_score* out,
+                                         size_t capacity,
+                                         size_t* out_count);
+/* Brandes betweenness; weight_key 0 counts hops. Undirected (EITHER) scores count each pair once.
+ * The sampled form runs from `samples` seeded sources and scales by node count / samples. */
+ng_status ng_betweenness_centrality(const ng_graph* g,
+                                    ng_direction direction,
+                                    ng_symbol_id type,
+                                    ng_symbol_id weight_key,
+                                    ng_node_score* out,
+                                    size_t capacity,
+                                    size_t* out_count);
+ng_status ng_betweenness_centrality_sampled(const ng_graph* g,
+                                            ng_direction direction,
+                                            ng_symbol_id type,
+                                            ng_symbol_id weight_key,
+                                            size_t samples,
+                                            uint64_t seed,
+                                            ng_node_score* out,
+                                            size_t capacity,
+                                            size_t* out_count);
 ng_status ng_fastrp(const ng_graph* g,
                     ng_direction direction,
                     ng_symbol_id type,
@@ -531,8 +791,20 @@ ng_status ng_louvain(const ng_graph* g,
                      ng_node_component* out,
                      size_t capacity,
                      size_t* out_count);
+/* Multilevel weighted Louvain (optionally Leiden) on the undirected graph; weight_key 0 counts
+ * each relationship as 1. Communities are numbered 0.. in order of their first node. */
+ng_status ng_louvain_multilevel(const ng_graph* g,
+                                ng_symbol_id type,
+                                ng_symbol_id weight_key,
+                                const ng_louvain_options* options,
+                                ng_node_component* out,
+                                size_t capacity,
+                                size_t* out_count,
+                                ng_louvain_report* report);
 ng_status ng_triangle_count(
     const ng_graph* g, ng_symbol_id type, ng_node_metric* out, size_t capacity, size_t* out_count);
+/* Number of distinct triangles of three different nodes, without per-node output. */
+ng_status ng_triangle_count_total(const ng_graph* g, ng_symbol_id type, uint64_t* out_total);
 ng_status ng_local_clustering_coefficient(
     const ng_graph* g, ng_symbol_id type, ng_node_score* out, size_t capacity, size_t* out_count);
 ng_status ng_common_neighbors(
@@ -663,10 +935,34 @@ ng_status ng_query_execute_params(ng_graph* g,
                                   size_t parameter_count,
                                   FILE* out,
                                   int* mutated);
+ng_status ng_query_execute_batch_params(ng_graph* g,
+                                        const char* query,
+                                        const ng_parameter* parameter_rows,
+                                        size_t parameter_count,
+                                        size_t row_count,
+                                        FILE* out,
+                                        int* mutated);
+ng_status ng_query_profile(ng_graph* g,
+                           const char* query,
+                           const ng_parameter* parameters,
+                           size_t parameter_count,
+                           FILE* out,
+                           FILE* report,
+                           int* mutated);
+uint64_t ng_graph_version(const ng_graph* g);
+ng_status ng_query_cache_configure(ng_graph* g, size_t max_entries, size_t max_bytes);
+ng_status ng_query_cache_get_stats(const ng_graph* g, ng_query_cache_stats* out);
 ng_status ng_query_print_file(const ng_graph* g, const char* query, const char* output_path);
 ng_status ng_query_execute_file(ng_graph* g,
                                 const char* query,
                                 const char* output_path,
                                 int* mutated);
+ng_status ng_query_execute_batch_params_file(ng_graph* g,
+                                             const char* query,
+                                             const ng_parameter* parameter_rows,
+                                             size_t parameter_count,
+                                             size_t row_count,
+                                             const char* output_path,
+                                             int* mutated);
 const char* ng_status_name(ng_status s);
 #endif
@@ -553,6 +553,30 @@ int main(void) {
         assert(!strcmp(batch_text, "one\ntwo\n"));
         fclose(batch_output);
     }
+    {
+        FILE* script_output = tmpfile();
+        char script[2048];
+        size_t used = 0, before = ng_node_count(r), i;
+        int script_mutated = 0;
+        assert(script_output);
+        for (i = 0; i < 40; i++)
+            used += (size_t)sprintf(script + used,
+                                    "// step %llu\nCREATE (:Script {i: %llu});\n",
+                                    (unsigned long long)i,
+                                    (unsigned long long)i);
+        assert(ng_query_execute(r, script, script_output, &script_mutated) == NG_OK &&
+               script_mutated);
+        assert(ng_node_count(r) == before + 40);
+        strcpy(script + used, "CREATE (:Script {i: 40}); MATCH (n:Script) RETURN n.missing(;");
+        assert(ng_query_execute(r, script, script_output, &script_mutated) == NG_PARSE_ERROR);
+        assert(!script_mutated && ng_node_count(r) == before + 40);
+        assert(ng_query_execute(r, "CREATE (:Script {i: 41});;", script_output, 0) ==
+               NG_PARSE_ERROR);
+        assert(ng_query_execute(r, "MATCH (n:Script) DETACH DELETE n;", script_output, 0) ==
+               NG_OK);
+        assert(ng_node_count(r) == before);
+        fclose(script_output);
+    }
     n = 0;
     assert(ng_node_relationships(r, a, NG_DIRECTION_OUTGOING, w, edge_count, &n) == NG_OK &&
            n == 1);
@@ -707,6 +731,37 @@ int main(void) {
                          &sum) == NG_OK &&
                count == 3 && shortest[0] == a && shortest[1] == b && shortest[2] == c &&
                sum == 7.0);
+        assert(ng_bidirectional_dijkstra(
+                   g, a, d, NG_DIRECTION_OUTGOING, rel, weight, shortest, 8, &count, &sum) ==
+                   NG_OK &&
+               count == 4 && shortest[0] == a && shortest[1] == b && shortest[2] == c &&
+               shortest[3] == d && sum == 8.0);
+        assert(ng_bidirectional_dijkstra(
+                   g, d, a, NG_DIRECTION_INCOMING, rel, weight, shortest, 8, &count, &sum) ==
+                   NG_OK &&
+               count == 4 && shortest[0] == d && shortest[3] == a && sum == 8.0);
+        assert(ng_bidirectional_dijkstra(
+                   g, a, c, NG_DIRECTION_EITHER, rel, weight, shortest, 2, &count, &sum) ==
+                   NG_LIMIT);
+        {
+            ng_analytics_view* view = NULL;
+            assert(ng_analytics_view_build(g, NG_DIRECTION_EITHER, rel, weight, &view) == NG_OK);
+            assert(ng_dijkstra_view(view, d, a, shortest, 8, &count, &sum) == NG_OK && count == 4 &&
+                   shortest[1] == c && shortest[2] == b && sum == 8.0);
+            assert(ng_bidirectional_dijkstra_view(view, a, c, shortest, 8, &count, &sum) == NG_OK &&
+                   count == 3 && shortest[1] == b && sum == 7.0);
+            assert(ng_bidirectional_dijkstra_view(view, b, b, shortest, 8, &count, &sum) == NG_OK &&
+                   count == 1 && shortest[0] == b && sum == 0.0);
+            assert(ng_bidirectional_dijkstra_view(view, a, iso, shortest, 8, &count, &sum) ==
+                       NG_NOT_FOUND &&
+                   count == 0);
+            assert(ng_a_star_view(view, a, d, zero_heuristic, NULL, shortest, 8, &count, &sum) ==
+                       NG_OK &&
+                   count == 4 && sum == 8.0);
+            assert(ng_a_star_view(view, a, d, NULL, NULL, shortest, 8, &count, &sum) ==
+                   NG_INVALID_ARGUMENT);
+            ng_analytics_view_free(view);
+        }
         count = 0;
         assert(ng_bfs_path(g, a, d, NG_DIRECTION_OUTGOING, rel, shortest, 8, &count) == NG_OK &&
                count == 4 && shortest[0] == a && shortest[1] == b && shortest[2] == c &&
@@ -751,14 +806,132 @@ int main(void) {
             sum += scores[i].score;
         }
         assert(absd(sum - 1.0) < 0.000001);
+        {
+            ng_pagerank_options options;
+            ng_pagerank_report report;
+            ng_node_id missing = iso + 1000;
+            memset(&options, 0, sizeof(options));
+            options.max_iterations = 1000;
+            options.tolerance = 1e-10;
+            assert(ng_pagerank_with_options(g, rel, &options, scores, 8, &count, &report) ==
+                       NG_OK &&
+                   count == 5 && report.converged && report.iterations < 1000 &&
+                   report.delta <= 1e-10);
+            options.seeds = &a;
+            options.seed_count = 1;
+            assert(ng_pagerank_with_options(g, rel, &options, scores, 8, &count, &report) ==
+                       NG_OK &&
+                   report.converged && scores[4].node == iso && scores[4].score == 0.0 &&
+                   scores[0].score > scores[3].score);
+            sum = 0.0;
+            for (i = 0; i < count; i++)
+                sum += scores[i].score;
+            assert(absd(sum - 1.0) < 0.000001);
+            {
+                ng_node_score pushed[8];
+                size_t pushed_count = 0, j;
+                assert(ng_personalized_pagerank_push(g, NG_DIRECTION_OUTGOING, rel, &a, 1, 0.15,
+                                                     1e-12, 8, pushed, 8, &pushed_count) == NG_OK &&
+                       pushed_count == 4 && pushed[0].node == a);
+                for (i = 0; i < pushed_count; i++) {
+                    assert(pushed[i].node != iso);
+                    for (j = 0; j < count; j++)
+                        if (scores[j].node == pushed[i].node)
+                            assert(absd(scores[j].score - pushed[i].score) < 0.000001);
+                }
+                assert(ng_personalized_pagerank_push(g, NG_DIRECTION_OUTGOING, rel, &a, 1, 0.15,
+                                                     1e-12, 2, pushed, 8, &pushed_count) == NG_OK &&
+                       pushed_count == 2 && pushed[0].score >= pushed[1].score);
+                assert(ng_personalized_pagerank_push(g, NG_DIRECTION_OUTGOING, rel, &a, 1, 0.15,
+                                                     1e-12, 3, pushed, 2, &pushed_count) ==
+                       NG_LIMIT);
+                assert(ng_personalized_pagerank_push(g, NG_DIRECTION_OUTGOING, rel, &missing, 1,
+                                                     0.15, 1e-6, 2, pushed, 8, &pushed_count) ==
+                       NG_NOT_FOUND);
+                assert(ng_personalized_pagerank_push(g, NG_DIRECTION_OUTGOING, rel, &a, 1, 0.15,
+                                                     0.0, 2, pushed, 8, &pushed_count) ==
+                       NG_INVALID_ARGUMENT);
+            }
+            options.seeds = &missing;
+            assert(ng_pagerank_with_options(g, rel, &options, scores, 8, &count, &report) ==
+                   NG_NOT_FOUND);
+            options.seed_count = 0;
+            options.damping = 1.5;
+            assert(ng_pagerank_with_options(g, rel, &options, scores, 8, &count, &report) ==
+                   NG_INVALID_ARGUMENT);
+        }
         assert(ng_eigenvector_centrality(g, NG_DIRECTION_EITHER, rel, 25, scores, 8, &count) ==
                    NG_OK &&
                count == 5 && scores[0].score > 0.0 && scores[1].score > 0.0 &&
                scores[2].score > scores[4].score);
+        {
+            ng_node_score fixed[8];
+            uint32_t used = 0;
+            assert(ng_eigenvector_centrality_with_tolerance(
+                       g, NG_DIRECTION_EITHER, rel, 1000, 1e-9, scores, 8, &count, &used) ==
+                       NG_OK &&
+                   count == 5 && used > 1 && used < 1000);
+            assert(ng_eigenvector_centrality(g, NG_DIRECTION_EITHER, rel, used, fixed, 8, &count) ==
+                   NG_OK);
+            for (i = 0; i < count; i++)
+                assert(fixed[i].score == scores[i].score);
+            assert(ng_eigenvector_centrality_with_tolerance(
+                       g, NG_DIRECTION_EITHER, rel, 10, -1.0, scores, 8, &count, &used) ==
+                   NG_INVALID_ARGUMENT);
+        }
         assert(ng_closeness_centrality(g, NG_DIRECTION_EITHER, rel, scores, 8, &count) == NG_OK &&
                count == 5 && scores[0].score > 0.0 && scores[2].score > scores[4].score);
         assert(ng_harmonic_centrality(g, NG_DIRECTION_EITHER, rel, scores, 8, &count) == NG_OK &&
                count == 5 && scores[0].score > 0.0 && scores[2].score > scores[4].score);
+        {
+            ng_node_score sampled[8], again[8];
+            assert(ng_harmonic_centrality_sampled(
+                       g, NG_DIRECTION_EITHER, rel, 5, 11, sampled, 8, &count) == NG_OK &&
+                   count == 5);
+            for (i = 0; i < count; i++)
+                assert(sampled[i].node == scores[i].node &&
+                       absd(sampled[i].score - scores[i].score) < 0.000001);
+            assert(ng_closeness_centrality(g, NG_DIRECTION_OUTGOING, rel, scores, 8, &count) ==
+                   NG_OK);
+            assert(ng_closeness_centrality_sampled(
+                       g, NG_DIRECTION_OUTGOING, rel, 64, 11, sampled, 8, &count) == NG_OK);
+            for (i = 0; i < count; i++)
+                assert(sampled[i].score == scores[i].score);
+            assert(ng_closeness_centrality_sampled(
+                       g, NG_DIRECTION_OUTGOING, rel, 2, 11, sampled, 8, &count) == NG_OK &&
+                   count == 5 && sampled[4].score == 0.0);
+            assert(ng_closeness_centrality_sampled(
+                       g, NG_DIRECTION_OUTGOING, rel, 2, 11, again, 8, &count) == NG_OK);
+            for (i = 0; i < count; i++)
+                assert(again[i].score == sampled[i].score);
+            assert(ng_harmonic_centrality_sampled(
+                       g, NG_DIRECTION_EITHER, rel, 0, 11, sampled, 8, &count) ==
+                   NG_INVALID_ARGUMENT);
+        }
+        assert(ng_betweenness_centrality(g, NG_DIRECTION_OUTGOING, rel, 0, scores, 8, &count) ==
+                   NG_OK &&
+               count == 5 && scores[0].score == 1.0 && scores[1].score == 2.0 &&
+               scores[2].score == 3.0 && scores[3].score == 0.0 && scores[4].score == 0.0);
+        assert(ng_betweenness_centrality(g, NG_DIRECTION_EITHER, rel, 0, scores, 8, &count) ==
+                   NG_OK &&
+               scores[0].score == 0.0 && scores[1].score == 0.0 && scores[2].score == 2.0);
+        assert(ng_betweenness_centrality(g, NG_DIRECTION_EITHER, rel, weight, scores, 8, &count) ==
+                   NG_OK &&
+               scores[0].score == 0.0 && scores[1].score == 2.0 && scores[2].score == 2.0 &&
+               scores[3].score == 0.0);
+        {
+            ng_node_score sampled[8];
+            assert(ng_betweenness_centrality_sampled(
+                       g, NG_DIRECTION_EITHER, rel, weight, 5, 3, sampled, 8, &count) == NG_OK);
+            for (i = 0; i < count; i++)
+                assert(sampled[i].score == scores[i].score);
+            assert(ng_betweenness_centrality_sampled(
+                       g, NG_DIRECTION_OUTGOING, rel, 0, 2, 3, sampled, 8, &count) == NG_OK &&
+                   count == 5 && sampled[3].score == 0.0 && sampled[4].score == 0.0);
+            assert(ng_betweenness_centrality(
+                       g, NG_DIRECTION_OUTGOING, rel, 0, sampled, 2, &count) == NG_LIMIT &&
+                   count == 5);
+        }
         {
             double embedding[15];
             size_t embedding_count = 0;
@@ -1104,9 +1277,51 @@ int main(void) {
         assert(ng_triangle_count(g, rel, metrics, 8, &count) == NG_OK && count == 5);
         assert(metrics[0].value == 1 && metrics[1].value == 1 && metrics[2].value == 1 &&
                metrics[3].value == 0 && metrics[4].value == 0);
+        assert(ng_triangle_count_total(g, rel, &u) == NG_OK && u == 1);
+        assert(ng_triangle_count_total(g, 999999, &u) == NG_NOT_FOUND);
         assert(ng_local_clustering_coefficient(g, rel, scores, 8, &count) == NG_OK && count == 5);
         assert(scores[0].score == 1.0 && scores[1].score == 1.0 && scores[2].score > 0.333 &&
                scores[2].score < 0.334 && scores[3].score == 0.0 && scores[4].score == 0.0);
+        {
+            ng_analytics_view* view = NULL;
+            ng_node_score view_scores[8];
+            ng_node_metric view_metrics[8];
+            ng_node_component view_comps[8];
+            assert(ng_analytics_view_build(g, NG_DIRECTION_EITHER, 999999, 0, &view) ==
+                       NG_NOT_FOUND &&
+                   view == NULL);
+            assert(ng_analytics_view_build(g, NG_DIRECTION_EITHER, rel, weight, &view) == NG_OK);
+            assert(ng_analytics_view_node_count(view) == 5 &&
+                   ng_analytics_view_relationship_count(view) == 4);
+            assert(ng_local_clustering_coefficient_view(view, view_scores, 8, &count) == NG_OK &&
+                   count == 5);
+            for (i = 0; i < count; i++)
+                assert(view_scores[i].node == scores[i].node &&
+                       view_scores[i].score == scores[i].score);
+            assert(ng_triangle_count_view(view, view_metrics, 8, &count) == NG_OK && count == 5);
+            assert(ng_triangle_count_total_view(view, &u) == NG_OK && u == 1);
+            assert(ng_weakly_connected_components_view(view, view_comps, 8, &count) == NG_OK);
+            assert(ng_weakly_connected_components(g, rel, comps, 8, &count) == NG_OK);
+            assert(ng_triangle_count(g, rel, metrics, 8, &count) == NG_OK);
+            for (i = 0; i < count; i++)
+                assert(view_metrics[i].value == metrics[i].value &&
+                       view_comps[i].component == comps[i].component);
+            assert(ng_harmonic_centrality_view(view, view_scores, 8, &count) == NG_OK);
+            assert(ng_harmonic_centrality(g, NG_DIRECTION_EITHER, rel, scores, 8, &count) == NG_OK);
+            for (i = 0; i < count; i++)
+                assert(view_scores[i].score == scores[i].score);
+            assert(ng_degree_centrality_view(view, view_scores, 2, &count) == NG_LIMIT &&
+                   count == 5);
+            ng_analytics_view_free(view);
+            assert(ng_analytics_view_build(g, NG_DIRECTION_OUTGOING, rel, 0, &view) == NG_OK);
+            assert(ng_pagerank_view(view, 0.85, 25, view_scores, 8, &count) == NG_OK);
+            assert(ng_pagerank(g, rel, 0.85, 25, scores, 8, &count) == NG_OK && count == 5);
+            for (i = 0; i < count; i++)
+                assert(view_scores[i].score == scores[i].score);
+            assert(ng_strongly_connected_components_view(view, view_comps, 8, &count) == NG_OK &&
+                   view_comps[3].component == 1 && view_comps[4].component == 2);
+            ng_analytics_view_free(view);
+        }
         assert(ng_common_neighbors(g, a, c, rel, &u) == NG_OK && u == 1);
         assert(ng_total_neighbors(g, a, c, rel, &u) == NG_OK && u == 4);
         assert(ng_preferential_attachment(g, a, c, rel, &u) == NG_OK && u == 6);
@@ -1127,8 +1342,50 @@ int main(void) {
         assert(ng_relationship_create(g, c, rel, d, &rid) == NG_OK);
         assert(ng_topological_sort(g, rel, order, 8, &count) == NG_OK && count == 4);
         assert(order[0] == a && order[3] == d);
+        assert(ng_relationship_create(g, d, rel, b, &rid) == NG_OK);
+        assert(ng_strongly_connected_components(g, rel, comps, 8, &count) == NG_OK && count == 4);
+        assert(comps[0].component == 0 && comps[1].component == 1 && comps[2].component == 2 &&
+               comps[3].component == 1);
         ng_close(g);
         remove("dag.ng");
+        {
+            ng_node_id cliques[9];
+            ng_node_component groups[9];
+            ng_louvain_options options;
+            ng_louvain_report report;
+            double levels[4];
+            size_t j;
+            assert(ng_create(&g, "communities.ng") == NG_OK);
+            assert(ng_symbol(g, "R", &rel) == NG_OK);
+            for (i = 0; i < 9; i++)
+                assert(ng_node_create(g, 0, 0, &cliques[i]) == NG_OK);
+            for (i = 0; i < 8; i++)
+                for (j = i + 1; j < 8; j++)
+                    if (i / 4 == j / 4 || (i == 3 && j == 4))
+                        assert(ng_relationship_create(g, cliques[i], rel, cliques[j], &rid) ==
+                               NG_OK);
+            memset(&options, 0, sizeof(options));
+            memset(&report, 0, sizeof(report));
+            report.level_modularity = levels;
+            report.level_capacity = 4;
+            for (options.leiden = 0; options.leiden < 2; options.leiden++) {
+                assert(ng_louvain_multilevel(g, rel, 0, &options, groups, 9, &count, &report) ==
+                           NG_OK &&
+                       count == 9 && report.communities == 3 && report.levels >= 1);
+                for (i = 0; i < 8; i++)
+                    assert(groups[i].component == i / 4);
+                assert(groups[8].component == 2 && report.modularity > 0.423 &&
+                       report.modularity < 0.424 &&
+                       levels[report.levels - 1] == report.modularity);
+            }
+            options.tolerance = -1.0;
+            assert(ng_louvain_multilevel(g, rel, 0, &options, groups, 9, &count, NULL) ==
+                   NG_INVALID_ARGUMENT);
+            assert(ng_louvain_multilevel(g, rel, 0, NULL, groups, 2, &count, NULL) == NG_LIMIT &&
+                   count == 9);
+            ng_close(g);
+            remove("communities.ng");
+        }
     }
     write_import_files();
     {
@@ -1939,11 +2196,160 @@ int main(void) {
                    &mutated) == NG_NOT_FOUND);
         assert(ng_node_count(g) == before && ng_validate(g) == NG_OK);
         assert(query_tmp(g, "CREATE (o:Person {name: \"Old\"}) RETURN o.name", &mutated) == NG_OK);
+        {
+            static const char* names[3] = {"Cy", "Di", "Ed"};
+            ng_parameter rows[6];
+            size_t i;
+            for (i = 0; i < 3; i++) {
+                rows[i * 2].name = "name";
+                rows[i * 2].value.type = NG_VALUE_STRING;
+                rows[i * 2].value.length = 2;
+                rows[i * 2].value.as.string = names[i];
+                rows[i * 2 + 1].name = "age";
+                rows[i * 2 + 1].value.type = NG_VALUE_INT64;
+                rows[i * 2 + 1].value.length = 0;
+                rows[i * 2 + 1].value.as.integer = (int64_t)(40 + i);
+            }
+            before = ng_node_count(g);
+            f = fopen("param.out", "wb");
+            assert(f);
+            assert(ng_query_execute_batch_params(g,
+                                                 "CREATE (p:Person {name: $name, age: $age}) "
+                                                 "RETURN p.name, p.age",
+                                                 rows,
+                                                 2,
+                                                 3,
+                                                 f,
+                                                 &mutated) == NG_OK &&
+                   mutated);
+            assert(fclose(f) == 0);
+            f = fopen("param.expected", "wb");
+            assert(f);
+            fputs("Cy\t40\nDi\t41\nEd\t42\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("param.out", "param.expected"));
+            assert(ng_node_count(g) == before + 3);
+            f = fopen("param.out", "wb");
+            assert(f);
+            assert(ng_query_execute_batch_params(g,
+                                                 "MATCH (p:Person) WHERE p.age = $age AND p.name "
+                                                 "<> \"Zed\" RETURN p.name",
+                                                 rows,
+                                                 2,
+                                                 3,
+                                                 f,
+                                                 &mutated) == NG_OK &&
+                   !mutated);
+            assert(fclose(f) == 0);
+            f = fopen("param.expected", "wb");
+            assert(f);
+            fputs("Cy\nDi\nEd\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("param.out", "param.expected"));
+            rows[5].name = "other";
+            assert(ng_query_execute_batch_params_file(
+                       g, "CREATE (p:Person {name: $name})", rows, 2, 3, "param.out", &mutated) ==
+                   NG_INVALID_ARGUMENT);
+            rows[5].name = "age";
+            rows[4].value.as.string = "Cy";
+            assert(ng_symbol(g, "Batched", &person) == NG_OK);
+            assert(ng_node_constraint_create(g, NG_NODE_CONSTRAINT_UNIQUE_PROPERTY, person, name) ==
+                   NG_OK);
+            before = ng_node_count(g);
+            assert(ng_query_execute_batch_params_file(g,
+                                                      "CREATE (p:Batched {name: $name, age: $age})",
+                                                      rows,
+                                                      2,
+                                                      3,
+                                                      "param.out",
+                                                      &mutated) == NG_EXISTS);
+            assert(!mutated && ng_node_count(g) == before && ng_validate(g) == NG_OK);
+        }
         remove("param.out");
         remove("param.expected");
         ng_close(g);
         remove("params.ng");
     }
+    {
+        static const size_t edges[6][2] = {{0, 1}, {1, 3}, {0, 2}, {2, 3}, {3, 4}, {0, 4}};
+        ng_symbol_id place, step, jump, key;
+        ng_node_id ids[5];
+        ng_relationship_id rel;
+        ng_value pv;
+        char text[256];
+        FILE* f;
+        size_t i;
+        assert(ng_create(&g, "shortest.ng") == NG_OK);
+        assert(ng_symbol(g, "Place", &place) == NG_OK);
+        assert(ng_symbol(g, "STEP", &step) == NG_OK);
+        assert(ng_symbol(g, "JUMP", &jump) == NG_OK);
+        assert(ng_symbol(g, "name", &key) == NG_OK);
+        for (i = 0; i < 5; i++) {
+            char name[2] = {(char)('a' + i), 0};
+            assert(ng_node_create(g, &place, 1, &ids[i]) == NG_OK);
+            pv.type = NG_VALUE_STRING;
+            pv.length = 1;
+            pv.as.string = name;
+            assert(ng_node_set(g, ids[i], key, &pv) == NG_OK);
+        }
+        for (i = 0; i < 6; i++)
+            assert(ng_relationship_create(
+                       g, ids[edges[i][0]], i == 5 ? jump : step, ids[edges[i][1]], &rel) == NG_OK);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(g,
+                                "MATCH p = shortestPath((a:Place {name: \"a\"})-[:STEP*..5]->"
+                                "(b:Place {name: \"e\"})) RETURN nodes(p), relationships(p)",
+                                f,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "[1, 2, 4, 5]\t[1, 2, 5]\n"));
+        fclose(f);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(g,
+                                "MATCH (a:Place {name: \"e\"}) MATCH (b:Place {name: \"a\"}) "
+                                "MATCH p = allShortestPaths((a)<-[:STEP*]-(b)) RETURN nodes(p)",
+                                f,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "[5, 4, 2, 1]\n[5, 4, 3, 1]\n"));
+        fclose(f);
+        assert(query_tmp(g,
+                         "MATCH p = shortestPath((a:Place {name: \"a\"})-[:STEP*2..5]->"
+                         "(b:Place)) RETURN b.name",
+                         0) == NG_PARSE_ERROR);
+        assert(query_tmp(g,
+                         "MATCH p = allShortestPaths((a:Place {name: \"a\"})-[*3..]-(b:Place)) "
+                         "RETURN b.name",
+                         0) == NG_PARSE_ERROR);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(g,
+                                "MATCH p = shortestPath((a:Place {name: \"a\"})-[*]-(b:Place)) "
+                                "RETURN b.name, size(relationships(p)) ORDER BY b.name",
+                                f,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "b\t1\nc\t1\nd\t2\ne\t1\n"));
+        fclose(f);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(g,
+                                "MATCH p = shortestPath((a:Place {name: \"a\"})-[:STEP*..2]->"
+                                "(b:Place {name: \"e\"})) RETURN p",
+                                f,
+                                0) == NG_OK);
+        assert(ftell(f) == 0);
+        fclose(f);
+        assert(query_tmp(g, "MATCH p = shortestPath((a)-[r:STEP]->(b)) RETURN p", 0) ==
+               NG_PARSE_ERROR);
+        ng_close(g);
+        remove("shortest.ng");
+    }
     {
         FILE* f;
         ng_symbol_id person, name, age, city, score, summary;
@@ -2116,6 +2522,249 @@ int main(void) {
         fputs("20\n", f);
         assert(fclose(f) == 0);
         assert(same_file("agg.out", "agg.expected"));
+        {
+            ng_symbol_id bulk, bucket, tag;
+            ng_node_id bid;
+            int64_t k;
+            assert(ng_symbol(g, "Bulk", &bulk) == NG_OK);
+            assert(ng_symbol(g, "bucket", &bucket) == NG_OK);
+            assert(ng_symbol(g, "tag", &tag) == NG_OK);
+            pv.type = NG_VALUE_INT64;
+            pv.length = 0;
+            for (k = 0; k < 600; k++) {
+                assert(ng_node_create(g, &bulk, 1, &bid) == NG_OK);
+                pv.as.integer = k % 150;
+                assert(ng_node_set(g, bid, bucket, &pv) == NG_OK);
+                pv.as.integer = k % 7;
+                assert(ng_node_set(g, bid, tag, &pv) == NG_OK);
+            }
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WITH a.bucket AS b, count(DISTINCT a.tag) AS "
+                                     "t, count(a) AS n RETURN count(b), sum(t), sum(n)",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("150\t600\t600\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WITH DISTINCT a.tag AS t RETURN count(t)",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("7\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WITH a ORDER BY a.tag DESC, a.bucket SKIP 2 "
+                                     "LIMIT 3 RETURN a.bucket, a.tag",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("4\t6\n6\t6\n7\t6\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WITH a.bucket AS b, a.tag AS t RETURN b, t "
+                                     "ORDER BY t DESC, b DESC SKIP 1 LIMIT 2",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("146\t6\n144\t6\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            ps[0].name = "t";
+            ps[0].value.type = NG_VALUE_INT64;
+            ps[0].value.length = 0;
+            ps[0].value.as.integer = 0;
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WHERE (a.tag = $t OR a.tag IN [1, 2]) AND "
+                                     "NOT a.bucket >= 10 WITH a RETURN count(a)",
+                                     ps,
+                                     1,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("18\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WHERE a.tag = $missing WITH a RETURN count(a)",
+                                     ps,
+                                     1,
+                                     "agg.out",
+                                     &mutated) != NG_OK);
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WHERE a.tag IN [$t, 1] AND a.bucket < 10 "
+                                     "WITH a RETURN count(a)",
+                                     ps,
+                                     1,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("12\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            assert(query_params_file(g,
+                                     "MATCH (a:Bulk) WHERE a.bucket < 10 AND a.tag IN [1, "
+                                     "$missing] WITH a RETURN count(a)",
+                                     ps,
+                                     1,
+                                     "agg.out",
+                                     &mutated) != NG_OK);
+            {
+                char where[512], text[1024];
+                size_t used = 0;
+                for (k = 0; k < 21; k++)
+                    used += (size_t)snprintf(where + used,
+                                             sizeof(where) - used,
+                                             "%sb.bucket = %d",
+                                             k ? " OR " : "",
+                                             k == 20 ? 3 : 200 + (int)k);
+                snprintf(text, sizeof(text), "MATCH (b:Bulk) WHERE %s RETURN b.bucket", where);
+                assert(query_params_file(g, text, NULL, 0, "agg.out", &mutated) == NG_OK);
+                f = fopen("agg.expected", "wb");
+                assert(f);
+                fputs("3\n3\n3\n3\n", f);
+                assert(fclose(f) == 0);
+                assert(same_file("agg.out", "agg.expected"));
+                snprintf(
+                    text, sizeof(text), "MATCH (b:Bulk) WITH b WHERE %s RETURN count(b)", where);
+                assert(query_params_file(g, text, NULL, 0, "agg.out", &mutated) == NG_OK);
+                f = fopen("agg.expected", "wb");
+                assert(f);
+                fputs("4\n", f);
+                assert(fclose(f) == 0);
+                assert(same_file("agg.out", "agg.expected"));
+                snprintf(text,
+                         sizeof(text),
+                         "MATCH (a:Bulk) WHERE a.bucket = 3 OPTIONAL MATCH (b:Bulk) WHERE %s "
+                         "RETURN count(b)",
+                         where);
+                assert(query_params_file(g, text, NULL, 0, "agg.out", &mutated) == NG_OK);
+                f = fopen("agg.expected", "wb");
+                assert(f);
+                fputs("16\n", f);
+                assert(fclose(f) == 0);
+                assert(same_file("agg.out", "agg.expected"));
+            }
+            assert(query_params_file(g,
+                                     "UNWIND [0, 1, 2, 3, 4] AS i UNWIND [0, 1] AS j CREATE "
+                                     "(h:Hop {k: i * 2 + j})",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK &&
+                   mutated);
+            assert(query_params_file(g,
+                                     "MATCH (a:Hop) WITH a MATCH (b:Hop) CREATE (a)-[:HOP]->(b)",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK &&
+                   mutated);
+            assert(query_params_file(g,
+                                     "MATCH (a:Hop)-[:HOP]->(b:Hop)-[:HOP]->(c:Hop)-[:HOP]->(d:Hop) "
+                                     "WHERE b.k = 2 AND (c.k = 3 OR NOT c.k <> 4) WITH d RETURN "
+                                     "count(*)",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("200\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            assert(query_params_file(g,
+                                     "MATCH (a:Hop)-[:HOP]-(b:Hop) WHERE a.k = 1 WITH b RETURN "
+                                     "count(*), count(DISTINCT b)",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("19\t10\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            {
+                static const char* const ops[] = {"Match", "Filter", "With", "Return"};
+                static const unsigned long rows[][2] = {{1, 19}, {19, 19}, {19, 19}, {19, 1}};
+                char line[256], op[32];
+                unsigned long in, out, rels;
+                size_t k;
+                f = tmpfile();
+                assert(f);
+                assert(ng_query_profile(g,
+                                        "PROFILE MATCH (a:Hop)-[:HOP]-(b:Hop) WHERE a.k = 1 "
+                                        "WITH b RETURN count(*)",
+                                        NULL,
+                                        0,
+                                        NULL,
+                                        f,
+                                        &mutated) == NG_OK &&
+                       !mutated);
+                rewind(f);
+                assert(fgets(line, sizeof(line), f));
+                assert(!strncmp(line, "operator\trows_in\trows_out\trelationships", 39));
+                for (k = 0; k < 4; k++) {
+                    assert(fgets(line, sizeof(line), f));
+                    assert(sscanf(line, "%31s %lu %lu %lu", op, &in, &out, &rels) == 4);
+                    assert(!strcmp(op, ops[k]) && in == rows[k][0] && out == rows[k][1]);
+                    assert(k || rels == 19);
+                }
+                assert(!fgets(line, sizeof(line), f));
+                fclose(f);
+            }
+            assert(query_params_file(g,
+                                     "MATCH (a:Hop {k: 1}) WITH a MATCH (b:Hop {k: 0}) CREATE "
+                                     "(a)-[:HOP]->(b)",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK &&
+                   mutated);
+            assert(query_params_file(g,
+                                     "MATCH (a:Hop)-[:HOP]-(b:Hop) WHERE a.k = 1 WITH b RETURN "
+                                     "count(*), count(DISTINCT b)",
+                                     NULL,
+                                     0,
+                                     "agg.out",
+                                     &mutated) == NG_OK);
+            f = fopen("agg.expected", "wb");
+            assert(f);
+            fputs("20\t10\n", f);
+            assert(fclose(f) == 0);
+            assert(same_file("agg.out", "agg.expected"));
+            assert(query_params_file(
+                       g, "PROFILE MATCH (a:Hop) RETURN count(a)", NULL, 0, "agg.out", &mutated) ==
+                   NG_OK);
+            f = fopen("agg.out", "rb");
+            assert(f);
+            {
+                char line[256];
+                assert(fgets(line, sizeof(line), f) && !strcmp(line, "10\n"));
+                assert(fgets(line, sizeof(line), f) && !strcmp(line, "# profile\n"));
+                assert(fgets(line, sizeof(line), f) && !strncmp(line, "operator\t", 9));
+                assert(fgets(line, sizeof(line), f) && !strncmp(line, "Count\t1\t1\t", 10));
+            }
+            assert(fclose(f) == 0);
+        }
         before = ng_node_count(g);
         assert(query_params_file(g,
                                  "MATCH (a:Person) WITH count(a) AS people WHERE people > 3 CREATE "
@@ -2868,6 +3517,7 @@ int main(void) {
     }
     {
         FILE* f = fopen("pipe.tsv", "wb");
+        size_t i;
         assert(f);
         fputs("alice\tKNOWS\tbob\n", f);
         assert(fclose(f) == 0);
@@ -2884,7 +3534,21 @@ int main(void) {
                       " query pipe.ng 'MATCH (n) RETURN n LIMIT 1' > pipe-query.out") == 0);
         assert(system(NAUTYLUS_CLI " explain 'MATCH (n) RETURN n LIMIT 1' > pipe-explain.out") ==
                0);
+        assert(system(NAUTYLUS_CLI
+                      " explain pipe.ng 'MATCH (n) RETURN n LIMIT 1' > pipe-profile.out") == 0);
         assert(same_file("pipe.tsv", "pipe-out.tsv"));
+        f = fopen("pipe.cypher", "wb");
+        assert(f);
+        for (i = 0; i < 30; i++)
+            fprintf(f, "CREATE (:Step {i: %llu});\n", (unsigned long long)i);
+        fputs("// done\n", f);
+        assert(fclose(f) == 0);
+        assert(system(NAUTYLUS_CLI " query pipe.ng @pipe.cypher > pipe-script.out") == 0);
+        assert(system(NAUTYLUS_CLI " query pipe.ng @missing.cypher 2> pipe-script.out") != 0);
+        assert(ng_open(&g, "pipe.ng") == NG_OK && ng_node_count(g) == 32);
+        ng_close(g);
+        remove("pipe.cypher");
+        remove("pipe-script.out");
         remove("pipe.ng");
         remove("pipe.tsv");
         remove("pipe-out.tsv");
@@ -2896,6 +3560,7 @@ int main(void) {
         remove("pipe-search.out");
         remove("pipe-query.out");
         remove("pipe-explain.out");
+        remove("pipe-profile.out");
     }
     {
         FILE* f = fopen("nosave.tsv", "wb");
@@ -4012,6 +4677,414 @@ int main(void) {
         ng_close(rw);
         remove("random-walk.ng");
     }
+    {
+        ng_graph* ag;
+        ng_symbol_id rtype, key;
+        ng_node_id hubs[2], id;
+        ng_relationship_id rid;
+        ng_value pv;
+        char text[64];
+        FILE* f;
+        size_t i;
+        assert(ng_create(&ag, "algo-call.ng") == NG_OK);
+        assert(ng_symbol(ag, "R", &rtype) == NG_OK);
+        assert(ng_symbol(ag, "name", &key) == NG_OK);
+        for (i = 0; i < 2; i++) {
+            pv.type = NG_VALUE_STRING;
+            pv.length = 1;
+            pv.as.string = i ? "g" : "h";
+            assert(ng_node_create(ag, 0, 0, &hubs[i]) == NG_OK);
+            assert(ng_node_set(ag, hubs[i], key, &pv) == NG_OK);
+        }
+        for (i = 0; i < 5000; i++) {
+            assert(ng_node_create(ag, 0, 0, &id) == NG_OK);
+            if (i < 13)
+                assert(ng_relationship_create(ag, id, rtype, hubs[i >= 10], &rid) == NG_OK);
+        }
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(ag,
+                                "CALL algo.degree({type: \"R\", direction: \"INCOMING\"}) "
+                                "YIELD node, score RETURN node.name, score ORDER BY score DESC "
+                                "LIMIT 2",
+                                f,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "h\t10\ng\t3\n"));
+        fclose(f);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(ag,
+                                "CALL algo.pagerank({type: \"R\", tolerance: 0.000001}) "
+                                "YIELD node AS n, score AS s "
+                                "WITH n, s ORDER BY s DESC LIMIT 1 RETURN n.name",
+                                f,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "h\n"));
+        fclose(f);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(ag,
+                                "CALL algo.degree({type: \"R\"}) YIELD node, score "
+                                "RETURN node.name AS name, score ORDER BY score DESC LIMIT 1",
+                                f,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "h\t10\n"));
+        fclose(f);
+        {
+            static const char* const calls[][2] = {{"pagerank", "score"},
+                                                   {"degree", "score"},
+                                                   {"eigenvector", "score"},
+                                                   {"closeness", "score"},
+                                                   {"harmonic", "score"},
+                                                   {"localClustering", "score"},
+                                                   {"triangles", "triangles"},
+                                                   {"wcc", "component"},
+                                                   {"scc", "component"},
+                                                   {"labelPropagation", "community"},
+                                                   {"louvain", "community"},
+                                                   {"betweenness", "score"}};
+            char call[256];
+            for (i = 0; i < sizeof(calls) / sizeof(calls[0]); i++) {
+                snprintf(call,
+                         sizeof(call),
+                         "CALL algo.%s() YIELD node, %s RETURN node, %s ORDER BY %s LIMIT 1",
+                         calls[i][0],
+                         calls[i][1],
+                         calls[i][1],
+                         calls[i][1]);
+                assert(query_tmp(ag, call, 0) == NG_OK);
+            }
+        }
+        assert(query_tmp(ag,
+                         "CALL algo.eigenvector({tolerance: 0.001}) YIELD node, score "
+                         "RETURN node, score ORDER BY score DESC LIMIT 1",
+                         0) == NG_OK);
+        assert(query_tmp(ag, "CALL algo.degree() YIELD node, score RETURN node, score", 0) ==
+               NG_LIMIT);
+        assert(query_tmp(ag, "CALL algo.wcc() YIELD score RETURN score", 0) == NG_PARSE_ERROR);
+        {
+            ng_node_score* scores = (ng_node_score*)malloc(5002 * sizeof(*scores));
+            char names[2][8];
+            double yielded[2];
+            size_t count = 0;
+            assert(scores);
+            assert(ng_betweenness_centrality(
+                       ag, NG_DIRECTION_EITHER, rtype, 0, scores, 5002, &count) == NG_OK &&
+                   count == 5002);
+            assert(scores[0].node == hubs[0] && scores[1].node == hubs[1]);
+            assert(scores[0].score > scores[1].score && scores[1].score > 0.0);
+            f = tmpfile();
+            assert(f);
+            assert(ng_query_execute(ag,
+                                    "CALL algo.betweenness({type: \"R\"}) YIELD node, score "
+                                    "RETURN node.name, score ORDER BY score DESC LIMIT 2",
+                                    f,
+                                    0) == NG_OK);
+            memset(text, 0, sizeof(text));
+            assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+            assert(sscanf(text,
+                          "%7s %lf %7s %lf",
+                          names[0],
+                          &yielded[0],
+                          names[1],
+                          &yielded[1]) == 4);
+            assert(!strcmp(names[0], "h") && !strcmp(names[1], "g"));
+            assert(absd(yielded[0] - scores[0].score) < 0.000001 &&
+                   absd(yielded[1] - scores[1].score) < 0.000001);
+            fclose(f);
+            free(scores);
+        }
+        assert(query_tmp(ag, "CALL algo.nope() YIELD node RETURN node", 0) == NG_NOT_FOUND);
+        assert(query_tmp(ag, "CALL algo.wcc({type: \"X\"}) YIELD node RETURN node", 0) ==
+               NG_NOT_FOUND);
+        ng_close(ag);
+        remove("algo-call.ng");
+    }
+    {
+        ng_graph* wg;
+        char text[128];
+        FILE* f;
+        assert(ng_create(&wg, "wide-query.ng") == NG_OK);
+        assert(query_tmp(wg,
+                         "CREATE (a:C {i: 0})-[:N]->(b:C {i: 1})-[:N]->(c:C {i: 2})-[:N]->"
+                         "(d:C {i: 3})-[:N]->(e:C {i: 4})-[:N]->(f:C {i: 5})-[:N]->"
+                         "(g:C {i: 6})-[:N]->(h:C {i: 7})-[:N]->(k:C {i: 8})-[:N]->"
+                         "(l:C {i: 9})",
+                         0) == NG_OK);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(wg,
+                                "MATCH (a:C)-[:N]->(b)-[:N]->(c)-[:N]->(d)-[:N]->(e)-[:N]->(f)"
+                                "-[:N]->(g)-[:N]->(h)-[:N]->(k)-[:N]->(l) "
+                                "WHERE l.i IN [11, 12, 13, 14, 15, 16, 17, 18, 19, 9] "
+                                "RETURN a.i, b.i, c.i, d.i, e.i, f.i, g.i, h.i, k.i, l.i, "
+                                "size([1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12]) AS n",
+                                f,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "0\t1\t2\t3\t4\t5\t6\t7\t8\t9\t12\n"));
+        fclose(f);
+        ng_close(wg);
+        remove("wide-query.ng");
+    }
+    {
+        ng_graph* cg;
+        ng_query_cache_stats stats;
+        ng_parameter param;
+        ng_symbol_id key;
+        ng_node_id id;
+        uint64_t version;
+        char text[64];
+        FILE* f;
+        int mutated = 0;
+        assert(ng_create(&cg, "query-cache.ng") == NG_OK);
+        assert(query_tmp(cg, "CREATE (:C {v: 1}), (:C {v: 2})", &mutated) == NG_OK && mutated);
+        assert(ng_query_cache_configure(cg, 2, 1 << 20) == NG_OK);
+        version = ng_graph_version(cg);
+        assert(query_tmp(cg, "MATCH (n:C) RETURN sum(n.v) AS s", &mutated) == NG_OK && !mutated);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_execute(cg, "MATCH (n:C) RETURN sum(n.v) AS s", f, 0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "3\n"));
+        fclose(f);
+        assert(ng_query_cache_get_stats(cg, &stats) == NG_OK);
+        assert(stats.hits == 1 && stats.misses == 1 && stats.entries == 1 && stats.bytes);
+        assert(ng_graph_version(cg) == version);
+        assert(ng_symbol(cg, "v", &key) == NG_OK);
+        assert(ng_node_create(cg, 0, 0, &id) == NG_OK);
+        assert(ng_node_set_int64(cg, id, key, 5) == NG_OK);
+        assert(ng_graph_version(cg) > version);
+        assert(query_tmp(cg, "MATCH (n:C) RETURN sum(n.v) AS s", 0) == NG_OK);
+        assert(ng_query_cache_get_stats(cg, &stats) == NG_OK);
+        assert(stats.hits == 1 && stats.misses == 2 && stats.entries == 1);
+        version = ng_graph_version(cg);
+        assert(query_tmp(cg, "MATCH (n:C {v: 1}) SET n.v = 4", &mutated) == NG_OK && mutated);
+        assert(ng_graph_version(cg) > version);
+        f = tmpfile();
+        assert(f);
+        assert(ng_query_print(cg, "MATCH (n:C) RETURN sum(n.v) AS s", f) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "6\n"));
+        fclose(f);
+        memset(&param, 0, sizeof(param));
+        param.name = "v";
+        param.value.type = NG_VALUE_INT64;
+        for (param.value.as.integer = 2; param.value.as.integer < 5; param.value.as.integer++)
+            assert(query_tmp_params(cg, "MATCH (n:C {v: $v}) RETURN n.v", &param, 1, 0) ==
+                   NG_OK);
+        assert(ng_query_cache_get_stats(cg, &stats) == NG_OK);
+        assert(stats.hits == 1 && stats.misses == 6 && stats.entries == 2);
+        assert(ng_query_cache_configure(cg, 0, 0) == NG_OK);
+        assert(ng_query_cache_get_stats(cg, &stats) == NG_OK);
+        assert(!stats.hits && !stats.misses && !stats.entries);
+        ng_close(cg);
+        remove("query-cache.ng");
+    }
+    {
+        ng_graph* kg;
+        ng_symbol_id label, type, key;
+        ng_node_id ids[5000];
+        ng_relationship_id rid;
+        ng_parameter param;
+        char text[256];
+        FILE *f, *report;
+        size_t i;
+        assert(ng_create(&kg, "count-store.ng") == NG_OK);
+        assert(ng_symbol(kg, "L", &label) == NG_OK);
+        assert(ng_symbol(kg, "T", &type) == NG_OK);
+        assert(ng_symbol(kg, "k", &key) == NG_OK);
+        for (i = 0; i < 5000; i++) {
+            assert(ng_node_create(kg, &label, 1, &ids[i]) == NG_OK);
+            assert(ng_node_set_int64(kg, ids[i], key, (int64_t)(i % 3)) == NG_OK);
+            if (i && i <= 10)
+                assert(ng_relationship_create(kg, ids[0], type, ids[i], &rid) == NG_OK);
+        }
+        assert(ng_node_index_create(kg, label, key) == NG_OK);
+        memset(&param, 0, sizeof(param));
+        param.name = "k";
+        param.value.type = NG_VALUE_INT64;
+        param.value.as.integer = 1;
+        f = tmpfile();
+        report = tmpfile();
+        assert(f && report);
+        assert(ng_query_profile(kg, "MATCH (n:L) RETURN count(n)", NULL, 0, f, report, 0) ==
+               NG_OK);
+        assert(ng_query_execute_params(
+                   kg, "MATCH (n:L {k: $k}) RETURN count(*) AS c", &param, 1, f, 0) == NG_OK);
+        assert(ng_query_execute(kg, "MATCH ()-[r:T]->() RETURN count(r)", f, 0) == NG_OK);
+        assert(ng_node_delete(kg, ids[1]) == NG_OK);
+        assert(ng_node_set_int64(kg, ids[4], key, 2) == NG_OK);
+        assert(query_tmp(kg, "CREATE (:L {k: 1})", 0) == NG_OK);
+        assert(ng_query_execute(kg, "MATCH (n:L) RETURN count(n)", f, 0) == NG_OK);
+        assert(ng_query_execute_params(
+                   kg, "MATCH (n:L) WHERE n.k = $k RETURN count(n)", &param, 1, f, 0) == NG_OK);
+        assert(ng_query_execute(kg, "MATCH ()-[r:T]->() RETURN count(*)", f, 0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "5000\n1667\n10\n5000\n1666\n9\n"));
+        memset(text, 0, sizeof(text));
+        assert(fseek(report, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, report) > 0);
+        assert(strstr(text, "\nCount\t1\t1\t"));
+        fclose(f);
+        fclose(report);
+        ng_close(kg);
+        remove("count-store.ng");
+    }
+    {
+        static const int64_t values[] = {0, 1, 50, 51, 52, 54, 56, 299};
+        ng_graph* kg;
+        ng_symbol_id label, key;
+        ng_node_id ids[300];
+        ng_parameter param;
+        char text[64], fast[32], scan[32];
+        FILE* f;
+        size_t i;
+        assert(ng_create(&kg, "count-postings.ng") == NG_OK);
+        assert(ng_symbol(kg, "L", &label) == NG_OK);
+        assert(ng_symbol(kg, "k", &key) == NG_OK);
+        for (i = 0; i < 300; i++) {
+            assert(ng_node_create(kg, &label, 1, &ids[i]) == NG_OK);
+            assert(ng_node_set_int64(kg, ids[i], key, (int64_t)(i % 2)) == NG_OK);
+        }
+        assert(ng_node_index_create(kg, label, key) == NG_OK);
+        memset(&param, 0, sizeof(param));
+        param.name = "k";
+        param.value.type = NG_VALUE_INT64;
+        assert(query_tmp_params(kg, "MATCH (n:L {k: $k}) RETURN count(*)", &param, 1, 0) ==
+               NG_OK);
+        for (i = 2; i < 300; i++)
+            assert(ng_node_set_int64(kg, ids[i], key, (int64_t)i) == NG_OK);
+        for (i = 3; i < 300; i += 10)
+            assert(ng_node_unset(kg, ids[i], key) == NG_OK);
+        assert(ng_node_delete(kg, ids[52]) == NG_OK);
+        assert(query_tmp(kg, "MATCH (n:L {k: 50}) REMOVE n:L", 0) == NG_OK);
+        assert(query_tmp(kg, "MATCH (n:L {k: 56}) SET n.k = 54", 0) == NG_OK);
+        assert(query_tmp(kg, "CREATE (:L {k: 1})", 0) == NG_OK);
+        for (i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            param.value.as.integer = values[i];
+            f = tmpfile();
+            assert(f);
+            assert(ng_query_execute_params(
+                       kg, "MATCH (n:L {k: $k}) RETURN count(*)", &param, 1, f, 0) == NG_OK);
+            assert(ng_query_execute_params(
+                       kg, "MATCH (n:L {k: $k}) WITH n RETURN count(n)", &param, 1, f, 0) ==
+                   NG_OK);
+            memset(text, 0, sizeof(text));
+            assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+            assert(sscanf(text, "%31s %31s", fast, scan) == 2 && !strcmp(fast, scan));
+            fclose(f);
+        }
+        assert(!strcmp(fast, "1"));
+        ng_close(kg);
+        remove("count-postings.ng");
+    }
+    {
+        ng_graph* eg;
+        char text[256];
+        FILE *f, *report;
+        assert(ng_create(&eg, "exists.ng") == NG_OK);
+        assert(query_tmp(eg,
+                         "CREATE (a:P {n: \"a\"})-[:F]->(:C), (b:P {n: \"b\"})-[:F]->(d:P {n: "
+                         "\"d\"}), (:P {n: \"e\"}), (a)-[:F]->(d)",
+                         0) == NG_OK);
+        f = tmpfile();
+        report = tmpfile();
+        assert(f && report);
+        assert(ng_query_execute(eg, "MATCH (a:P) WHERE (a)-[:F]->(:C) RETURN a.n", f, 0) == NG_OK);
+        assert(ng_query_execute(eg,
+                                "MATCH (a:P) WHERE NOT (a)-[:F]->() AND NOT ()-[:F]->(a) "
+                                "RETURN a.n",
+                                f,
+                                0) == NG_OK);
+        assert(ng_query_execute(
+                   eg, "MATCH (a:P) WHERE exists((a)-[:F]->({n: \"d\"})) RETURN a.n", f, 0) ==
+               NG_OK);
+        assert(ng_query_execute(eg, "MATCH (a:P) WHERE (a)-[:F]->(x) RETURN a.n", f, 0) ==
+               NG_PARSE_ERROR);
+        assert(ng_query_profile(eg,
+                                "MATCH (a:P) OPTIONAL MATCH (a)-[:F]->(x) WITH a, x "
+                                "WHERE x IS NULL RETURN a.n",
+                                NULL,
+                                0,
+                                f,
+                                report,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "a\ne\na\nb\nd\ne\n"));
+        memset(text, 0, sizeof(text));
+        assert(fseek(report, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, report) > 0);
+        assert(strstr(text, "\nAntiSemiApply\t4\t4\t"));
+        fclose(f);
+        fclose(report);
+        f = tmpfile();
+        report = tmpfile();
+        assert(f && report);
+        assert(ng_query_profile(eg,
+                                "MATCH (a:P) OPTIONAL MATCH (a)-[:F]->(x) "
+                                "WITH a, \"WHERE x\" AS w, x WHERE x IS NULL RETURN a.n, w",
+                                NULL,
+                                0,
+                                f,
+                                report,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(report, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, report) > 0);
+        assert(strstr(text, "\nAntiSemiApply\t4\t4\t"));
+        fclose(report);
+        report = tmpfile();
+        assert(report);
+        assert(ng_query_profile(eg,
+                                "MATCH (a:P) OPTIONAL MATCH (a)-[:F]->(x) WITH a, x LIMIT 9 "
+                                "WHERE x IS NULL RETURN a.n",
+                                NULL,
+                                0,
+                                f,
+                                report,
+                                0) == NG_OK);
+        memset(text, 0, sizeof(text));
+        assert(fseek(f, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, f) > 0);
+        assert(!strcmp(text, "d\tWHERE x\ne\tWHERE x\nd\ne\n"));
+        memset(text, 0, sizeof(text));
+        assert(fseek(report, 0, SEEK_SET) == 0 && fread(text, 1, sizeof(text) - 1, report) > 0);
+        assert(strstr(text, "\nOptionalMatch\t4\t5\t"));
+        fclose(f);
+        fclose(report);
+        {
+            size_t fail;
+            ng_status st = NG_OOM;
+            for (fail = 0; st != NG_OK; fail++) {
+                ng_node_id id;
+                assert(fail < 1000);
+                /* A write moves the graph version so each attempt rebuilds the adjacency. */
+                assert(ng_node_create(eg, NULL, 0, &id) == NG_OK);
+                assert(ng_node_delete(eg, id) == NG_OK);
+                f = tmpfile();
+                assert(f);
+                ng_test_fail_after(fail);
+                st = ng_query_execute(eg, "MATCH (a:P) WHERE (a)-[:F]->(:C) RETURN a.n", f, 0);
+                ng_test_fail_reset();
+                assert(st == NG_OK || st == NG_OOM);
+                memset(text, 0, sizeof(text));
+                assert(fseek(f, 0, SEEK_SET) == 0);
+                if (fread(text, 1, sizeof(text) - 1, f) > 0 || st == NG_OK)
+                    assert(st == NG_OK && !strcmp(text, "a\n"));
+                fclose(f);
+            }
+        }
+        ng_close(eg);
+        remove("exists.ng");
+    }
     {
         FILE* ef;
         remove("remove.ng");
@@ -4338,6 +5411,68 @@ int main(void) {
                                 1,
                                 &mutated) == NG_PARSE_ERROR);
         assert(!mutated && ng_node_count(g) == before && ng_validate(g) == NG_OK);
+        {
+            size_t i, rows = 6000, rels = ng_relationship_count(g);
+            ng_value* maps = (ng_value*)calloc(rows, sizeof(*maps));
+            ng_value_map* bodies = (ng_value_map*)calloc(rows, sizeof(*bodies));
+            ng_value_map_entry* entries = (ng_value_map_entry*)calloc(rows * 2, sizeof(*entries));
+            ng_symbol_id batch, k;
+            assert(maps && bodies && entries);
+            for (i = 0; i < rows; i++) {
+                entries[i * 2].key = "k";
+                entries[i * 2].value.type = NG_VALUE_INT64;
+                entries[i * 2].value.as.integer = (int64_t)i;
+                entries[i * 2 + 1].key = "g";
+                entries[i * 2 + 1].value.type = NG_VALUE_INT64;
+                entries[i * 2 + 1].value.as.integer = (int64_t)(i % 10);
+                bodies[i].count = 2;
+                bodies[i].entries = &entries[i * 2];
+                maps[i].type = NG_VALUE_MAP;
+                maps[i].length = 2;
+                maps[i].as.map = &bodies[i];
+            }
+            list.count = rows;
+            list.items = maps;
+            param.name = "rows";
+            param.value.type = NG_VALUE_LIST;
+            param.value.length = rows;
+            param.value.as.list = &list;
+            assert(ng_symbol(g, "Batch", &batch) == NG_OK && ng_symbol(g, "k", &k) == NG_OK);
+            assert(ng_node_constraint_create(g, NG_NODE_CONSTRAINT_UNIQUE_PROPERTY, batch, k) ==
+                   NG_OK);
+            before = ng_node_count(g);
+            assert(query_tmp_params(g,
+                                    "UNWIND $rows AS r CREATE (n:Batch {k: r.k})",
+                                    &param,
+                                    1,
+                                    &mutated) == NG_OK &&
+                   mutated && ng_node_count(g) == before + rows);
+            assert(query_tmp_params(g,
+                                    "UNWIND $rows AS r MERGE (n:Batch {k: r.k}) MERGE "
+                                    "(m:BatchGroup {g: r.g}) MERGE (n)-[:IN]->(m)",
+                                    &param,
+                                    1,
+                                    &mutated) == NG_OK &&
+                   mutated && ng_node_count(g) == before + rows + 10 &&
+                   ng_relationship_count(g) == rels + rows);
+            assert(query_tmp_params(g,
+                                    "UNWIND $rows AS r MERGE (n:Batch {k: r.k}) MERGE "
+                                    "(m:BatchGroup {g: r.g}) MERGE (n)-[:IN]->(m)",
+                                    &param,
+                                    1,
+                                    &mutated) == NG_OK &&
+                   !mutated && ng_relationship_count(g) == rels + rows);
+            assert(query_tmp_params(g,
+                                    "UNWIND $rows AS r CREATE (n:Batch {k: r.g})",
+                                    &param,
+                                    1,
+                                    &mutated) == NG_EXISTS &&
+                   !mutated && ng_node_count(g) == before + rows + 10);
+            assert(ng_validate(g) == NG_OK);
+            free(entries);
+            free(bodies);
+            free(maps);
+        }
         ng_close(g);
         remove("unwind.ng");
         remove("unwind.out");